@@ -0,0 +1,223 @@
+/*
+ * File: adapt_pool.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Resolver thread pool that resizes itself while it runs.
+ *      See adapt_pool.h.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "adapt_pool.h"
+
+static int pool_on = 0;
+static int pool_min, pool_max, pool_cores;
+static void *(*pool_worker)(void *);
+static int (*pool_backlog)(void);
+static int pool_capacity;
+
+static atomic_int running; // workers that count towards the target
+static atomic_int target;
+static atomic_llong busy_ns; // time spent in lookups this interval
+static atomic_long lookups;
+
+/* under pool_lock */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t pool_cond = PTHREAD_COND_INITIALIZER;
+static int alive = 0; // started and not returned yet
+static int next_id = 0;
+static int stopping = 0;
+static int peak = 0, grows = 0, shrinks = 0;
+static pthread_t controller;
+
+/* set once this worker has given up its place in running */
+static __thread int retired = 0;
+
+static void *worker_main(void *arg){
+    pool_worker(arg);
+    if(!retired){
+        atomic_fetch_sub(&running, 1);
+    }
+    pthread_mutex_lock(&pool_lock);
+    if(--alive == 0){
+        pthread_cond_broadcast(&pool_cond);
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return NULL;
+}
+
+/* Start n more workers. Called with pool_lock held */
+static void spawn(int n){
+    pthread_attr_t attr;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    pthread_attr_setstacksize(&attr, ADAPT_POOL_STACK_SIZE);
+    for(int i = 0; i < n; i++){
+        pthread_t t;
+        atomic_fetch_add(&running, 1);
+        if(pthread_create(&t, &attr, worker_main, (void *)(intptr_t)next_id)){
+            atomic_fetch_sub(&running, 1);
+            break; // try again next interval
+        }
+        next_id++;
+        alive++;
+    }
+    if(atomic_load(&running) > peak){
+        peak = atomic_load(&running);
+    }
+    pthread_attr_destroy(&attr);
+}
+
+/* One sizing decision per interval, see adapt_pool.h */
+static int next_target(int *idle_ticks){
+    long long busy = atomic_exchange(&busy_ns, 0);
+    long done = atomic_exchange(&lookups, 0);
+    int depth = pool_backlog();
+    int active = atomic_load(&running);
+    int goal = atomic_load(&target);
+    double util = active ? (double)busy / ((double)ADAPT_POOL_INTERVAL_MS * 1e6 * active) : 0.0;
+    long long mean_us = done ? busy / done / 1000 : 0;
+    int backlog_high = depth * 2 >= pool_capacity;
+
+    if(backlog_high && util >= 0.8){
+        *idle_ticks = 0;
+        if(mean_us >= ADAPT_POOL_IO_LATENCY_US){
+            goal = active + (active / 2 > 1 ? active / 2 : 1);
+        }
+        else if(active < pool_cores){
+            goal = active + 1;
+        }
+    }
+    else if(!backlog_high && util < 0.5){
+        if(++*idle_ticks >= ADAPT_POOL_SHRINK_TICKS){
+            /* retirements lag behind the target, shrink from whichever is lower */
+            int base = active < goal ? active : goal;
+            goal = base - (base / 4 > 1 ? base / 4 : 1);
+            *idle_ticks = 0;
+        }
+    }
+    else{
+        *idle_ticks = 0;
+    }
+    if(goal < pool_min){
+        goal = pool_min;
+    }
+    if(goal > pool_max){
+        goal = pool_max;
+    }
+    return goal;
+}
+
+static void *controller_main(void *unused){
+    int idle_ticks = 0;
+    (void)unused;
+
+    pthread_mutex_lock(&pool_lock);
+    while(!stopping){
+        struct timespec wake;
+        clock_gettime(CLOCK_REALTIME, &wake);
+        wake.tv_nsec += ADAPT_POOL_INTERVAL_MS * 1000000L;
+        wake.tv_sec += wake.tv_nsec / 1000000000L;
+        wake.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&pool_cond, &pool_lock, &wake);
+        if(stopping){
+            break;
+        }
+        pthread_mutex_unlock(&pool_lock);
+        int goal = next_target(&idle_ticks);
+        pthread_mutex_lock(&pool_lock);
+
+        int old = atomic_load(&target);
+        if(goal > old){
+            grows++;
+        }
+        else if(goal < old){
+            shrinks++;
+        }
+        atomic_store(&target, goal);
+        if(!stopping && goal > atomic_load(&running)){
+            spawn(goal - atomic_load(&running));
+        }
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return NULL;
+}
+
+int adapt_pool_start(int initial, int min, int max, void *(*worker)(void *),
+                     int (*backlog)(void), int backlog_capacity){
+    pool_min = min;
+    pool_max = max;
+    pool_worker = worker;
+    pool_backlog = backlog;
+    pool_capacity = backlog_capacity;
+    pool_cores = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if(pool_cores < 1){
+        pool_cores = 1;
+    }
+    if(initial < min){
+        initial = min;
+    }
+    if(initial > max){
+        initial = max;
+    }
+    atomic_init(&running, 0);
+    atomic_init(&target, initial);
+    atomic_init(&busy_ns, 0);
+    atomic_init(&lookups, 0);
+    pool_on = 1;
+
+    pthread_mutex_lock(&pool_lock);
+    stopping = 0;
+    spawn(initial);
+    int started = alive;
+    pthread_mutex_unlock(&pool_lock);
+    if(started == 0 || pthread_create(&controller, NULL, controller_main, NULL)){
+        return -1;
+    }
+    return 0;
+}
+
+int adapt_pool_keep_going(void){
+    if(!pool_on){
+        return 1;
+    }
+    if(retired){
+        return 0;
+    }
+    int r = atomic_load(&running);
+    while(r > atomic_load(&target)){
+        if(atomic_compare_exchange_weak(&running, &r, r - 1)){
+            retired = 1;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void adapt_pool_record(long long ns){
+    if(pool_on){
+        atomic_fetch_add_explicit(&busy_ns, ns, memory_order_relaxed);
+        atomic_fetch_add_explicit(&lookups, 1, memory_order_relaxed);
+    }
+}
+
+void adapt_pool_stop(void){
+    pthread_mutex_lock(&pool_lock);
+    stopping = 1;
+    pthread_cond_broadcast(&pool_cond);
+    while(alive > 0){
+        pthread_cond_wait(&pool_cond, &pool_lock);
+    }
+    pthread_mutex_unlock(&pool_lock);
+    pthread_join(controller, NULL);
+}
+
+void adapt_pool_report(FILE *out){
+    fprintf(out, "Resolver pool: %d threads started, peak %d, final target %d, grew %d times, shrank %d times\n",
+            next_id, peak, atomic_load(&target), grows, shrinks);
+}
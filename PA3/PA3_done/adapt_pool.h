@@ -0,0 +1,52 @@
+/*
+ * File: adapt_pool.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Resolver thread pool that resizes itself while it runs (-p/--pool).
+ *
+ *      A controller thread wakes every ADAPT_POOL_INTERVAL_MS and looks
+ *      at how many names are waiting in the queue, how long lookups took
+ *      and what fraction of the interval the resolvers spent in them:
+ *      - backlog building up and resolvers busy: grow. Slow lookups
+ *        (ADAPT_POOL_IO_LATENCY_US or more) are waiting on the network,
+ *        so the pool grows by half at a time; fast ones are CPU work, so
+ *        it grows by one and never past the number of cores.
+ *      - resolvers mostly idle for ADAPT_POOL_SHRINK_TICKS intervals:
+ *        shrink by a quarter.
+ *      always within the configured minimum and maximum. New threads are
+ *      started right away; surplus ones retire the next time they ask
+ *      adapt_pool_keep_going(), so no thread ever leaves with names in
+ *      hand.
+ */
+
+#ifndef ADAPT_POOL_H
+#define ADAPT_POOL_H
+
+#include <stdio.h>
+
+#define ADAPT_POOL_MAX_THREADS 1024
+#define ADAPT_POOL_INTERVAL_MS 100
+#define ADAPT_POOL_IO_LATENCY_US 500
+#define ADAPT_POOL_SHRINK_TICKS 3
+#define ADAPT_POOL_STACK_SIZE (256 * 1024) // resolvers only need a few KiB of locals
+
+/* Start initial workers running worker((void*)(intptr_t)id), kept between
+ * min and max. backlog returns how many items are waiting and
+ * backlog_capacity is how many fit. Returns 0 on success, -1 on failure */
+int adapt_pool_start(int initial, int min, int max, void *(*worker)(void *),
+                     int (*backlog)(void), int backlog_capacity);
+
+/* Called by a worker before it claims more work. 0 means the pool is
+ * shrinking and this worker should return now */
+int adapt_pool_keep_going(void);
+
+/* Called by a worker after each lookup, with how long it took */
+void adapt_pool_record(long long busy_ns);
+
+/* Wait until every worker has returned, then stop the controller */
+void adapt_pool_stop(void);
+
+/* Print threads started, peak and final size and how often it resized */
+void adapt_pool_report(FILE *out);
+
+#endif
@@ -0,0 +1,207 @@
+/*
+ * File: affinity.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	CPU pinning and NUMA placement. See affinity.h.
+ */
+
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include "affinity.h"
+
+#ifndef MPOL_F_NODE
+#define MPOL_F_NODE (1 << 0)
+#define MPOL_F_ADDR (1 << 1)
+#endif
+
+#define NODE_CPULIST "/sys/devices/system/node/node%d/cpulist"
+
+static const char *role_names[AFFINITY_ROLES] = { "requesters", "resolvers", "writer" };
+static cpu_set_t role_cpus[AFFINITY_ROLES];
+static int role_pinned[AFFINITY_ROLES];
+
+static __thread int thread_pinned = 0;
+static __thread cpu_set_t entered_from;
+static __thread int entered = 0;
+
+/* Add "0-3,8" to set. Returns 0 or -1 */
+static int parse_cpulist(const char *list, cpu_set_t *set){
+    const char *p = list;
+
+    while(*p && *p != '\n'){
+        char *end;
+        long first, last;
+
+        if(!isdigit((unsigned char)*p)){
+            return -1;
+        }
+        first = last = strtol(p, &end, 10);
+        if(*end == '-'){
+            if(!isdigit((unsigned char)end[1])){
+                return -1;
+            }
+            last = strtol(end + 1, &end, 10);
+        }
+        if(first > last || last >= CPU_SETSIZE){
+            return -1;
+        }
+        for(long cpu = first; cpu <= last; cpu++){
+            CPU_SET(cpu, set);
+        }
+        if(*end == ','){
+            end++;
+        }
+        else if(*end && *end != '\n'){
+            return -1;
+        }
+        p = end;
+    }
+    return p == list ? -1 : 0;
+}
+
+/* CPUs of NUMA node node. Returns 0, or -1 if there is no such node */
+static int node_cpus(int node, cpu_set_t *set){
+    char path[64], line[4096];
+    FILE *fp;
+    int status = -1;
+
+    snprintf(path, sizeof(path), NODE_CPULIST, node);
+    CPU_ZERO(set);
+    if(!(fp = fopen(path, "r"))){
+        return -1;
+    }
+    if(fgets(line, sizeof(line), fp)){
+        /* a node without CPUs (memory only) has an empty list */
+        status = (line[0] == '\n') ? 0 : parse_cpulist(line, set);
+    }
+    fclose(fp);
+    return status;
+}
+
+/* "0-3,8" for set */
+static void format_cpus(const cpu_set_t *set, char *buf, size_t size){
+    size_t used = 0;
+
+    buf[0] = '\0';
+    for(int cpu = 0; cpu < CPU_SETSIZE && used < size; cpu++){
+        int last = cpu;
+
+        if(!CPU_ISSET(cpu, set)){
+            continue;
+        }
+        while(last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, set)){
+            last++;
+        }
+        used += snprintf(buf + used, size - used, last > cpu ? "%s%d-%d" : "%s%d", used ? "," : "", cpu, last);
+        cpu = last;
+    }
+}
+
+/* "0", "0,1" for the nodes holding the CPUs of set, "?" without NUMA info */
+static void format_nodes(const cpu_set_t *set, char *buf, size_t size){
+    size_t used = 0;
+
+    buf[0] = '\0';
+    for(int node = 0; node < AFFINITY_MAX_NODES && used < size; node++){
+        cpu_set_t cpus, both;
+
+        if(node_cpus(node, &cpus)){
+            continue;
+        }
+        CPU_AND(&both, &cpus, set);
+        if(CPU_COUNT(&both) > 0){
+            used += snprintf(buf + used, size - used, "%s%d", used ? "," : "", node);
+        }
+    }
+    if(!used){
+        snprintf(buf, size, "?");
+    }
+}
+
+int affinity_set(int role, const char *cpus){
+    cpu_set_t set, allowed;
+
+    CPU_ZERO(&set);
+    if(!strncmp(cpus, "node", 4)){
+        char *end;
+        long node = strtol(cpus + 4, &end, 10);
+
+        if(!isdigit((unsigned char)cpus[4]) || *end || node >= AFFINITY_MAX_NODES ||
+           node_cpus((int)node, &set)){
+            return -1;
+        }
+    }
+    else if(parse_cpulist(cpus, &set)){
+        return -1;
+    }
+    /* stay inside what taskset or the cgroup left us */
+    if(sched_getaffinity(0, sizeof(allowed), &allowed)){
+        return -1;
+    }
+    CPU_AND(&role_cpus[role], &set, &allowed);
+    if(CPU_COUNT(&role_cpus[role]) == 0){
+        return -1;
+    }
+    role_pinned[role] = 1;
+    return 0;
+}
+
+void affinity_pin(int role){
+    if(thread_pinned || !role_pinned[role]){
+        return;
+    }
+    thread_pinned = 1;
+    if(pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &role_cpus[role])){
+        perror("Error to pin thread");
+    }
+}
+
+void affinity_enter(int role){
+    if(!role_pinned[role] || pthread_getaffinity_np(pthread_self(), sizeof(entered_from), &entered_from)){
+        return;
+    }
+    /* sched_setaffinity() on ourselves moves us off a CPU outside the set
+     * before it returns, so what follows already runs on the new node */
+    entered = !pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &role_cpus[role]);
+}
+
+void affinity_leave(void){
+    if(entered){
+        pthread_setaffinity_np(pthread_self(), sizeof(entered_from), &entered_from);
+        entered = 0;
+    }
+}
+
+int affinity_node_of(const void *addr){
+    int node = -1;
+
+    if(syscall(SYS_get_mempolicy, &node, NULL, 0UL, addr, (unsigned long)(MPOL_F_NODE | MPOL_F_ADDR))){
+        return -1; // no NUMA support in the kernel
+    }
+    return node;
+}
+
+void affinity_report(FILE *out){
+    int any = 0;
+
+    for(int role = 0; role < AFFINITY_ROLES; role++){
+        char cpus[256], nodes[128];
+
+        if(!role_pinned[role]){
+            continue;
+        }
+        format_cpus(&role_cpus[role], cpus, sizeof(cpus));
+        format_nodes(&role_cpus[role], nodes, sizeof(nodes));
+        fprintf(out, "%s%s on CPUs %s (node %s)", any ? ", " : "Pinned ", role_names[role], cpus, nodes);
+        any = 1;
+    }
+    if(any){
+        fprintf(out, "\n");
+    }
+}
@@ -0,0 +1,55 @@
+/*
+ * File: affinity.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	CPU pinning and NUMA placement (--pin-requesters, --pin-resolvers,
+ *      --pin-writer).
+ *
+ *      Each role can be given a CPU list ("0-3,8") or a whole node
+ *      ("node1", from /sys/devices/system/node). Threads pin themselves
+ *      when they start; threads they start (hedge helpers) inherit it.
+ *
+ *      Memory follows Linux's first-touch rule, so no libnuma is needed:
+ *      a page lands on the node of the thread that first writes it.
+ *      Name arena chunks are written by the requesters that own them,
+ *      result buffers by the resolvers that fill them. The queue is set
+ *      up by main while it runs on the resolvers' CPUs for the moment
+ *      (affinity_enter()), so its ring and counters start out next to
+ *      the threads that take names off it. affinity_report() shows the
+ *      node the queue actually landed on.
+ */
+
+#ifndef AFFINITY_H
+#define AFFINITY_H
+
+#include <stdio.h>
+
+enum affinity_role {
+    AFFINITY_REQUESTER,
+    AFFINITY_RESOLVER,
+    AFFINITY_WRITER,
+    AFFINITY_ROLES
+};
+
+#define AFFINITY_MAX_NODES 64
+
+/* Pin role to cpus. Returns 0, or -1 if the list is malformed, names a
+ * node that does not exist or has no CPU this process may use */
+int affinity_set(int role, const char *cpus);
+
+/* Pin the calling thread to its role's CPUs, if any were given. Only the
+ * first call of a thread does anything */
+void affinity_pin(int role);
+
+/* Run the calling thread on role's CPUs until affinity_leave(), to place
+ * memory it first touches meanwhile. Calls do not nest */
+void affinity_enter(int role);
+void affinity_leave(void);
+
+/* NUMA node holding the page at addr, -1 if unknown or not touched yet */
+int affinity_node_of(const void *addr);
+
+/* One line per pinned role: its CPUs and their nodes */
+void affinity_report(FILE *out);
+
+#endif
@@ -0,0 +1,125 @@
+#!/bin/sh
+#
+# File: bench.sh
+# Project: CSCI 3753 Programming Assignment 3
+# Description:
+#	Repeatable multi-lookup benchmark (make bench).
+#
+#	Generates names files, starts dns_stub as the name server and runs
+#	multi-lookup -a for every requester/resolver combination, or with
+#	BENCH_BACKEND runs the resolvers against that -B backend instead (no
+#	stub, no network: fake:5 measures the pipeline alone). Writes one
+#	JSON object per combination to $BENCH_OUT:
+#	{"requesters":3,"resolvers":5,"names":20000,"seconds":0.412,
+#	 "names_per_sec":48543,"p50_us":5120,"p99_us":23552,"p999_us":40960,...}
+#	Nothing depends on live DNS and the same settings give the same
+#	names and the same delays.
+#
+#	Settings come from the environment (make bench BENCH_DIST=pareto):
+#	BENCH_NAMES       names over all files (default 20000)
+#	BENCH_FILES       names files, at least 1 (default 5)
+#	BENCH_DUP         percent of names that repeat an earlier one (default 30)
+#	BENCH_NX          percent of names that do not exist (default 5)
+#	BENCH_DELAY       mean stub reply delay in ms (default 5)
+#	BENCH_DIST        fixed, uniform, exp or pareto (default exp)
+#	BENCH_LOSS        percent of queries the stub drops (default 0)
+#	BENCH_REQUESTERS  requester counts to try (default "1 3 5")
+#	BENCH_RESOLVERS   resolver counts to try (default "1 3 5 10")
+#	BENCH_BACKEND     -B backend instead of -a and the stub, e.g. "fake:5:2:exp"
+#	BENCH_ARGS        extra multi-lookup options, e.g. "-c -b 16"
+#	BENCH_SEED        seed for the names and the stub (default 1)
+#	BENCH_PORT        stub port (default 5399)
+#	BENCH_OUT         report file (default bench.jsonl)
+
+NAMES=${BENCH_NAMES:-20000}
+FILES=${BENCH_FILES:-5}
+DUP=${BENCH_DUP:-30}
+NX=${BENCH_NX:-5}
+DELAY=${BENCH_DELAY:-5}
+DIST=${BENCH_DIST:-exp}
+LOSS=${BENCH_LOSS:-0}
+REQUESTERS=${BENCH_REQUESTERS:-"1 3 5"}
+RESOLVERS=${BENCH_RESOLVERS:-"1 3 5 10"}
+BACKEND=${BENCH_BACKEND:-}
+ARGS=${BENCH_ARGS:-}
+SEED=${BENCH_SEED:-1}
+PORT=${BENCH_PORT:-5399}
+OUT=${BENCH_OUT:-bench.jsonl}
+
+DIR=$(mktemp -d "${TMPDIR:-/tmp}/bench.XXXXXX") || exit 1
+STUB_PID=
+cleanup(){
+    [ -n "$STUB_PID" ] && kill "$STUB_PID" 2>/dev/null
+    rm -rf "$DIR"
+}
+trap cleanup EXIT
+trap 'exit 1' INT TERM
+
+# names files: unique names, repeats of earlier ones and names that fail,
+# dealt out round robin
+awk -v n="$NAMES" -v files="$FILES" -v dup="$DUP" -v nx="$NX" -v seed="$SEED" -v dir="$DIR" '
+BEGIN {
+    srand(seed)
+    for(i = 0; i < n; i++){
+        if(made > 0 && rand() * 100 < dup){
+            name = seen[int(rand() * made)]
+        }
+        else{
+            name = (rand() * 100 < nx ? "nx-" : "") "bench-" made ".example"
+            seen[made++] = name
+        }
+        print name > (dir "/names" (i % files + 1) ".txt")
+    }
+}' || exit 1
+INPUTS=
+for f in $(seq 1 "$FILES"); do
+    INPUTS="$INPUTS $DIR/names$f.txt"
+done
+
+if [ -n "$BACKEND" ]; then
+    ENGINE="-B $BACKEND"
+    DIST=
+    DELAY=0
+    LOSS=0
+else
+    ENGINE="-a -s 127.0.0.1:$PORT"
+    ./dns_stub -p "$PORT" -d "$DELAY" -D "$DIST" -l "$LOSS" -S "$SEED" > "$DIR/stub.log" 2>&1 &
+    STUB_PID=$!
+    sleep 0.2
+    if ! kill -0 "$STUB_PID" 2>/dev/null; then
+        cat "$DIR/stub.log" >&2
+        exit 1
+    fi
+fi
+
+: > "$OUT"
+for req in $REQUESTERS; do
+    for res in $RESOLVERS; do
+        # shellcheck disable=SC2086 # ARGS, ENGINE and INPUTS are word lists
+        if ! ./multi-lookup $ARGS $ENGINE "$req" "$res" \
+                "$DIR/results.txt" "$DIR/serviced.txt" $INPUTS > "$DIR/run.log" 2>&1; then
+            echo "multi-lookup failed for $req requesters, $res resolvers:" >&2
+            tail -5 "$DIR/run.log" >&2
+            exit 1
+        fi
+        lines=$(wc -l < "$DIR/results.txt")
+        awk -v req="$req" -v res="$res" -v lines="$lines" -v dist="$DIST" \
+            -v delay="$DELAY" -v dup="$DUP" -v loss="$LOSS" -v args="$ARGS" -v backend="$BACKEND" '
+        /^Total run time:/ { us = $4 }
+        /^Lookup latency/ {
+            gsub(",", "")
+            for(i = 1; i <= NF; i++){
+                if($i == "p50") p50 = $(i + 1)
+                if($i == "p99") p99 = $(i + 1)
+                if($i == "p99.9") p999 = $(i + 1)
+                if($i == "max") max = $(i + 1)
+            }
+        }
+        END {
+            s = us / 1e6
+            printf "{\"requesters\":%d,\"resolvers\":%d,\"names\":%d,\"seconds\":%.3f,\"names_per_sec\":%.0f,", req, res, lines, s, (s > 0 ? lines / s : 0)
+            printf "\"p50_us\":%d,\"p99_us\":%d,\"p999_us\":%d,\"max_us\":%d,", p50, p99, p999, max
+            printf "\"backend\":\"%s\",\"delay_ms\":%d,\"dist\":\"%s\",\"dup_pct\":%d,\"loss_pct\":%d,\"args\":\"%s\"}\n", backend ? backend : "stub", delay, dist, dup, loss, args
+        }' "$DIR/run.log" | tee -a "$OUT"
+    done
+done
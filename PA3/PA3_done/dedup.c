@@ -0,0 +1,485 @@
+/*
+ * File: dedup.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Out-of-core deduplication pre-pass. See dedup.h.
+ *
+ *      A run file has one line per distinct spelling of a name, sorted:
+ *      "COUNT NAME\n", or "COUNT NAME ORIGINAL\n" if the input spelled it
+ *      differently from its normalized NAME.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "dedup.h"
+#include "result_format.h"
+#include "util.h"
+
+#define RUN_LINE (2 * (DEDUP_MAX_NAME + 1) + 32)
+#define DEDUP_INPUTFS "%1024s" // DEDUP_MAX_NAME, as the requesters read names
+
+struct entry {
+    char *norm;
+    char *orig; // NULL if the input spelled it as norm
+};
+
+/* a sorted sequence of (name, spelling, count): a run file or the batch
+ * still in memory */
+struct src {
+    FILE *fp; // NULL for the batch in memory
+    size_t next; // in memory: next entry
+    char line[RUN_LINE];
+    const char *norm, *orig;
+    long long count;
+    int done;
+};
+
+typedef int (*emit_fn)(const char *norm, const char *orig, long long count, void *ctx);
+
+static char dir[4096];
+static char unique_path[4096 + 16], answers_path[4096 + 16];
+static int out_fd = -1;
+
+/* the batch: names in strings, entries pointing at them */
+static char *strings;
+static size_t strings_size, strings_used;
+static struct entry *entries;
+static size_t max_entries, num_entries;
+
+static int *runs; // ids of the run files not merged away yet
+static int num_runs, runs_room, next_run;
+static long long names_read, names_unique, spilled_bytes;
+static int runs_written;
+
+static void run_path(int id, char *path, size_t size){
+    snprintf(path, size, "%s/run.%d", dir, id);
+}
+
+static int compare_entries(const void *a, const void *b){
+    const struct entry *x = a, *y = b;
+    int c = strcmp(x -> norm, y -> norm);
+    if(c){
+        return c;
+    }
+    return strcmp(x -> orig ? x -> orig : x -> norm, y -> orig ? y -> orig : y -> norm);
+}
+
+/* --- sources --- */
+
+static void src_advance(struct src *s){
+    if(!s -> fp){
+        struct entry *e;
+        size_t first = s -> next;
+
+        if(s -> next >= num_entries){
+            s -> done = 1;
+            return;
+        }
+        e = &entries[first];
+        while(s -> next < num_entries && !compare_entries(&entries[s -> next], e)){
+            s -> next++;
+        }
+        s -> norm = e -> norm;
+        s -> orig = e -> orig ? e -> orig : e -> norm;
+        s -> count = s -> next - first;
+        return;
+    }
+    if(!fgets(s -> line, sizeof(s -> line), s -> fp)){
+        s -> done = 1;
+        return;
+    }
+    char *p, *name, *orig;
+    s -> count = strtoll(s -> line, &p, 10);
+    name = p + 1;
+    name[strcspn(name, " \n")] = '\0';
+    orig = name + strlen(name) + 1;
+    if(orig >= s -> line + sizeof(s -> line) || !*orig || *orig == '\n'){
+        orig = name;
+    }
+    orig[strcspn(orig, "\n")] = '\0';
+    s -> norm = name;
+    s -> orig = orig;
+}
+
+static int src_compare(const struct src *a, const struct src *b){
+    int c = strcmp(a -> norm, b -> norm);
+    return c ? c : strcmp(a -> orig, b -> orig);
+}
+
+/* Open the runs ids[0..n), plus the batch in memory with memory set */
+static struct src *open_sources(const int *ids, int n, int memory, int *count){
+    struct src *srcs = calloc(n + 1, sizeof(*srcs));
+    int k = 0;
+
+    if(!srcs){
+        return NULL;
+    }
+    for(int i = 0; i < n; i++, k++){
+        char path[sizeof(dir) + 32];
+        run_path(ids[i], path, sizeof(path));
+        if(!(srcs[k].fp = fopen(path, "r"))){
+            for(int j = 0; j < k; j++){
+                fclose(srcs[j].fp);
+            }
+            free(srcs);
+            return NULL;
+        }
+        src_advance(&srcs[k]);
+    }
+    if(memory){
+        src_advance(&srcs[k++]);
+    }
+    *count = k;
+    return srcs;
+}
+
+static void close_sources(struct src *srcs, int n){
+    for(int i = 0; i < n; i++){
+        if(srcs[i].fp){
+            fclose(srcs[i].fp);
+        }
+    }
+    free(srcs);
+}
+
+/* Hand every (name, spelling) of the sources to emit once, in order,
+ * with its counts added up. Returns 0 or what emit failed with */
+static int merge(struct src *srcs, int n, emit_fn emit, void *ctx){
+    char norm[DEDUP_MAX_NAME + 1], orig[DEDUP_MAX_NAME + 1];
+
+    for(;;){
+        int min = -1;
+        long long total = 0;
+
+        for(int i = 0; i < n; i++){
+            if(!srcs[i].done && (min < 0 || src_compare(&srcs[i], &srcs[min]) < 0)){
+                min = i;
+            }
+        }
+        if(min < 0){
+            return 0;
+        }
+        snprintf(norm, sizeof(norm), "%s", srcs[min].norm);
+        snprintf(orig, sizeof(orig), "%s", srcs[min].orig);
+        for(int i = 0; i < n; i++){
+            while(!srcs[i].done && !strcmp(srcs[i].norm, norm) && !strcmp(srcs[i].orig, orig)){
+                total += srcs[i].count;
+                src_advance(&srcs[i]);
+            }
+        }
+        if(emit(norm, orig, total, ctx)){
+            return -1;
+        }
+    }
+}
+
+/* --- runs --- */
+
+static int emit_run(const char *norm, const char *orig, long long count, void *ctx){
+    FILE *fp = ctx;
+    int n = strcmp(norm, orig) ? fprintf(fp, "%lld %s %s\n", count, norm, orig) : fprintf(fp, "%lld %s\n", count, norm);
+
+    if(n < 0){
+        return -1;
+    }
+    spilled_bytes += n;
+    return 0;
+}
+
+/* Start run file id, returns it open for writing or NULL */
+static FILE *new_run(int *id){
+    char path[sizeof(dir) + 32];
+
+    if(num_runs == runs_room){
+        int room = runs_room ? runs_room * 2 : 64;
+        int *more = realloc(runs, sizeof(*runs) * room);
+        if(!more){
+            return NULL;
+        }
+        runs = more;
+        runs_room = room;
+    }
+    *id = next_run++;
+    run_path(*id, path, sizeof(path));
+    return fopen(path, "w");
+}
+
+/* Sort the batch and write it out as a run, leaving memory empty */
+static int spill(void){
+    struct src *srcs;
+    FILE *fp;
+    int id, n, status;
+
+    qsort(entries, num_entries, sizeof(*entries), compare_entries);
+    if(!(fp = new_run(&id)) || !(srcs = open_sources(NULL, 0, 1, &n))){
+        if(fp){
+            fclose(fp);
+        }
+        return -1;
+    }
+    status = merge(srcs, n, emit_run, fp);
+    close_sources(srcs, n);
+    if(fclose(fp) || status){
+        return -1;
+    }
+    runs[num_runs++] = id;
+    runs_written++;
+    num_entries = 0;
+    strings_used = 0;
+    return 0;
+}
+
+/* Merge runs until at most DEDUP_MAX_FANIN are left */
+static int merge_runs(void){
+    while(num_runs > DEDUP_MAX_FANIN){
+        struct src *srcs;
+        FILE *fp;
+        int id, n, status;
+
+        if(!(fp = new_run(&id))){
+            return -1;
+        }
+        if(!(srcs = open_sources(runs, DEDUP_MAX_FANIN, 0, &n))){
+            fclose(fp);
+            return -1;
+        }
+        status = merge(srcs, n, emit_run, fp);
+        close_sources(srcs, n);
+        if(fclose(fp) || status){
+            return -1;
+        }
+        for(int i = 0; i < DEDUP_MAX_FANIN; i++){
+            char path[sizeof(dir) + 32];
+            run_path(runs[i], path, sizeof(path));
+            unlink(path);
+        }
+        memmove(runs, runs + DEDUP_MAX_FANIN, sizeof(*runs) * (num_runs - DEDUP_MAX_FANIN));
+        num_runs -= DEDUP_MAX_FANIN;
+        runs[num_runs++] = id;
+    }
+    return 0;
+}
+
+/* --- pass 1 --- */
+
+static char *keep(const char *s, size_t len){
+    char *p = strings + strings_used;
+    memcpy(p, s, len + 1);
+    strings_used += len + 1;
+    return p;
+}
+
+static int add_name(const char *name){
+    char norm[DEDUP_MAX_NAME + 1];
+    size_t len = strlen(name), nlen;
+
+    if(!dns_name_normalize(name, norm, sizeof(norm))){
+        snprintf(norm, sizeof(norm), "%s", name); // ".": looked up as it is, like without -D
+    }
+    nlen = strlen(norm);
+    int same = !strcmp(norm, name);
+    size_t need = nlen + 1 + (same ? 0 : len + 1);
+
+    if((num_entries == max_entries || strings_used + need > strings_size) && spill()){
+        return -1;
+    }
+    entries[num_entries].norm = keep(norm, nlen);
+    entries[num_entries].orig = same ? NULL : keep(name, len);
+    num_entries++;
+    names_read++;
+    return 0;
+}
+
+static int emit_unique(const char *norm, const char *orig, long long count, void *ctx){
+    static char last[DEDUP_MAX_NAME + 1];
+    FILE *fp = ctx;
+
+    (void)orig;
+    (void)count;
+    if(names_unique > 0 && !strcmp(norm, last)){
+        return 0; // another spelling of the same name
+    }
+    snprintf(last, sizeof(last), "%s", norm);
+    names_unique++;
+    return fprintf(fp, "%s\n", norm) < 0 ? -1 : 0;
+}
+
+int dedup_init(const char *out_path, size_t memory){
+    const char *tmp = getenv("TMPDIR");
+
+    snprintf(dir, sizeof(dir), "%s/multi-lookup-dedup.XXXXXX", tmp && *tmp ? tmp : "/tmp");
+    if(!mkdtemp(dir)){
+        return -1;
+    }
+    snprintf(unique_path, sizeof(unique_path), "%s/unique", dir);
+    snprintf(answers_path, sizeof(answers_path), "%s/answers", dir);
+    if(!strcmp(out_path, "-")){
+        out_fd = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0); // main points stdout elsewhere later
+    }
+    else{
+        out_fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    /* a quarter for the entries, the rest for the names; untouched pages cost nothing */
+    max_entries = memory / 4 / sizeof(*entries);
+    strings_size = memory - max_entries * sizeof(*entries);
+    entries = malloc(sizeof(*entries) * max_entries);
+    strings = malloc(strings_size);
+    if(out_fd < 0 || !entries || !strings){
+        return -1;
+    }
+    return 0;
+}
+
+int dedup_prepass(char **inputs, int count){
+    char hostname[DEDUP_MAX_NAME + 1];
+    struct src *srcs;
+    FILE *fp;
+    int n, status;
+
+    for(int i = 0; i < count; i++){
+        FILE *in = strcmp(inputs[i], "-") ? fopen(inputs[i], "r") : stdin;
+        if(!in){
+            perror("Error to open file!");
+            continue; // like a requester would
+        }
+        while(fscanf(in, DEDUP_INPUTFS, hostname) > 0){
+            if(add_name(hostname)){
+                if(in != stdin){
+                    fclose(in);
+                }
+                return -1;
+            }
+        }
+        if(in != stdin){
+            fclose(in);
+        }
+    }
+    qsort(entries, num_entries, sizeof(*entries), compare_entries);
+    if(merge_runs() || !(fp = fopen(unique_path, "w"))){
+        return -1;
+    }
+    if(!(srcs = open_sources(runs, num_runs, 1, &n))){
+        fclose(fp);
+        return -1;
+    }
+    status = merge(srcs, n, emit_unique, fp);
+    close_sources(srcs, n);
+    return (fclose(fp) || status) ? -1 : 0;
+}
+
+const char *dedup_unique_path(void){
+    return unique_path;
+}
+
+const char *dedup_answers_path(void){
+    return answers_path;
+}
+
+/* --- pass 2 --- */
+
+struct expand {
+    FILE *out;
+    int format, all;
+    result_reader reader;
+    result_record rec;
+    int have; // rec holds the next answer not used up yet
+};
+
+static int emit_expanded(const char *norm, const char *orig, long long count, void *ctx){
+    struct expand *x = ctx;
+    char line[RESULT_FORMAT_MAX_LINE > RESULT_FORMAT_MAX_RECORD ? RESULT_FORMAT_MAX_LINE : RESULT_FORMAT_MAX_RECORD];
+    dns_addr_list none = { .count = 0 };
+    int len, status = UTIL_FAILURE;
+    const dns_addr_list *list = &none;
+
+    /* both sides are sorted the same way: move the answers up to norm */
+    while(x -> have && strcmp(x -> rec.name, norm) < 0){
+        if((x -> have = result_reader_next(&x -> reader, &x -> rec)) < 0){
+            return -1;
+        }
+    }
+    if(x -> have && !strcmp(x -> rec.name, norm)){
+        status = x -> rec.status;
+        list = &x -> rec.list;
+    }
+    if(x -> format == RESULT_FORMAT_BINARY){
+        len = (int)result_format_record((unsigned char *)line, orig, status, list);
+    }
+    else{
+        len = result_format_line(line, orig, status, list, x -> all);
+    }
+    for(long long i = 0; i < count; i++){
+        if(fwrite(line, 1, len, x -> out) != (size_t)len){
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int dedup_expand(int format, int all){
+    struct expand x = { .format = format, .all = all };
+    struct src *srcs = NULL;
+    int fd = open(answers_path, O_RDONLY | O_CLOEXEC), n = 0, status = -1;
+
+    if(fd < 0){
+        return -1;
+    }
+    if(result_reader_open(&x.reader, fd)){
+        close(fd);
+        return -1;
+    }
+    if(!(x.out = fdopen(out_fd, "w"))){
+        goto out;
+    }
+    out_fd = -1; // x.out has it now
+    if(format == RESULT_FORMAT_BINARY){
+        unsigned char header[RESULT_FORMAT_HEADER_SIZE];
+        fwrite(header, 1, result_format_header(header), x.out);
+    }
+    if((x.have = result_reader_next(&x.reader, &x.rec)) < 0 || !(srcs = open_sources(runs, num_runs, 1, &n))){
+        goto out;
+    }
+    status = merge(srcs, n, emit_expanded, &x);
+out:
+    if(srcs){
+        close_sources(srcs, n);
+    }
+    if(x.out && fclose(x.out)){
+        status = -1;
+    }
+    result_reader_close(&x.reader);
+    close(fd);
+    return status;
+}
+
+void dedup_report(FILE *out){
+    fprintf(out, "Dedup: %lld names read, %lld distinct looked up (%.1f%% fewer), %d runs spilled (%lld bytes)\n",
+            names_read, names_unique, names_read ? 100.0 * (names_read - names_unique) / names_read : 0.0,
+            runs_written, spilled_bytes);
+}
+
+void dedup_cleanup(void){
+    for(int i = 0; i < num_runs; i++){
+        char path[sizeof(dir) + 32];
+        run_path(runs[i], path, sizeof(path));
+        unlink(path);
+    }
+    if(dir[0]){
+        unlink(unique_path);
+        unlink(answers_path);
+        rmdir(dir);
+    }
+    if(out_fd >= 0){
+        close(out_fd);
+        out_fd = -1;
+    }
+    free(runs);
+    free(entries);
+    free(strings);
+    runs = NULL;
+    entries = NULL;
+    strings = NULL;
+}
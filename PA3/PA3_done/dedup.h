@@ -0,0 +1,59 @@
+/*
+ * File: dedup.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Out-of-core deduplication pre-pass (-D/--dedup[=MB]).
+ *
+ *      Before anything is resolved, every name of the input files is
+ *      read once and normalized (lower case, no trailing dot). The names
+ *      are gathered with their original spelling in at most MB megabytes;
+ *      whenever that fills up they are sorted, repeats are folded into a
+ *      count, and the batch is spilled to a run file. The runs are then
+ *      merged, DEDUP_MAX_FANIN at a time, and each distinct name is
+ *      written once, in sorted order, to the file the resolvers read.
+ *      Nothing needs more memory than the budget, however big the input.
+ *
+ *      The resolvers answer the distinct names in that order into a
+ *      binary results file (result_format.h). The expansion step merges
+ *      the runs again alongside it and writes one result per input name
+ *      under its original spelling, to the results file the user named,
+ *      in text or binary. Lines come out grouped by name, not in input
+ *      order. Everything temporary lives in one directory under $TMPDIR
+ *      (or /tmp) and is removed at the end.
+ */
+
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define DEDUP_DEFAULT_MB 256
+#define DEDUP_MAX_MB (1 << 20)
+#define DEDUP_MAX_FANIN 64 // runs merged at once
+#define DEDUP_MAX_NAME 1024
+
+/* Make the temporary directory and open out_path, the final results
+ * file ("-" is standard output), before anything else claims it. memory
+ * is the budget in bytes. Returns 0 or -1 */
+int dedup_init(const char *out_path, size_t memory);
+
+/* Read every name of the count input files ("-" is standard input) and
+ * write the distinct ones to dedup_unique_path(). Returns 0 or -1 */
+int dedup_prepass(char **inputs, int count);
+
+/* The names the resolvers should read, and where their binary results go */
+const char *dedup_unique_path(void);
+const char *dedup_answers_path(void);
+
+/* Write one result per input name to the results file, in format
+ * (RESULT_FORMAT_TEXT or _BINARY), all addresses with all. Returns 0 or -1 */
+int dedup_expand(int format, int all);
+
+/* Names read, distinct names, runs spilled */
+void dedup_report(FILE *out);
+
+/* Remove the temporary files */
+void dedup_cleanup(void);
+
+#endif
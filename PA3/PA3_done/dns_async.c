@@ -0,0 +1,538 @@
+/*
+ * File: dns_async.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Event-driven DNS resolver engine. See dns_async.h.
+ *
+ *      Query slots are preallocated, one per name. The low 12 bits of a
+ *      query id are its slot, the next bit tells the A query from the
+ *      AAAA one and the top 3 bits count how often the slot was sent, so
+ *      a late reply to an earlier use of the slot is dropped. Outstanding
+ *      names sit on one timer list per attempt: every name on a list got
+ *      the same timeout, so each list is in deadline order and only its
+ *      head ever needs checking.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <netinet/in.h>
+#include "util.h"
+#include "dns_async.h"
+
+#define DNS_HEADER_SIZE 12
+#define DNS_MAX_NAME 255     // encoded, including the root label
+#define DNS_MAX_PACKET (DNS_HEADER_SIZE + DNS_MAX_NAME + 4)
+#define DNS_MAX_REPLY 4096
+#define DNS_TYPE_A 1
+#define DNS_TYPE_AAAA 28
+#define DNS_CLASS_IN 1
+#define DNS_RCODE_NXDOMAIN 3
+#define DNS_SLOT_BITS 12
+#define DNS_SLOT_MASK ((1 << DNS_SLOT_BITS) - 1)
+#define DNS_GEN_SHIFT (DNS_SLOT_BITS + 1)
+
+/* the two queries sent per name, index into found[] */
+#define Q_A 0
+#define Q_AAAA 1
+
+struct dns_query {
+    void *arg;
+    int prev, next;      // timer list links, next doubles as free list link
+    int attempt;         // 0 for the first send, up to DNS_ASYNC_RETRIES
+    int in_use;
+    int outstanding;     // bit Q_A / Q_AAAA set until that query is answered
+    unsigned int gen;    // sends of this slot so far
+    long long deadline;  // ms, CLOCK_MONOTONIC
+    long long submitted; // ns, CLOCK_MONOTONIC
+    size_t len;
+    unsigned char packet[DNS_MAX_PACKET]; // the A query, patched for AAAA
+    dns_addr_list found[2];
+};
+
+struct dns_async {
+    int fd;
+    int epfd;
+    int max;
+    int inflight;
+    int free_head;
+    int head[DNS_ASYNC_RETRIES + 1]; // timer list per attempt
+    int tail[DNS_ASYNC_RETRIES + 1];
+    dns_async_done done;
+    struct dns_query *q;
+};
+
+static struct sockaddr_storage server_addr;
+static socklen_t server_len = 0;
+static char server_name[INET6_ADDRSTRLEN + 8];
+
+static long long now_ms(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static long long now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* --- name server address --- */
+
+static int parse_server(const char *spec){
+    char host[INET6_ADDRSTRLEN + 8];
+    const char *port_str = NULL;
+    int port = DNS_ASYNC_PORT;
+
+    if(strlen(spec) >= sizeof(host)){
+        return -1;
+    }
+    strcpy(host, spec);
+    if(host[0] == '['){
+        /* [v6]:port */
+        char *close = strchr(host, ']');
+        if(!close){
+            return -1;
+        }
+        if(close[1] == ':'){
+            port_str = spec + (close - host) + 2;
+        }
+        *close = '\0';
+        memmove(host, host + 1, strlen(host + 1) + 1);
+    }
+    else{
+        /* a single colon separates the port, more than one is a bare v6 address */
+        char *colon = strchr(host, ':');
+        if(colon && !strchr(colon + 1, ':')){
+            *colon = '\0';
+            port_str = colon + 1;
+        }
+    }
+    if(port_str){
+        port = atoi(port_str);
+        if(port < 1 || port > 65535){
+            return -1;
+        }
+    }
+
+    memset(&server_addr, 0, sizeof(server_addr));
+    struct sockaddr_in *v4 = (struct sockaddr_in *)&server_addr;
+    struct sockaddr_in6 *v6 = (struct sockaddr_in6 *)&server_addr;
+    if(inet_pton(AF_INET, host, &v4 -> sin_addr) == 1){
+        v4 -> sin_family = AF_INET;
+        v4 -> sin_port = htons(port);
+        server_len = sizeof(*v4);
+    }
+    else if(inet_pton(AF_INET6, host, &v6 -> sin6_addr) == 1){
+        v6 -> sin6_family = AF_INET6;
+        v6 -> sin6_port = htons(port);
+        server_len = sizeof(*v6);
+    }
+    else{
+        return -1;
+    }
+    snprintf(server_name, sizeof(server_name),
+             server_addr.ss_family == AF_INET6 ? "[%s]:%d" : "%s:%d", host, port);
+    return 0;
+}
+
+int dns_async_set_server(const char *server){
+    char line[256];
+    char addr[INET6_ADDRSTRLEN];
+    FILE *conf;
+
+    if(server){
+        return parse_server(server);
+    }
+    /* no server given: the first nameserver the system resolver would use */
+    if((conf = fopen("/etc/resolv.conf", "r")) != NULL){
+        while(fgets(line, sizeof(line), conf)){
+            if(sscanf(line, " nameserver %45s", addr) == 1 && parse_server(addr) == 0){
+                fclose(conf);
+                return 0;
+            }
+        }
+        fclose(conf);
+    }
+    return parse_server("127.0.0.1");
+}
+
+const char *dns_async_server_name(void){
+    return server_name;
+}
+
+/* --- wire format --- */
+
+/* Header and question for name, returns the packet length or 0 if the
+ * name cannot be encoded */
+static size_t build_query(unsigned char *p, const char *name, size_t len){
+    size_t pos = DNS_HEADER_SIZE;
+
+    if(len > 0 && name[len - 1] == '.'){
+        len--; // already fully qualified
+    }
+    if(len == 0 || len + 2 > DNS_MAX_NAME){
+        return 0;
+    }
+    memset(p, 0, DNS_HEADER_SIZE);
+    p[2] = 0x01; // RD
+    p[5] = 1;    // QDCOUNT
+    for(size_t start = 0; start <= len; ){
+        size_t end = start;
+        while(end < len && name[end] != '.'){
+            end++;
+        }
+        if(end == start || end - start > 63){
+            return 0;
+        }
+        p[pos++] = (unsigned char)(end - start);
+        memcpy(p + pos, name + start, end - start);
+        pos += end - start;
+        start = end + 1;
+    }
+    p[pos++] = 0;
+    p[pos++] = 0; p[pos++] = DNS_TYPE_A;
+    p[pos++] = 0; p[pos++] = DNS_CLASS_IN;
+    return pos;
+}
+
+/* Offset just past the (possibly compressed) name at pos, 0 if malformed */
+static size_t skip_name(const unsigned char *buf, size_t n, size_t pos){
+    while(pos < n){
+        unsigned char len = buf[pos];
+        if(len == 0){
+            return pos + 1;
+        }
+        if((len & 0xc0) == 0xc0){
+            return pos + 2 <= n ? pos + 2 : 0;
+        }
+        if(len & 0xc0){
+            return 0;
+        }
+        pos += len + 1;
+    }
+    return 0;
+}
+
+static unsigned int get16(const unsigned char *p){
+    return (p[0] << 8) | p[1];
+}
+
+/* Does the reply ask the question we sent as query which? Servers echo
+ * the name verbatim, case is only compared loosely in case one
+ * normalises it */
+static int same_question(const unsigned char *buf, size_t n, const struct dns_query *q, int which){
+    size_t name_end = q -> len - 4;
+    if(n < q -> len || get16(buf + 4) != 1){
+        return 0;
+    }
+    for(size_t i = DNS_HEADER_SIZE; i < name_end; i++){
+        if(tolower(buf[i]) != tolower(q -> packet[i])){
+            return 0;
+        }
+    }
+    return get16(buf + name_end) == (which == Q_A ? DNS_TYPE_A : DNS_TYPE_AAAA) &&
+           get16(buf + name_end + 2) == DNS_CLASS_IN;
+}
+
+/* Append the A (which == Q_A) or AAAA records of the reply to list.
+ * Returns the reply's RCODE */
+static int parse_answer(const unsigned char *buf, size_t n, const struct dns_query *q,
+                        int which, dns_addr_list *list){
+    size_t pos = q -> len;   // the question is the same length as ours
+    unsigned int ancount = get16(buf + 6);
+    unsigned int want = (which == Q_A) ? DNS_TYPE_A : DNS_TYPE_AAAA;
+    unsigned int size = (which == Q_A) ? 4 : 16;
+    int rcode = buf[3] & 0x0f;
+
+    if(rcode != 0){
+        return rcode; // NXDOMAIN, SERVFAIL, REFUSED...
+    }
+    for(unsigned int i = 0; i < ancount && list -> count < UTIL_MAX_ADDRS; i++){
+        if(!(pos = skip_name(buf, n, pos)) || pos + 10 > n){
+            break;
+        }
+        unsigned int type = get16(buf + pos);
+        unsigned int class = get16(buf + pos + 2);
+        unsigned int rdlen = get16(buf + pos + 8);
+        pos += 10;
+        if(pos + rdlen > n){
+            break;
+        }
+        /* CNAMEs come first and are followed by the records of their target */
+        if(type == want && class == DNS_CLASS_IN && rdlen == size){
+            dns_addr *a = &list -> addrs[list -> count++];
+            memset(a, 0, sizeof(*a));
+            a -> family = (which == Q_A) ? AF_INET : AF_INET6;
+            memcpy(a -> bytes, buf + pos, size);
+        }
+        pos += rdlen;
+    }
+    return 0;
+}
+
+/* --- timer lists --- */
+
+static void timer_unlink(dns_async *e, int slot){
+    struct dns_query *q = &e -> q[slot];
+    if(q -> prev >= 0){
+        e -> q[q -> prev].next = q -> next;
+    }
+    else{
+        e -> head[q -> attempt] = q -> next;
+    }
+    if(q -> next >= 0){
+        e -> q[q -> next].prev = q -> prev;
+    }
+    else{
+        e -> tail[q -> attempt] = q -> prev;
+    }
+}
+
+static void timer_append(dns_async *e, int slot){
+    struct dns_query *q = &e -> q[slot];
+    int a = q -> attempt;
+    q -> deadline = now_ms() + ((long long)DNS_ASYNC_TIMEOUT_MS << a);
+    q -> next = -1;
+    q -> prev = e -> tail[a];
+    if(e -> tail[a] >= 0){
+        e -> q[e -> tail[a]].next = slot;
+    }
+    else{
+        e -> head[a] = slot;
+    }
+    e -> tail[a] = slot;
+}
+
+static unsigned short query_id(const struct dns_query *q, int slot, int which){
+    return (unsigned short)((q -> gen << DNS_GEN_SHIFT) | (which << DNS_SLOT_BITS) | slot);
+}
+
+/* Put the unanswered queries of the slot on the wire under fresh ids. A
+ * send that fails is treated like a lost packet and retried when the
+ * timer runs out */
+static void send_query(dns_async *e, int slot){
+    struct dns_query *q = &e -> q[slot];
+    unsigned char *qtype = q -> packet + q -> len - 4;
+
+    q -> gen++;
+    for(int which = Q_A; which <= Q_AAAA; which++){
+        if(!(q -> outstanding & (1 << which))){
+            continue;
+        }
+        unsigned short id = query_id(q, slot, which);
+        q -> packet[0] = id >> 8;
+        q -> packet[1] = id & 0xff;
+        qtype[1] = (which == Q_A) ? DNS_TYPE_A : DNS_TYPE_AAAA;
+        send(e -> fd, q -> packet, q -> len, MSG_NOSIGNAL);
+    }
+    qtype[1] = DNS_TYPE_A;
+    timer_append(e, slot);
+}
+
+/* Hand the name back with whatever addresses arrived, IPv4 first */
+static void finish(dns_async *e, int slot){
+    struct dns_query *q = &e -> q[slot];
+    void *arg = q -> arg;
+    dns_addr_list list = q -> found[Q_A];
+
+    for(int i = 0; i < q -> found[Q_AAAA].count && list.count < UTIL_MAX_ADDRS; i++){
+        list.addrs[list.count++] = q -> found[Q_AAAA].addrs[i];
+    }
+    timer_unlink(e, slot);
+    q -> in_use = 0;
+    q -> next = e -> free_head;
+    e -> free_head = slot;
+    e -> inflight--;
+    e -> done(arg, list.count > 0 ? UTIL_SUCCESS : UTIL_FAILURE, &list, now_ns() - q -> submitted);
+}
+
+/* --- engine --- */
+
+dns_async *dns_async_new(int max_inflight, dns_async_done done){
+    dns_async *e;
+    struct epoll_event ev;
+    int rcvbuf = 1 << 20; // room for a burst of replies between polls
+
+    if(server_len == 0 || max_inflight < 1 || max_inflight > DNS_ASYNC_MAX_INFLIGHT){
+        return NULL;
+    }
+    if(!(e = calloc(1, sizeof(*e)))){
+        return NULL;
+    }
+    if(!(e -> q = calloc(max_inflight, sizeof(*e -> q)))){
+        free(e);
+        return NULL;
+    }
+    e -> max = max_inflight;
+    e -> done = done;
+    e -> epfd = -1;
+    e -> fd = socket(server_addr.ss_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if(e -> fd < 0 ||
+       connect(e -> fd, (struct sockaddr *)&server_addr, server_len) ||
+       (e -> epfd = epoll_create1(EPOLL_CLOEXEC)) < 0){
+        goto fail;
+    }
+    setsockopt(e -> fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    ev.events = EPOLLIN;
+    ev.data.fd = e -> fd;
+    if(epoll_ctl(e -> epfd, EPOLL_CTL_ADD, e -> fd, &ev)){
+        goto fail;
+    }
+    for(int i = 0; i < max_inflight; i++){
+        e -> q[i].next = (i + 1 < max_inflight) ? i + 1 : -1;
+    }
+    e -> free_head = 0;
+    for(int a = 0; a <= DNS_ASYNC_RETRIES; a++){
+        e -> head[a] = e -> tail[a] = -1;
+    }
+    return e;
+
+fail:
+    if(e -> fd >= 0){
+        close(e -> fd);
+    }
+    if(e -> epfd >= 0){
+        close(e -> epfd);
+    }
+    free(e -> q);
+    free(e);
+    return NULL;
+}
+
+int dns_async_submit(dns_async *e, const char *name, size_t len, void *arg){
+    int slot = e -> free_head;
+    struct dns_query *q;
+
+    if(slot < 0){
+        return -1;
+    }
+    q = &e -> q[slot];
+    if(!(q -> len = build_query(q -> packet, name, len))){
+        dns_addr_list none = { .count = 0 };
+        e -> done(arg, UTIL_FAILURE, &none, 0);
+        return 0;
+    }
+    e -> free_head = q -> next;
+    e -> inflight++;
+    q -> arg = arg;
+    q -> submitted = now_ns();
+    q -> attempt = 0;
+    q -> in_use = 1;
+    q -> outstanding = (1 << Q_A) | (1 << Q_AAAA);
+    q -> found[Q_A].count = 0;
+    q -> found[Q_AAAA].count = 0;
+    send_query(e, slot);
+    return 0;
+}
+
+/* Handle every reply waiting on the socket */
+static int drain_replies(dns_async *e){
+    unsigned char buf[DNS_MAX_REPLY];
+    int finished = 0;
+    ssize_t n;
+
+    for(;;){
+        n = recv(e -> fd, buf, sizeof(buf), 0);
+        if(n < 0){
+            if(errno == EINTR || errno == ECONNREFUSED){
+                continue; // refused: an earlier send hit a closed port
+            }
+            break; // EAGAIN, nothing left
+        }
+        if(n < DNS_HEADER_SIZE || !(buf[2] & 0x80)){
+            continue;
+        }
+        unsigned int id = get16(buf);
+        int slot = id & DNS_SLOT_MASK;
+        int which = (id >> DNS_SLOT_BITS) & 1;
+        if(slot >= e -> max){
+            continue;
+        }
+        struct dns_query *q = &e -> q[slot];
+        if(!q -> in_use || !(q -> outstanding & (1 << which)) ||
+           query_id(q, slot, which) != id || !same_question(buf, n, q, which)){
+            continue; // late reply to an earlier send, or not ours
+        }
+        q -> outstanding &= ~(1 << which);
+        if(parse_answer(buf, n, q, which, &q -> found[which]) == DNS_RCODE_NXDOMAIN){
+            /* the name does not exist, no point waiting for the other reply */
+            q -> found[Q_A].count = q -> found[Q_AAAA].count = 0;
+            q -> outstanding = 0;
+        }
+        if(!q -> outstanding){
+            finish(e, slot);
+            finished++;
+        }
+    }
+    return finished;
+}
+
+/* Resend or fail the queries whose timer ran out */
+static int expire(dns_async *e){
+    long long now = now_ms();
+    int finished = 0;
+
+    /* a resend moves to the next list, so walk them from the last one */
+    for(int a = DNS_ASYNC_RETRIES; a >= 0; a--){
+        int slot;
+        while((slot = e -> head[a]) >= 0 && e -> q[slot].deadline <= now){
+            if(a == DNS_ASYNC_RETRIES){
+                finish(e, slot); // with whichever half did get an answer
+                finished++;
+                continue;
+            }
+            timer_unlink(e, slot);
+            e -> q[slot].attempt++;
+            send_query(e, slot);
+        }
+    }
+    return finished;
+}
+
+int dns_async_poll(dns_async *e, int timeout_ms){
+    struct epoll_event ev;
+    long long now = now_ms();
+    int finished = 0;
+
+    /* wake up in time for the earliest deadline */
+    for(int a = 0; a <= DNS_ASYNC_RETRIES; a++){
+        if(e -> head[a] >= 0){
+            long long left = e -> q[e -> head[a]].deadline - now;
+            if(left < timeout_ms){
+                timeout_ms = left > 0 ? (int)left : 0;
+            }
+        }
+    }
+    if(epoll_wait(e -> epfd, &ev, 1, timeout_ms) > 0){
+        finished += drain_replies(e);
+    }
+    finished += expire(e);
+    return finished;
+}
+
+int dns_async_inflight(dns_async *e){
+    return e -> inflight;
+}
+
+int dns_async_room(dns_async *e){
+    return e -> max - e -> inflight;
+}
+
+void dns_async_free(dns_async *e){
+    for(int a = 0; a <= DNS_ASYNC_RETRIES; a++){
+        while(e -> head[a] >= 0){
+            finish(e, e -> head[a]);
+        }
+    }
+    close(e -> epfd);
+    close(e -> fd);
+    free(e -> q);
+    free(e);
+}
@@ -0,0 +1,69 @@
+/*
+ * File: dns_async.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Event-driven DNS resolver engine (-a/--async).
+ *
+ *      dnslookup() blocks in getaddrinfo(), so a resolver thread can only
+ *      ever wait on one name. Here every resolver thread owns an engine:
+ *      one non-blocking UDP socket connected to the name server and an
+ *      epoll set. The thread builds the queries itself, an A and an AAAA
+ *      query per name sent together, keeps up to DNS_ASYNC_MAX_INFLIGHT
+ *      names outstanding, matches replies by query id and question, and
+ *      resends whatever is unanswered when a name's timeout runs out
+ *      (doubling it each time) before giving up on the name.
+ *
+ *      A name's address list holds its IPv4 addresses, then its IPv6
+ *      ones, each in answer order. /etc/hosts is not consulted.
+ */
+
+#ifndef DNS_ASYNC_H
+#define DNS_ASYNC_H
+
+#include <stddef.h>
+#include "util.h"
+
+#define DNS_ASYNC_MAX_INFLIGHT 4096 // names per engine, fits the 12 id bits
+#define DNS_ASYNC_DEFAULT_INFLIGHT 256
+#define DNS_ASYNC_TIMEOUT_MS 1000    // first timeout, doubled per retry
+#define DNS_ASYNC_RETRIES 2          // resends before a name fails
+#define DNS_ASYNC_PORT 53
+
+typedef struct dns_async dns_async;
+
+/* Called once per submitted name with UTIL_SUCCESS and its addresses,
+ * or UTIL_FAILURE and an empty list, and how long the name took since
+ * dns_async_submit() */
+typedef void (*dns_async_done)(void *arg, int status, const dns_addr_list *list, long long elapsed_ns);
+
+/* Pick the name server every engine talks to: "ADDR" or "ADDR:PORT"
+ * ("[ADDR]:PORT" for IPv6), or NULL for the first nameserver in
+ * /etc/resolv.conf. Returns 0 on success, -1 on failure */
+int dns_async_set_server(const char *server);
+
+/* Printable form of the server in use */
+const char *dns_async_server_name(void);
+
+/* One engine per resolver thread, keeping up to max_inflight queries
+ * outstanding. Returns NULL on failure */
+dns_async *dns_async_new(int max_inflight, dns_async_done done);
+
+/* Queue a query for the len bytes at name. done runs from
+ * dns_async_poll(), or right away if the name cannot be asked for.
+ * Returns 0 once handed over, -1 if the engine is already full */
+int dns_async_submit(dns_async *e, const char *name, size_t len, void *arg);
+
+/* Wait up to timeout_ms for replies, then handle replies and expired
+ * queries. Returns how many queries finished */
+int dns_async_poll(dns_async *e, int timeout_ms);
+
+/* Queries submitted and not finished yet */
+int dns_async_inflight(dns_async *e);
+
+/* Free space for more queries */
+int dns_async_room(dns_async *e);
+
+/* Fails whatever is still outstanding and frees the engine */
+void dns_async_free(dns_async *e);
+
+#endif
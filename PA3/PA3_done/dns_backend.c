@@ -0,0 +1,228 @@
+/*
+ * File: dns_backend.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Resolver backends behind one lookup call. See dns_backend.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <stdint.h>
+#include "dns_backend.h"
+#include "host_table.h"
+
+
+struct backend {
+    const char *name;
+    int (*init)(const char *arg); // arg is what follows "name:", or NULL
+    int (*lookup)(const char *hostname, dns_addr_list *list);
+    void (*cleanup)(void);
+    void (*describe)(char *buf, size_t size, const char *arg);
+};
+
+/* FNV-1a, the hash dns_stub makes its answers from */
+static unsigned int name_hash(const char *name){
+    unsigned int h = 2166136261u;
+    for(const unsigned char *p = (const unsigned char *)name; *p; p++){
+        h = (h ^ *p) * 16777619u;
+    }
+    return h;
+}
+
+/* --- system: getaddrinfo() --- */
+
+static int system_lookup(const char *hostname, dns_addr_list *list){
+    return dnslookup_all(hostname, list);
+}
+
+/* --- hosts: hosts file, zone file or table image, see host_table.h --- */
+
+static host_table *hosts = NULL;
+
+static void hosts_describe(char *buf, size_t size, const char *path){
+    snprintf(buf, size, "hosts %s %s, %zu names", host_table_mapped(hosts) ? "image" : "file",
+             path ? path : DNS_BACKEND_HOSTS_FILE, host_table_count(hosts));
+}
+
+static void hosts_cleanup(void){
+    host_table_close(hosts);
+    hosts = NULL;
+}
+
+static int hosts_init(const char *path){
+    return (hosts = host_table_open(path ? path : DNS_BACKEND_HOSTS_FILE)) ? 0 : -1;
+}
+
+/* Read only once loaded, so resolvers share it without locking */
+static int hosts_lookup(const char *hostname, dns_addr_list *list){
+    if(host_table_lookup(hosts, hostname, list) != UTIL_SUCCESS){
+        list -> count = 0;
+        return UTIL_FAILURE;
+    }
+    return UTIL_SUCCESS;
+}
+
+/* --- fake: answers made up from the name, no I/O --- */
+
+static double fake_ms = 0;
+static double fake_fail = 0; // percent
+static int fake_exp = 0;
+static int fake_jitter = 0; // exponential delay drawn afresh on every lookup
+static __thread unsigned int jitter_seed;
+
+static int fake_init(const char *arg){
+    char *end;
+
+    if(!arg){
+        return 0;
+    }
+    fake_ms = strtod(arg, &end);
+    if(end == arg || fake_ms < 0){
+        return -1;
+    }
+    if(*end == ':'){
+        arg = end + 1;
+        fake_fail = strtod(arg, &end);
+        if(end == arg || fake_fail < 0 || fake_fail > 100){
+            return -1;
+        }
+    }
+    if(*end == ':'){
+        if(!strcmp(end + 1, "exp")){
+            fake_exp = 1;
+        }
+        else if(!strcmp(end + 1, "jitter")){
+            fake_jitter = 1;
+        }
+        else if(strcmp(end + 1, "fixed")){
+            return -1;
+        }
+        end += strlen(end);
+    }
+    return *end ? -1 : 0;
+}
+
+static void fake_describe(char *buf, size_t size, const char *arg){
+    (void)arg;
+    snprintf(buf, size, "fake, %g ms %s delay, %g%% failures", fake_ms,
+             fake_jitter ? "random exponential" : fake_exp ? "exponential" : "fixed", fake_fail);
+}
+
+static void fake_sleep(double ms){
+    struct timespec ts = { .tv_sec = (time_t)(ms / 1000) };
+
+    ts.tv_nsec = (long)((ms - ts.tv_sec * 1000.0) * 1000000);
+    while(nanosleep(&ts, &ts) && errno == EINTR){
+    }
+}
+
+static int fake_lookup(const char *hostname, dns_addr_list *list){
+    char name[NI_MAXHOST];
+    size_t len;
+    unsigned int h, mix;
+
+    list -> count = 0;
+    if(!dns_name_normalize(hostname, name, sizeof(name))){
+        return UTIL_FAILURE;
+    }
+    len = strlen(name);
+    h = name_hash(name);
+    /* independent bits for the delay and the failure draw */
+    mix = (h ^ (h >> 16)) * 0x45d9f3bu;
+    mix ^= mix >> 16;
+
+    if(fake_ms > 0 && fake_jitter){
+        if(!jitter_seed){
+            jitter_seed = (unsigned int)(uintptr_t)&jitter_seed ^ (unsigned int)time(NULL);
+        }
+        fake_sleep(-log((rand_r(&jitter_seed) + 0.5) / (RAND_MAX + 1.0)) * fake_ms);
+    }
+    else if(fake_ms > 0){
+        double u = ((mix & 0xffffff) + 0.5) / 16777216.0;
+        fake_sleep(fake_exp ? -log(u) * fake_ms : fake_ms);
+    }
+    if(!strncmp(name, "nx", 2) || (len >= 8 && !strcmp(name + len - 8, ".invalid")) || !strcmp(name, "invalid") ||
+       (mix >> 24) * 100.0 / 256 < fake_fail){
+        return UTIL_FAILURE;
+    }
+
+    dns_addr *v4 = &list -> addrs[list -> count++];
+    memset(v4, 0, sizeof(*v4));
+    v4 -> family = AF_INET;
+    if(!strcmp(name, "localhost")){
+        v4 -> bytes[0] = 127;
+        v4 -> bytes[3] = 1;
+    }
+    else{
+        v4 -> bytes[0] = 10;
+        v4 -> bytes[1] = h >> 16;
+        v4 -> bytes[2] = h >> 8;
+        v4 -> bytes[3] = h | 1;
+    }
+    if(strncmp(name, "v4", 2)){
+        dns_addr *v6 = &list -> addrs[list -> count++];
+        memset(v6, 0, sizeof(*v6));
+        v6 -> family = AF_INET6;
+        if(!strcmp(name, "localhost")){
+            v6 -> bytes[15] = 1;
+        }
+        else{
+            v6 -> bytes[0] = 0xfd;
+            memcpy(v6 -> bytes + 12, &h, 4);
+        }
+    }
+    return UTIL_SUCCESS;
+}
+
+/* --- selection --- */
+
+static const struct backend backends[] = {
+    {"system", NULL, system_lookup, NULL, NULL},
+    {"hosts", hosts_init, hosts_lookup, hosts_cleanup, hosts_describe},
+    {"fake", fake_init, fake_lookup, NULL, fake_describe},
+};
+
+static const struct backend *current = &backends[0];
+static char description[256] = DNS_BACKEND_DEFAULT;
+
+int dns_backend_select(const char *spec){
+    const char *colon = strchr(spec, ':');
+    size_t len = colon ? (size_t)(colon - spec) : strlen(spec);
+
+    for(size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++){
+        const struct backend *b = &backends[i];
+        if(strlen(b -> name) != len || strncmp(b -> name, spec, len)){
+            continue;
+        }
+        if(b -> init ? b -> init(colon ? colon + 1 : NULL) : (colon != NULL)){
+            return -1;
+        }
+        current = b;
+        if(b -> describe){
+            b -> describe(description, sizeof(description), colon ? colon + 1 : NULL);
+        }
+        else{
+            snprintf(description, sizeof(description), "%s", b -> name);
+        }
+        return 0;
+    }
+    return -1;
+}
+
+int dns_backend_lookup(const char *hostname, dns_addr_list *list){
+    return current -> lookup(hostname, list);
+}
+
+const char *dns_backend_name(void){
+    return description;
+}
+
+void dns_backend_cleanup(void){
+    if(current -> cleanup){
+        current -> cleanup();
+    }
+    current = &backends[0];
+}
@@ -0,0 +1,51 @@
+/*
+ * File: dns_backend.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Resolver backends behind one lookup call, picked at run time with
+ *      -B/--backend=SPEC:
+ *      system                        - getaddrinfo() through dnslookup_all()
+ *      hosts[:PATH]                  - names from a hosts file ("ADDR NAME
+ *                                      ALIAS...") or zone file lines ("NAME
+ *                                      [TTL] [IN] A|AAAA ADDR"), read once
+ *                                      at start, or a hosts_image image;
+ *                                      default /etc/hosts (host_table.h)
+ *      fake[:MS[:FAIL%[:fixed|exp|jitter]]]
+ *                                    - no I/O at all: every name gets
+ *                                      addresses made from a hash of it
+ *                                      after sleeping MS (fractions
+ *                                      allowed), and FAIL% of names fail.
+ *                                      With exp the sleep is exponential
+ *                                      around MS. Delay and failure depend
+ *                                      only on the name, so every run
+ *                                      sees the same ones. jitter draws
+ *                                      an exponential delay afresh on
+ *                                      every lookup instead, like a
+ *                                      network that is sometimes slow,
+ *                                      which is what -H can help with
+ *      The fake answers like dns_stub: localhost is 127.0.0.1 and ::1,
+ *      nx... and *.invalid fail, v4... names get no IPv6 address.
+ */
+
+#ifndef DNS_BACKEND_H
+#define DNS_BACKEND_H
+
+#include "util.h"
+
+#define DNS_BACKEND_DEFAULT "system"
+#define DNS_BACKEND_HOSTS_FILE "/etc/hosts"
+
+/* Set up the backend named by spec. Returns 0 on success, -1 if spec is
+ * unknown or malformed or the backend cannot start */
+int dns_backend_select(const char *spec);
+
+/* Same contract as dnslookup_all() in util.h, answered by the backend
+ * picked with dns_backend_select(), system if none was */
+int dns_backend_lookup(const char *hostname, dns_addr_list *list);
+
+/* Printable description of the backend in use */
+const char *dns_backend_name(void);
+
+void dns_backend_cleanup(void);
+
+#endif
@@ -0,0 +1,288 @@
+/*
+ * File: dns_cache.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Shared result cache in front of dnslookup_all(). See dns_cache.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <pthread.h>
+#include <time.h>
+#include "util.h"
+#include "dns_cache.h"
+
+struct cache_entry {
+    struct cache_entry *next;
+    unsigned int hash;
+    int pending; // lookup still in flight, wait on the shard's done
+    int status;  // UTIL_SUCCESS or UTIL_FAILURE
+    time_t expires; // monotonic seconds, looked up again from then on
+    dns_addr_list *addrs; // only DNS_ADDR_LIST_SIZE(count) bytes, NULL if there are none
+    char name[];
+};
+
+struct cache_shard {
+    _Alignas(64) pthread_mutex_t lock;
+    pthread_cond_t done;
+    struct cache_entry **buckets;
+    size_t num_buckets;
+    size_t count;
+    /* counted under lock */
+    unsigned long lookups;
+    unsigned long hits;
+    unsigned long coalesced;
+};
+
+static struct cache_shard shards[DNS_CACHE_SHARDS];
+static dns_lookup_fn miss_lookup = dnslookup_all;
+static int cache_ttl;
+
+static time_t now_s(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
+
+/* Record an answer in e. Called with the shard's lock held */
+static void entry_set(struct cache_entry *e, int status, dns_addr_list *addrs){
+    int ttl = (status == UTIL_SUCCESS || cache_ttl < DNS_CACHE_NEGATIVE_TTL) ? cache_ttl : DNS_CACHE_NEGATIVE_TTL;
+
+    free(e -> addrs);
+    e -> status = status;
+    e -> addrs = addrs;
+    e -> expires = now_s() + ttl;
+}
+
+static int entry_expired(const struct cache_entry *e){
+    return !e -> pending && now_s() >= e -> expires;
+}
+
+/* FNV-1a over the lower-cased name */
+static unsigned int name_hash(const char *name){
+    unsigned int h = 2166136261u;
+    for(const unsigned char *p = (const unsigned char *)name; *p; p++){
+        h ^= (unsigned int)tolower(*p);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Copy of the first list -> count addresses of list, NULL if there are none */
+static dns_addr_list *addrs_dup(const dns_addr_list *list){
+    dns_addr_list *copy;
+
+    if(list -> count == 0 || !(copy = malloc(DNS_ADDR_LIST_SIZE(list -> count)))){
+        return NULL;
+    }
+    memcpy(copy, list, DNS_ADDR_LIST_SIZE(list -> count));
+    return copy;
+}
+
+static void addrs_get(dns_addr_list *list, const struct cache_entry *e){
+    if(e -> addrs){
+        memcpy(list, e -> addrs, DNS_ADDR_LIST_SIZE(e -> addrs -> count));
+    }
+    else{
+        list -> count = 0;
+    }
+}
+
+/* Double the bucket array once the shard averages two entries per bucket */
+static void shard_grow(struct cache_shard *s){
+    size_t n = s -> num_buckets * 2;
+    struct cache_entry **b = calloc(n, sizeof(*b));
+    if(!b){
+        return; // keep the longer chains
+    }
+    for(size_t i = 0; i < s -> num_buckets; i++){
+        struct cache_entry *e = s -> buckets[i];
+        while(e){
+            struct cache_entry *next = e -> next;
+            e -> next = b[(e -> hash / DNS_CACHE_SHARDS) % n];
+            b[(e -> hash / DNS_CACHE_SHARDS) % n] = e;
+            e = next;
+        }
+    }
+    free(s -> buckets);
+    s -> buckets = b;
+    s -> num_buckets = n;
+}
+
+int dns_cache_init(dns_lookup_fn lookup, int ttl){
+    miss_lookup = lookup;
+    cache_ttl = ttl;
+    for(int i = 0; i < DNS_CACHE_SHARDS; i++){
+        struct cache_shard *s = &shards[i];
+        pthread_mutex_init(&s -> lock, NULL);
+        pthread_cond_init(&s -> done, NULL);
+        s -> buckets = calloc(DNS_CACHE_BUCKETS, sizeof(*s -> buckets));
+        if(!s -> buckets){
+            return -1;
+        }
+        s -> num_buckets = DNS_CACHE_BUCKETS;
+        s -> count = 0;
+        s -> lookups = s -> hits = s -> coalesced = 0;
+    }
+    return 0;
+}
+
+int dns_cache_lookup(const char *hostname, dns_addr_list *list){
+    unsigned int hash = name_hash(hostname);
+    struct cache_shard *s = &shards[hash % DNS_CACHE_SHARDS];
+    struct cache_entry *e;
+    size_t bucket;
+    int status;
+
+    pthread_mutex_lock(&s -> lock);
+    s -> lookups++;
+    bucket = (hash / DNS_CACHE_SHARDS) % s -> num_buckets;
+    for(e = s -> buckets[bucket]; e; e = e -> next){
+        if(e -> hash == hash && !strcasecmp(e -> name, hostname)){
+            break;
+        }
+    }
+    if(e && entry_expired(e)){
+        /* stale: this resolver looks it up again, others wait for it */
+        e -> pending = 1;
+        pthread_mutex_unlock(&s -> lock);
+    }
+    else if(e){
+        if(e -> pending){
+            /* somebody is already asking: wait for their answer */
+            s -> coalesced++;
+            while(e -> pending){
+                pthread_cond_wait(&s -> done, &s -> lock);
+            }
+        }
+        else{
+            s -> hits++;
+        }
+        status = e -> status;
+        addrs_get(list, e);
+        pthread_mutex_unlock(&s -> lock);
+        return status;
+    }
+    else{
+        /* first one to ask: publish a pending entry and do the lookup unlocked */
+        size_t len = strlen(hostname);
+        e = malloc(sizeof(*e) + len + 1);
+        if(!e){
+            pthread_mutex_unlock(&s -> lock);
+            return miss_lookup(hostname, list);
+        }
+        memcpy(e -> name, hostname, len + 1);
+        e -> hash = hash;
+        e -> pending = 1;
+        e -> status = UTIL_FAILURE;
+        e -> addrs = NULL;
+        e -> next = s -> buckets[bucket];
+        s -> buckets[bucket] = e;
+        if(++s -> count > s -> num_buckets * 2){
+            shard_grow(s);
+        }
+        pthread_mutex_unlock(&s -> lock);
+    }
+
+    status = miss_lookup(hostname, list);
+    dns_addr_list *addrs = addrs_dup(list);
+
+    pthread_mutex_lock(&s -> lock);
+    entry_set(e, status, addrs);
+    e -> pending = 0;
+    pthread_cond_broadcast(&s -> done);
+    pthread_mutex_unlock(&s -> lock);
+    return status;
+}
+
+/* Entry for hostname in s, NULL if there is none. Called with s -> lock held */
+static struct cache_entry *shard_find(struct cache_shard *s, unsigned int hash, const char *hostname){
+    struct cache_entry *e = s -> buckets[(hash / DNS_CACHE_SHARDS) % s -> num_buckets];
+    while(e && (e -> hash != hash || strcasecmp(e -> name, hostname))){
+        e = e -> next;
+    }
+    return e;
+}
+
+int dns_cache_peek(const char *hostname, dns_addr_list *list){
+    unsigned int hash = name_hash(hostname);
+    struct cache_shard *s = &shards[hash % DNS_CACHE_SHARDS];
+    struct cache_entry *e;
+    int status = DNS_CACHE_MISS;
+
+    pthread_mutex_lock(&s -> lock);
+    s -> lookups++;
+    if((e = shard_find(s, hash, hostname)) != NULL && !e -> pending && !entry_expired(e)){
+        s -> hits++;
+        status = e -> status;
+        addrs_get(list, e);
+    }
+    pthread_mutex_unlock(&s -> lock);
+    return status;
+}
+
+void dns_cache_insert(const char *hostname, int status, const dns_addr_list *list){
+    unsigned int hash = name_hash(hostname);
+    struct cache_shard *s = &shards[hash % DNS_CACHE_SHARDS];
+    struct cache_entry *e;
+    size_t len = strlen(hostname);
+
+    pthread_mutex_lock(&s -> lock);
+    if((e = shard_find(s, hash, hostname)) != NULL){
+        if(entry_expired(e)){
+            entry_set(e, status, addrs_dup(list));
+        }
+    }
+    else if((e = malloc(sizeof(*e) + len + 1)) != NULL){
+        size_t bucket = (hash / DNS_CACHE_SHARDS) % s -> num_buckets;
+        memcpy(e -> name, hostname, len + 1);
+        e -> hash = hash;
+        e -> pending = 0;
+        e -> addrs = NULL;
+        entry_set(e, status, addrs_dup(list));
+        e -> next = s -> buckets[bucket];
+        s -> buckets[bucket] = e;
+        if(++s -> count > s -> num_buckets * 2){
+            shard_grow(s);
+        }
+    }
+    pthread_mutex_unlock(&s -> lock);
+}
+
+void dns_cache_report(FILE *out){
+    unsigned long lookups = 0, hits = 0, coalesced = 0;
+
+    for(int i = 0; i < DNS_CACHE_SHARDS; i++){
+        pthread_mutex_lock(&shards[i].lock);
+        lookups += shards[i].lookups;
+        hits += shards[i].hits;
+        coalesced += shards[i].coalesced;
+        pthread_mutex_unlock(&shards[i].lock);
+    }
+    fprintf(out, "DNS cache: %lu lookups, %lu hits (%.1f%%), %lu coalesced (%.1f%%), %lu sent\n",
+            lookups,
+            hits, lookups ? 100.0 * hits / lookups : 0.0,
+            coalesced, lookups ? 100.0 * coalesced / lookups : 0.0,
+            lookups - hits - coalesced);
+}
+
+void dns_cache_cleanup(void){
+    for(int i = 0; i < DNS_CACHE_SHARDS; i++){
+        struct cache_shard *s = &shards[i];
+        for(size_t b = 0; b < s -> num_buckets; b++){
+            struct cache_entry *e = s -> buckets[b];
+            while(e){
+                struct cache_entry *next = e -> next;
+                free(e -> addrs);
+                free(e);
+                e = next;
+            }
+        }
+        free(s -> buckets);
+        s -> buckets = NULL;
+        pthread_mutex_destroy(&s -> lock);
+        pthread_cond_destroy(&s -> done);
+    }
+}
@@ -0,0 +1,52 @@
+/*
+ * File: dns_cache.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Shared result cache in front of dnslookup_all().
+ *
+ *      Hostnames are spread over DNS_CACHE_SHARDS independently locked
+ *      hash tables. The first resolver to ask for a name does the real
+ *      lookup; resolvers asking for the same name while it is in flight
+ *      wait for that answer instead of issuing their own, and everybody
+ *      after that gets the cached answer until it is ttl seconds old (-T),
+ *      when the next resolver to ask looks it up again. Failed lookups
+ *      are cached too, for at most DNS_CACHE_NEGATIVE_TTL, so a dead name
+ *      is not asked for over and over while a long-lived daemon (-L)
+ *      still retries a failure that was only passing.
+ */
+
+#ifndef DNS_CACHE_H
+#define DNS_CACHE_H
+
+#include <stdio.h>
+#include "util.h"
+
+#define DNS_CACHE_SHARDS 64
+#define DNS_CACHE_BUCKETS 1024 // initial buckets per shard, doubles as it fills
+#define DNS_CACHE_MISS 1
+#define DNS_CACHE_NEGATIVE_TTL 300 // seconds, cap for failed lookups
+
+/* Signature of dnslookup_all() in util.h */
+typedef int (*dns_lookup_fn)(const char *hostname, dns_addr_list *list);
+
+/* lookup answers the names that are not cached yet or have expired, and
+ * answers are kept for ttl seconds */
+int dns_cache_init(dns_lookup_fn lookup, int ttl);
+
+/* Same contract as dnslookup_all() in util.h, answered from the cache
+ * when possible. Names are compared case-insensitively */
+int dns_cache_lookup(const char *hostname, dns_addr_list *list);
+
+/* Non-blocking halves of dns_cache_lookup for resolvers that send their
+ * own queries (-a). dns_cache_peek answers from a finished entry and
+ * returns DNS_CACHE_MISS otherwise; nothing is coalesced, so two resolvers
+ * may both ask for a name. dns_cache_insert records the answer */
+int dns_cache_peek(const char *hostname, dns_addr_list *list);
+void dns_cache_insert(const char *hostname, int status, const dns_addr_list *list);
+
+/* Print lookups, hit and coalescing rates */
+void dns_cache_report(FILE *out);
+
+void dns_cache_cleanup(void);
+
+#endif
@@ -0,0 +1,227 @@
+/*
+ * File: dns_store.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Persistent lookup cache shared between runs and processes.
+ *      See dns_store.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "util.h"
+#include "dns_store.h"
+
+#define READ_RETRIES 4
+
+static struct dns_store_header *header = NULL;
+static struct dns_store_slot *slots = NULL;
+static size_t map_len = 0;
+static int store_ttl = DNS_STORE_DEFAULT_TTL;
+
+static atomic_ulong store_hits;
+static atomic_ulong store_misses;
+static atomic_ulong store_expired;
+
+/* 64 bit FNV-1a over the lower-cased name */
+static uint64_t name_hash(const char *name, size_t *len){
+    uint64_t h = 14695981039346656037ULL;
+    const unsigned char *p = (const unsigned char *)name;
+    for(; *p; p++){
+        h ^= (uint64_t)tolower(*p);
+        h *= 1099511628211ULL;
+    }
+    *len = (size_t)(p - (const unsigned char *)name);
+    return h ? h : 1;
+}
+
+static struct dns_store_slot *probe_slot(uint64_t hash, int i){
+    return &slots[(hash + (uint64_t)i) % header -> num_slots];
+}
+
+/* Take a consistent copy of slot into copy. Returns 0 if a writer kept
+ * getting in the way */
+static int slot_read(struct dns_store_slot *slot, struct dns_store_slot *copy){
+    for(int tries = 0; tries < READ_RETRIES; tries++){
+        unsigned int before = atomic_load_explicit(&slot -> seq, memory_order_acquire);
+        if(before & 1){
+            continue;
+        }
+        copy -> name_len = slot -> name_len;
+        copy -> hash = slot -> hash;
+        copy -> expires = slot -> expires;
+        copy -> status = slot -> status;
+        copy -> num_addrs = slot -> num_addrs;
+        memcpy(copy -> addrs, slot -> addrs, sizeof(copy -> addrs));
+        if(copy -> name_len <= DNS_STORE_NAME_MAX){
+            memcpy(copy -> name, slot -> name, copy -> name_len);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        if(atomic_load_explicit(&slot -> seq, memory_order_relaxed) == before){
+            if(copy -> name_len > DNS_STORE_NAME_MAX ||
+               copy -> num_addrs < 0 || copy -> num_addrs > DNS_STORE_ADDRS){
+                return 0;
+            }
+            copy -> name[copy -> name_len] = '\0';
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int dns_store_open(const char *path, int ttl){
+    struct dns_store_header fresh;
+    struct stat st;
+    void *base;
+    int fd;
+
+    store_ttl = ttl;
+    if((fd = open(path, O_RDWR | O_CREAT, 0644)) < 0){
+        perror("Error to open cache file");
+        return -1;
+    }
+    /* only one process lays out a new file */
+    flock(fd, LOCK_EX);
+    if(fstat(fd, &st)){
+        goto fail;
+    }
+    if(st.st_size == 0){
+        memset(&fresh, 0, sizeof(fresh));
+        memcpy(fresh.magic, DNS_STORE_MAGIC, sizeof(fresh.magic));
+        fresh.num_slots = DNS_STORE_SLOTS;
+        fresh.slot_size = sizeof(struct dns_store_slot);
+        /* the slots stay sparse and zero (empty) until used */
+        if(ftruncate(fd, sizeof(struct dns_store_slot) * ((off_t)DNS_STORE_SLOTS + 1)) ||
+           pwrite(fd, &fresh, sizeof(fresh), 0) != (ssize_t)sizeof(fresh)){
+            goto fail;
+        }
+    }
+    else if(pread(fd, &fresh, sizeof(fresh), 0) != (ssize_t)sizeof(fresh) ||
+            memcmp(fresh.magic, DNS_STORE_MAGIC, sizeof(fresh.magic)) ||
+            fresh.slot_size != sizeof(struct dns_store_slot) || fresh.num_slots == 0 ||
+            st.st_size < (off_t)sizeof(struct dns_store_slot) * ((off_t)fresh.num_slots + 1)){
+        fprintf(stderr, "%s is not a multi-lookup cache file\n", path);
+        goto fail;
+    }
+    flock(fd, LOCK_UN);
+
+    /* slot 0 holds the header, the table starts one slot in */
+    map_len = sizeof(struct dns_store_slot) * ((size_t)fresh.num_slots + 1);
+    base = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if(base == MAP_FAILED){
+        perror("Error to map cache file");
+        return -1;
+    }
+    header = base;
+    slots = (struct dns_store_slot *)base + 1;
+    return 0;
+
+fail:
+    flock(fd, LOCK_UN);
+    close(fd);
+    return -1;
+}
+
+int dns_store_lookup(const char *hostname, dns_addr_list *list){
+    struct dns_store_slot copy;
+    size_t len;
+    uint64_t hash = name_hash(hostname, &len);
+    int64_t now = (int64_t)time(NULL);
+
+    if(len > DNS_STORE_NAME_MAX){
+        atomic_fetch_add(&store_misses, 1);
+        return DNS_STORE_MISS;
+    }
+    for(int i = 0; i < DNS_STORE_PROBE; i++){
+        if(!slot_read(probe_slot(hash, i), &copy)){
+            continue;
+        }
+        if(copy.name_len == 0){
+            break; // never used: the name would have been stored here
+        }
+        if(copy.hash != hash || copy.name_len != len || strcasecmp(copy.name, hostname)){
+            continue;
+        }
+        if(copy.expires <= now){
+            atomic_fetch_add(&store_expired, 1);
+            return DNS_STORE_MISS;
+        }
+        atomic_fetch_add(&store_hits, 1);
+        list -> count = copy.num_addrs;
+        memcpy(list -> addrs, copy.addrs, sizeof(dns_addr) * copy.num_addrs);
+        return copy.status;
+    }
+    atomic_fetch_add(&store_misses, 1);
+    return DNS_STORE_MISS;
+}
+
+void dns_store_insert(const char *hostname, int status, const dns_addr_list *list){
+    struct dns_store_slot copy;
+    struct dns_store_slot *victim = NULL;
+    int64_t oldest = INT64_MAX;
+    int64_t now = (int64_t)time(NULL);
+    size_t len;
+    uint64_t hash = name_hash(hostname, &len);
+
+    if(len > DNS_STORE_NAME_MAX){
+        return;
+    }
+    /* same name, else a free or stale slot, else the one expiring first */
+    for(int i = 0; i < DNS_STORE_PROBE; i++){
+        struct dns_store_slot *slot = probe_slot(hash, i);
+        if(!slot_read(slot, &copy)){
+            continue;
+        }
+        if(copy.name_len == 0 || copy.expires <= now ||
+           (copy.hash == hash && copy.name_len == len && !strcasecmp(copy.name, hostname))){
+            victim = slot;
+            break;
+        }
+        if(copy.expires < oldest){
+            oldest = copy.expires;
+            victim = slot;
+        }
+    }
+    if(!victim){
+        return;
+    }
+
+    unsigned int seq = atomic_load_explicit(&victim -> seq, memory_order_relaxed);
+    if((seq & 1) || !atomic_compare_exchange_strong(&victim -> seq, &seq, seq + 1)){
+        return; // another writer has it, its answer is as good as ours
+    }
+    int ttl = store_ttl;
+    if(status != UTIL_SUCCESS && ttl > DNS_STORE_NEGATIVE_TTL){
+        ttl = DNS_STORE_NEGATIVE_TTL;
+    }
+    victim -> name_len = (uint32_t)len;
+    victim -> hash = hash;
+    victim -> expires = now + ttl;
+    victim -> status = status;
+    victim -> num_addrs = list -> count < DNS_STORE_ADDRS ? list -> count : DNS_STORE_ADDRS;
+    memset(victim -> addrs, 0, sizeof(victim -> addrs));
+    memcpy(victim -> addrs, list -> addrs, sizeof(dns_addr) * victim -> num_addrs);
+    memcpy(victim -> name, hostname, len + 1);
+    atomic_store_explicit(&victim -> seq, seq + 2, memory_order_release);
+}
+
+void dns_store_report(FILE *out){
+    fprintf(out, "Cache file: %lu hits, %lu misses, %lu expired\n",
+            atomic_load(&store_hits), atomic_load(&store_misses), atomic_load(&store_expired));
+}
+
+void dns_store_close(void){
+    if(header){
+        munmap(header, map_len);
+        header = NULL;
+        slots = NULL;
+    }
+}
@@ -0,0 +1,69 @@
+/*
+ * File: dns_store.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Persistent lookup cache shared between runs and processes.
+ *
+ *      The cache file is a fixed-size open addressing table that every
+ *      multi-lookup process maps MAP_SHARED. Each slot holds one
+ *      hostname, its answer and the time the answer expires, and is
+ *      guarded by its own sequence counter: writers move it to odd while
+ *      they fill the slot, readers retry or give up if it changed under
+ *      them. No process ever blocks another, and a run started an hour
+ *      later answers every unexpired name without a lookup.
+ *
+ *      getaddrinfo() does not report record TTLs, so answers live for a
+ *      configured time (failures for at most DNS_STORE_NEGATIVE_TTL).
+ */
+
+#ifndef DNS_STORE_H
+#define DNS_STORE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include "util.h"
+
+#define DNS_STORE_MAGIC "MLCACHE2"
+#define DNS_STORE_SLOTS (1 << 18)      // slots in a newly created file
+#define DNS_STORE_PROBE 16             // slots searched per name
+#define DNS_STORE_NAME_MAX 255         // longer names are not stored
+#define DNS_STORE_ADDRS 8              // addresses kept per name
+#define DNS_STORE_DEFAULT_TTL 3600     // seconds
+#define DNS_STORE_NEGATIVE_TTL 300     // seconds, cap for failed lookups
+#define DNS_STORE_MISS 1
+
+struct dns_store_slot {
+    atomic_uint seq;  // odd while a writer is filling the slot
+    uint32_t name_len; // 0 = never used
+    uint64_t hash;
+    int64_t expires;  // time(NULL) after which the answer is stale
+    int32_t status;   // UTIL_SUCCESS or UTIL_FAILURE
+    int32_t num_addrs;
+    dns_addr addrs[DNS_STORE_ADDRS];
+    char name[DNS_STORE_NAME_MAX + 1];
+};
+
+struct dns_store_header {
+    char magic[8];
+    uint32_t num_slots;
+    uint32_t slot_size;
+};
+
+/* Map the cache file at path, creating it if needed.
+ * Returns 0 on success, -1 on failure */
+int dns_store_open(const char *path, int ttl);
+
+/* Same contract as dnslookup_all() in util.h. Returns UTIL_SUCCESS or
+ * UTIL_FAILURE for an unexpired answer, DNS_STORE_MISS otherwise */
+int dns_store_lookup(const char *hostname, dns_addr_list *list);
+
+/* Record the answer of a real lookup, its first DNS_STORE_ADDRS addresses */
+void dns_store_insert(const char *hostname, int status, const dns_addr_list *list);
+
+/* Print hits, misses and expired entries */
+void dns_store_report(FILE *out);
+
+void dns_store_close(void);
+
+#endif
@@ -0,0 +1,318 @@
+/*
+ * File: dns_stub.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Local stand-in name server for trying out multi-lookup -a without
+ *      sending the load to a real resolver.
+ *
+ *      Answers A and AAAA queries over UDP on 127.0.0.1:
+ *      localhost                      - 127.0.0.1 and ::1
+ *      names ending in .invalid or
+ *      whose first label starts "nx"  - NXDOMAIN
+ *      names whose first label
+ *      starts "v4"                    - IPv4 only
+ *      anything else                  - a 10.x.y.z and a fd00::/8 address
+ *                                       made from a hash of the name, so
+ *                                       the same name always gets the
+ *                                       same answer
+ *      Other query types get an empty NOERROR answer.
+ *
+ *      -d holds every reply back to stand in for network and upstream
+ *      latency, -D picks how the hold time is spread around that mean:
+ *      fixed      - exactly -d ms
+ *      uniform    - anywhere from 0 to twice -d
+ *      exp        - exponential, many quick answers and a long tail
+ *      pareto     - heavy tail (alpha 2.5), a few answers take many times
+ *                   the mean
+ *      -l drops that percentage of queries to exercise timeouts and
+ *      retries, -S seeds the random numbers so runs can be repeated.
+ *
+ *      ./dns_stub [-p port] [-d delay ms] [-D fixed|uniform|exp|pareto] [-l loss percent] [-S seed]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define STUB_DEFAULT_PORT 5353
+#define STUB_MAX_PACKET 512
+#define STUB_HELD_REPLIES 16384 // replies waiting out -d, beyond that they are dropped
+#define STUB_USAGE "[-p port] [-d delay ms] [-D fixed|uniform|exp|pareto] [-l loss percent] [-S seed]"
+
+enum { DELAY_FIXED, DELAY_UNIFORM, DELAY_EXP, DELAY_PARETO };
+static const char *delay_names[] = { "fixed", "uniform", "exp", "pareto" };
+
+struct held_reply {
+    long long due; // ms, CLOCK_MONOTONIC
+    struct sockaddr_in to;
+    size_t len;
+    unsigned char packet[STUB_MAX_PACKET];
+};
+
+/* min-heap on due: with a spread of delays replies leave out of order */
+static struct held_reply *held;
+static int held_count = 0;
+static volatile sig_atomic_t stop = 0;
+
+static long long now_ms(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void on_signal(int sig){
+    (void)sig;
+    stop = 1;
+}
+
+/* Question name as dotted text, returns the offset past it or 0 */
+static size_t read_qname(const unsigned char *p, size_t n, char *name, size_t size){
+    size_t pos = 12, out = 0;
+
+    while(pos < n && p[pos] != 0){
+        size_t len = p[pos++];
+        if(len > 63 || pos + len > n || out + len + 2 > size){
+            return 0;
+        }
+        if(out){
+            name[out++] = '.';
+        }
+        for(size_t i = 0; i < len; i++){
+            name[out++] = tolower(p[pos + i]);
+        }
+        pos += len;
+    }
+    name[out] = '\0';
+    return pos < n ? pos + 1 : 0;
+}
+
+/* Fill reply in place over the query, returns its length or 0 to ignore */
+static size_t answer(unsigned char *p, size_t n){
+    char name[256] = "";
+    size_t end = read_qname(p, n, name, sizeof(name));
+    size_t len = strlen(name);
+
+    if(n < 12 || (p[2] & 0x80) || p[4] != 0 || p[5] != 1 || !end || end + 4 > n){
+        return 0;
+    }
+    unsigned int qtype = (p[end] << 8) | p[end + 1];
+    end += 4;
+
+    p[2] = 0x80 | (p[2] & 0x01) | 0x04; // QR, keep RD, AA
+    p[3] = 0x80;                          // RA, NOERROR
+    memset(p + 6, 0, 6);                  // no answer, authority or additional yet
+
+    if(!strncmp(name, "nx", 2) ||
+       (len >= 8 && !strcmp(name + len - 8, ".invalid")) || !strcmp(name, "invalid")){
+        p[3] |= 3; // NXDOMAIN
+        return end;
+    }
+    if(qtype != 1 && (qtype != 28 || !strncmp(name, "v4", 2))){
+        return end;
+    }
+
+    unsigned int h = 2166136261u;
+    for(size_t i = 0; i < len; i++){
+        h = (h ^ (unsigned char)name[i]) * 16777619u;
+    }
+    unsigned char addr[16] = {0};
+    size_t size = (qtype == 1) ? 4 : 16;
+    if(!strcmp(name, "localhost")){
+        if(qtype == 1){
+            addr[0] = 127;
+        }
+        addr[size - 1] = 1;
+    }
+    else if(qtype == 1){
+        addr[0] = 10;
+        addr[1] = h >> 16;
+        addr[2] = h >> 8;
+        addr[3] = h | 1;
+    }
+    else{
+        addr[0] = 0xfd;
+        memcpy(addr + 12, &h, 4);
+    }
+    unsigned char rr[12] = {
+        0xc0, 0x0c,       // name: pointer to the question
+        0, qtype, 0, 1,   // A or AAAA, IN
+        0, 0, 0x01, 0x2c, // TTL 300
+        0, size
+    };
+    memcpy(p + end, rr, sizeof(rr));
+    memcpy(p + end + sizeof(rr), addr, size);
+    p[7] = 1; // ANCOUNT
+    return end + sizeof(rr) + size;
+}
+
+/* Hold time in ms for one reply, spread around mean as -D asks */
+static long long pick_delay(int dist, int mean){
+    double u = (rand() + 1.0) / ((double)RAND_MAX + 2.0); // (0, 1)
+
+    switch(dist){
+    case DELAY_UNIFORM:
+        return (long long)(u * 2 * mean);
+    case DELAY_EXP:
+        return (long long)(-log(u) * mean);
+    case DELAY_PARETO:
+        /* minimum chosen so the mean comes out at mean */
+        return (long long)(mean * 0.6 / pow(u, 1 / 2.5));
+    default:
+        return mean;
+    }
+}
+
+static void held_swap(int a, int b){
+    struct held_reply t = held[a];
+    held[a] = held[b];
+    held[b] = t;
+}
+
+static void held_push(const struct held_reply *r){
+    int i = held_count++;
+
+    held[i] = *r;
+    while(i > 0 && held[(i - 1) / 2].due > held[i].due){
+        held_swap(i, (i - 1) / 2);
+        i = (i - 1) / 2;
+    }
+}
+
+static void held_pop(void){
+    int i = 0;
+
+    held[0] = held[--held_count];
+    for(;;){
+        int least = i, l = 2 * i + 1, r = l + 1;
+        if(l < held_count && held[l].due < held[least].due){
+            least = l;
+        }
+        if(r < held_count && held[r].due < held[least].due){
+            least = r;
+        }
+        if(least == i){
+            return;
+        }
+        held_swap(i, least);
+        i = least;
+    }
+}
+
+/* Send every held reply that is due, returns ms until the next one or -1 */
+static int flush_held(int fd){
+    long long now = now_ms();
+
+    while(held_count > 0){
+        struct held_reply *r = &held[0];
+        if(r -> due > now){
+            return (int)(r -> due - now);
+        }
+        sendto(fd, r -> packet, r -> len, 0, (struct sockaddr *)&r -> to, sizeof(r -> to));
+        held_pop();
+    }
+    return -1;
+}
+
+int main(int argc, char *argv[]){
+    int port = STUB_DEFAULT_PORT, delay = 0, loss = 0, dist = DELAY_FIXED;
+    unsigned int seed = time(NULL);
+    unsigned long queries = 0, dropped = 0;
+    struct sockaddr_in addr;
+    int opt, fd;
+
+    while((opt = getopt(argc, argv, "p:d:D:l:S:")) != -1){
+        switch(opt){
+        case 'p':
+            port = atoi(optarg);
+            break;
+        case 'd':
+            delay = atoi(optarg);
+            break;
+        case 'D':
+            for(dist = 0; dist <= DELAY_PARETO && strcmp(optarg, delay_names[dist]); dist++){
+            }
+            if(dist > DELAY_PARETO){
+                fprintf(stderr, "Unknown delay distribution %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'l':
+            loss = atoi(optarg);
+            break;
+        case 'S':
+            seed = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            fprintf(stderr, "USAGE: \n %s %s\n", argv[0], STUB_USAGE);
+            return EXIT_FAILURE;
+        }
+    }
+    if(!(held = malloc(sizeof(*held) * STUB_HELD_REPLIES))){
+        perror("Error to allocate reply buffer");
+        return EXIT_FAILURE;
+    }
+    if((fd = socket(AF_INET, SOCK_DGRAM, 0)) < 0){
+        perror("Error to create socket");
+        return EXIT_FAILURE;
+    }
+    int rcvbuf = 4 << 20;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if(bind(fd, (struct sockaddr *)&addr, sizeof(addr))){
+        perror("Error to bind");
+        return EXIT_FAILURE;
+    }
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+    srand(seed);
+    printf("Answering on 127.0.0.1:%d, delay %d ms (%s), loss %d%%\n", port, delay, delay_names[dist], loss);
+    fflush(stdout);
+
+    while(!stop){
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int wait = flush_held(fd);
+
+        if(poll(&pfd, 1, wait) <= 0){
+            continue;
+        }
+        for(;;){
+            struct held_reply r;
+            socklen_t tolen = sizeof(r.to);
+            ssize_t n = recvfrom(fd, r.packet, sizeof(r.packet), MSG_DONTWAIT,
+                                 (struct sockaddr *)&r.to, &tolen);
+            if(n < 0){
+                break;
+            }
+            queries++;
+            if((loss > 0 && rand() % 100 < loss) || !(r.len = answer(r.packet, n)) ||
+               (delay > 0 && held_count == STUB_HELD_REPLIES)){
+                dropped++;
+                continue;
+            }
+            if(delay > 0){
+                r.due = now_ms() + pick_delay(dist, delay);
+                held_push(&r);
+            }
+            else{
+                sendto(fd, r.packet, r.len, 0, (struct sockaddr *)&r.to, tolen);
+            }
+        }
+    }
+    printf("%lu queries, %lu dropped\n", queries, dropped);
+    free(held);
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,270 @@
+/*
+ * File: hedge.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Hedged lookups against slow names. See hedge.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include "hedge.h"
+
+struct hedge_task;
+
+/* one lookup of a task for a helper: the first one, or the hedge */
+struct hedge_job {
+    struct hedge_job *next;
+    struct hedge_task *task;
+    int hedge;
+};
+
+struct hedge_task {
+    atomic_int refs; // the resolver and every helper that has a job of it
+    pthread_mutex_t lock;
+    pthread_cond_t answered;
+    int done, status, by_hedge; // under lock
+    dns_addr_list list;
+    struct hedge_job jobs[2];
+    char name[NI_MAXHOST];
+};
+
+static int (*hedge_backend)(const char *hostname, dns_addr_list *list);
+static double hedge_pct, hedge_budget;
+static pthread_condattr_t monotonic;
+
+/* helpers and the jobs waiting for them, under helpers_lock */
+static pthread_mutex_t helpers_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t have_job = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t helpers_gone = PTHREAD_COND_INITIALIZER;
+static struct hedge_job *jobs_first = NULL, *jobs_last = NULL;
+static int queued = 0, idle = 0, helpers = 0, stopping = 0;
+
+/* recent lookup times and the threshold made from them */
+static atomic_llong window[HEDGE_WINDOW];
+static atomic_llong samples;
+static atomic_llong threshold_ns; // 0 until HEDGE_MIN_SAMPLES
+static pthread_mutex_t recompute_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static atomic_long lookups, hedges, hedge_wins, over_budget;
+
+static long long now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int compare_ns(const void *a, const void *b){
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static void task_release(struct hedge_task *t){
+    if(atomic_fetch_sub(&t -> refs, 1) == 1){
+        pthread_mutex_destroy(&t -> lock);
+        pthread_cond_destroy(&t -> answered);
+        free(t);
+    }
+}
+
+static void run_job(struct hedge_job *job){
+    struct hedge_task *t = job -> task;
+    dns_addr_list list;
+    int status = hedge_backend(t -> name, &list);
+
+    pthread_mutex_lock(&t -> lock);
+    if(!t -> done){
+        t -> done = 1;
+        t -> status = status;
+        t -> by_hedge = job -> hedge;
+        memcpy(&t -> list, &list, DNS_ADDR_LIST_SIZE(status == UTIL_SUCCESS ? list.count : 0));
+        if(status != UTIL_SUCCESS){
+            t -> list.count = 0;
+        }
+        pthread_cond_signal(&t -> answered);
+    }
+    pthread_mutex_unlock(&t -> lock);
+    task_release(t);
+}
+
+static void *helper_main(void *unused){
+    (void)unused;
+    pthread_mutex_lock(&helpers_lock);
+    for(;;){
+        struct hedge_job *job;
+
+        while(!jobs_first && !stopping){
+            idle++;
+            pthread_cond_wait(&have_job, &helpers_lock);
+            idle--;
+        }
+        if(!(job = jobs_first)){
+            break; // stopping
+        }
+        if(!(jobs_first = job -> next)){
+            jobs_last = NULL;
+        }
+        queued--;
+        pthread_mutex_unlock(&helpers_lock);
+        run_job(job);
+        pthread_mutex_lock(&helpers_lock);
+    }
+    if(--helpers == 0){
+        pthread_cond_broadcast(&helpers_gone);
+    }
+    pthread_mutex_unlock(&helpers_lock);
+    return NULL;
+}
+
+/* Give job to a helper, starting one if every helper is busy. Returns
+ * -1 without queueing it if none is idle and no more can be started */
+static int submit(struct hedge_job *job){
+    pthread_mutex_lock(&helpers_lock);
+    if(queued >= idle){
+        pthread_t tid;
+        pthread_attr_t attr;
+        int started = 0;
+
+        if(helpers < HEDGE_MAX_HELPERS){
+            pthread_attr_init(&attr);
+            pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+            pthread_attr_setstacksize(&attr, HEDGE_STACK_SIZE);
+            if(!pthread_create(&tid, &attr, helper_main, NULL)){
+                helpers++;
+                started = 1;
+            }
+            pthread_attr_destroy(&attr);
+        }
+        if(!started){
+            pthread_mutex_unlock(&helpers_lock);
+            return -1;
+        }
+    }
+    job -> next = NULL;
+    if(jobs_last){
+        jobs_last -> next = job;
+    }
+    else{
+        jobs_first = job;
+    }
+    jobs_last = job;
+    queued++;
+    pthread_cond_signal(&have_job);
+    pthread_mutex_unlock(&helpers_lock);
+    return 0;
+}
+
+/* Add one lookup time; every HEDGE_RECOMPUTE of them the threshold moves */
+static void record(long long ns){
+    long long n = atomic_fetch_add(&samples, 1) + 1;
+    static long long sorted[HEDGE_WINDOW]; // under recompute_lock
+
+    atomic_store_explicit(&window[(n - 1) % HEDGE_WINDOW], ns, memory_order_relaxed);
+    if(n < HEDGE_MIN_SAMPLES || n % HEDGE_RECOMPUTE || pthread_mutex_trylock(&recompute_lock)){
+        return;
+    }
+    int count = (n < HEDGE_WINDOW) ? (int)n : HEDGE_WINDOW;
+    for(int i = 0; i < count; i++){
+        sorted[i] = atomic_load_explicit(&window[i], memory_order_relaxed);
+    }
+    qsort(sorted, count, sizeof(sorted[0]), compare_ns);
+    atomic_store(&threshold_ns, sorted[(int)((count - 1) * hedge_pct / 100)]);
+    pthread_mutex_unlock(&recompute_lock);
+}
+
+int hedge_init(double percentile, double budget, int (*lookup)(const char *hostname, dns_addr_list *list)){
+    if(pthread_condattr_init(&monotonic) || pthread_condattr_setclock(&monotonic, CLOCK_MONOTONIC)){
+        return -1;
+    }
+    hedge_backend = lookup;
+    hedge_pct = percentile;
+    hedge_budget = budget;
+    stopping = 0;
+    return 0;
+}
+
+int hedge_lookup(const char *hostname, dns_addr_list *list){
+    struct hedge_task *t = malloc(sizeof(*t));
+    long long start = now_ns(), threshold;
+    int status, hedged = 0;
+
+    if(!t){
+        return hedge_backend(hostname, list); // no memory to hedge with
+    }
+    atomic_init(&t -> refs, 2);
+    pthread_mutex_init(&t -> lock, NULL);
+    pthread_cond_init(&t -> answered, &monotonic);
+    t -> done = 0;
+    snprintf(t -> name, sizeof(t -> name), "%s", hostname);
+    for(int i = 0; i < 2; i++){
+        t -> jobs[i].task = t;
+        t -> jobs[i].hedge = i;
+    }
+    atomic_fetch_add(&lookups, 1);
+    if(submit(&t -> jobs[0])){
+        /* every helper is stuck on a slow name and no more can start:
+         * look it up here, unhedged, instead of queueing behind them.
+         * run_job() drops the reference the helper would have */
+        run_job(&t -> jobs[0]);
+    }
+
+    pthread_mutex_lock(&t -> lock);
+    if((threshold = atomic_load(&threshold_ns)) > 0){
+        long long at = start + threshold;
+        struct timespec deadline = { .tv_sec = at / 1000000000LL, .tv_nsec = at % 1000000000LL };
+
+        while(!t -> done && pthread_cond_timedwait(&t -> answered, &t -> lock, &deadline) != ETIMEDOUT){
+        }
+        if(!t -> done){
+            /* hedges stay within the budget however slow things get */
+            if((atomic_load(&hedges) + 1) * 100.0 <= hedge_budget * atomic_load(&lookups)){
+                atomic_fetch_add(&t -> refs, 1);
+                if(submit(&t -> jobs[1])){
+                    atomic_fetch_sub(&t -> refs, 1); // no helper to hedge with, keep waiting
+                }
+                else{
+                    atomic_fetch_add(&hedges, 1);
+                    hedged = 1;
+                }
+            }
+            else{
+                atomic_fetch_add(&over_budget, 1);
+            }
+        }
+    }
+    while(!t -> done){
+        pthread_cond_wait(&t -> answered, &t -> lock);
+    }
+    status = t -> status;
+    memcpy(list, &t -> list, DNS_ADDR_LIST_SIZE(t -> list.count));
+    if(hedged && t -> by_hedge){
+        atomic_fetch_add(&hedge_wins, 1);
+    }
+    pthread_mutex_unlock(&t -> lock);
+    task_release(t);
+
+    record(now_ns() - start);
+    return status;
+}
+
+void hedge_report(FILE *out){
+    long n = atomic_load(&lookups), h = atomic_load(&hedges);
+
+    fprintf(out, "Hedged lookups: %ld of %ld (%.2f%%) slower than p%g (last %lld us), %ld answered by the hedge first, "
+            "%ld not hedged to stay within %g%%\n",
+            h, n, n ? h * 100.0 / n : 0.0, hedge_pct, atomic_load(&threshold_ns) / 1000,
+            atomic_load(&hedge_wins), atomic_load(&over_budget), hedge_budget);
+}
+
+void hedge_cleanup(void){
+    pthread_mutex_lock(&helpers_lock);
+    stopping = 1;
+    pthread_cond_broadcast(&have_job);
+    while(helpers > 0){
+        pthread_cond_wait(&helpers_gone, &helpers_lock);
+    }
+    pthread_mutex_unlock(&helpers_lock);
+}
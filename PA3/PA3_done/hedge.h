@@ -0,0 +1,50 @@
+/*
+ * File: hedge.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Hedged lookups (-H/--hedge=PCT[:BUDGET]) against slow names.
+ *
+ *      A blocking lookup cannot be cancelled, so with hedging the
+ *      resolver does not make it itself: it hands the name to a helper
+ *      thread and waits. If no answer has come by the PCT percentile of
+ *      the last HEDGE_WINDOW lookup times, a second helper looks the same
+ *      name up, and the resolver takes whichever answer arrives first
+ *      and moves on. The loser finishes in the background and its answer
+ *      is dropped. Hedges are capped at BUDGET percent of all lookups, so
+ *      a slow upstream is never hit with twice the load.
+ *
+ *      Helpers are started as needed (a loser still waiting on a slow
+ *      answer keeps its helper busy) up to HEDGE_MAX_HELPERS, with small
+ *      stacks like the adaptive pool's resolvers.
+ */
+
+#ifndef HEDGE_H
+#define HEDGE_H
+
+#include <stdio.h>
+#include "util.h"
+
+#define HEDGE_DEFAULT_PERCENTILE 95.0
+#define HEDGE_DEFAULT_BUDGET 5.0 // percent of lookups that may be hedged
+#define HEDGE_WINDOW 1024 // recent lookup times the threshold comes from
+#define HEDGE_RECOMPUTE 128 // lookups between threshold updates
+#define HEDGE_MIN_SAMPLES 100 // no hedging before this many lookups
+#define HEDGE_MAX_HELPERS 512
+#define HEDGE_STACK_SIZE (256 * 1024)
+
+/* Hedge lookups that take longer than the percentile'th percentile of
+ * recent ones, at most budget percent of them, answering them with
+ * lookup (same contract as dnslookup_all()). Returns 0 or -1 */
+int hedge_init(double percentile, double budget, int (*lookup)(const char *hostname, dns_addr_list *list));
+
+/* lookup(hostname, list), hedged */
+int hedge_lookup(const char *hostname, dns_addr_list *list);
+
+/* Lookups, hedges and which answer won, for the summary */
+void hedge_report(FILE *out);
+
+/* Stop the helpers. One still busy with a lookup that lost is waited for,
+ * since it may use the backend and caches that are closed after this */
+void hedge_cleanup(void);
+
+#endif
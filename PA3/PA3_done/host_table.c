@@ -0,0 +1,516 @@
+/*
+ * File: host_table.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Read-only perfect-hash table of known names. See host_table.h.
+ *
+ *      Layout of the block (an image file is exactly this block):
+ *      header | u32 displacement per bucket | slot per table position
+ *      {u32 name, u32 answer} | blob of NUL terminated names and answers
+ *      encoded as in lookup_proto.h. Offsets in slots are into the blob.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "host_table.h"
+#include "lookup_proto.h"
+
+#define BUILD_BUCKETS 1024 // initial size of the table names are collected in
+#define SLOT_EMPTY UINT32_MAX
+#define TABLE_SEEDS 8 // table seeds tried before giving up
+
+struct host_table_header {
+    char magic[4];
+    uint32_t version;
+    uint64_t seed;
+    uint64_t names, slots, buckets;
+    uint64_t disp_off, slot_off, blob_off, blob_size, size;
+};
+
+struct host_slot {
+    uint32_t name, answer; // blob offsets, name is SLOT_EMPTY if free
+};
+
+struct host_table {
+    unsigned char *base;
+    size_t size;
+    int mapped;
+    const struct host_table_header *hdr;
+    const uint32_t *disp;
+    const struct host_slot *slots;
+    const char *blob;
+};
+
+/* --- hashing --- */
+
+static uint64_t fnv64(const char *name){
+    uint64_t h = 1469598103934665603ULL;
+    for(const unsigned char *p = (const unsigned char *)name; *p; p++){
+        h = (h ^ *p) * 1099511628211ULL;
+    }
+    return h;
+}
+
+/* splitmix64's finalizer: every input bit moves every output bit */
+static uint64_t mix64(uint64_t x){
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+    return x ^ (x >> 31);
+}
+
+static uint64_t bucket_of(uint64_t h, uint64_t seed, uint64_t buckets){
+    return mix64(h ^ seed) % buckets;
+}
+
+static uint64_t slot_of(uint64_t h, uint64_t seed, uint32_t displace, uint64_t slots){
+    return mix64((h ^ seed) + ((uint64_t)displace + 1) * 0x9e3779b97f4a7c15ULL) % slots;
+}
+
+/* --- collecting names from a hosts or zone file --- */
+
+struct build_entry {
+    struct build_entry *next;
+    uint64_t hash;
+    int count, room;
+    dns_addr *addrs; // most names have one, so it grows as needed
+    char name[];
+};
+
+struct builder {
+    struct build_entry **table;
+    size_t buckets, count;
+};
+
+static int builder_grow(struct builder *b){
+    size_t more = b -> buckets ? b -> buckets * 2 : BUILD_BUCKETS;
+    struct build_entry **table = calloc(more, sizeof(*table));
+
+    if(!table){
+        return -1;
+    }
+    for(size_t i = 0; i < b -> buckets; i++){
+        while(b -> table[i]){
+            struct build_entry *e = b -> table[i];
+            b -> table[i] = e -> next;
+            e -> next = table[e -> hash & (more - 1)];
+            table[e -> hash & (more - 1)] = e;
+        }
+    }
+    free(b -> table);
+    b -> table = table;
+    b -> buckets = more;
+    return 0;
+}
+
+static void builder_free(struct builder *b){
+    for(size_t i = 0; i < b -> buckets; i++){
+        while(b -> table[i]){
+            struct build_entry *e = b -> table[i];
+            b -> table[i] = e -> next;
+            free(e -> addrs);
+            free(e);
+        }
+    }
+    free(b -> table);
+}
+
+/* Give name (already normalized) one more address, keeping file order */
+static int builder_add(struct builder *b, const char *name, const dns_addr *addr){
+    uint64_t h = fnv64(name);
+    struct build_entry *e = NULL;
+
+    if(b -> buckets){
+        for(e = b -> table[h & (b -> buckets - 1)]; e && strcmp(e -> name, name); e = e -> next){
+        }
+    }
+    if(!e){
+        if(b -> count >= b -> buckets && builder_grow(b)){
+            return -1;
+        }
+        if(!(e = malloc(sizeof(*e) + strlen(name) + 1))){
+            return -1;
+        }
+        strcpy(e -> name, name);
+        e -> hash = h;
+        e -> count = e -> room = 0;
+        e -> addrs = NULL;
+        e -> next = b -> table[h & (b -> buckets - 1)];
+        b -> table[h & (b -> buckets - 1)] = e;
+        b -> count++;
+    }
+    for(int i = 0; i < e -> count; i++){
+        if(!memcmp(&e -> addrs[i], addr, sizeof(*addr))){
+            return 0;
+        }
+    }
+    if(e -> count == UTIL_MAX_ADDRS){
+        return 0;
+    }
+    if(e -> count == e -> room){
+        int room = e -> room ? e -> room * 2 : 1;
+        dns_addr *more = realloc(e -> addrs, sizeof(*more) * room);
+        if(!more){
+            return -1;
+        }
+        e -> addrs = more;
+        e -> room = room;
+    }
+    e -> addrs[e -> count++] = *addr;
+    return 0;
+}
+
+static int parse_addr(const char *text, dns_addr *addr){
+    memset(addr, 0, sizeof(*addr));
+    if(inet_pton(AF_INET, text, addr -> bytes) == 1){
+        addr -> family = AF_INET;
+        return 1;
+    }
+    if(inet_pton(AF_INET6, text, addr -> bytes) == 1){
+        addr -> family = AF_INET6;
+        return 1;
+    }
+    return 0;
+}
+
+/* One line of either format, anything else is skipped */
+static int parse_line(struct builder *b, char *line){
+    char *tok[16];
+    char name[NI_MAXHOST];
+    int n = 0;
+    dns_addr addr;
+
+    line[strcspn(line, "#;")] = '\0'; // comments in both formats
+    for(char *save, *t = strtok_r(line, " \t\r\n", &save); t && n < 16; t = strtok_r(NULL, " \t\r\n", &save)){
+        tok[n++] = t;
+    }
+    if(n < 2 || tok[0][0] == '$'){
+        return 0; // blank, or a zone file directive
+    }
+    if(parse_addr(tok[0], &addr)){
+        /* hosts: ADDR NAME ALIAS... */
+        for(int i = 1; i < n; i++){
+            if(dns_name_normalize(tok[i], name, sizeof(name)) && builder_add(b, name, &addr)){
+                return -1;
+            }
+        }
+        return 0;
+    }
+    /* zone: NAME [TTL] [IN] A|AAAA ADDR */
+    for(int i = 1; i + 1 < n; i++){
+        if((!strcasecmp(tok[i], "A") || !strcasecmp(tok[i], "AAAA")) && parse_addr(tok[i + 1], &addr)){
+            if(dns_name_normalize(tok[0], name, sizeof(name)) && builder_add(b, name, &addr)){
+                return -1;
+            }
+            break;
+        }
+    }
+    return 0;
+}
+
+/* --- building the perfect hash --- */
+
+static void set_pointers(host_table *t){
+    t -> hdr = (const struct host_table_header *)t -> base;
+    t -> disp = (const uint32_t *)(t -> base + t -> hdr -> disp_off);
+    t -> slots = (const struct host_slot *)(t -> base + t -> hdr -> slot_off);
+    t -> blob = (const char *)(t -> base + t -> hdr -> blob_off);
+}
+
+static const uint64_t *sort_sizes; // for by_bucket_size
+
+static int by_bucket_size(const void *a, const void *b){
+    uint64_t x = sort_sizes[*(const uint32_t *)a], y = sort_sizes[*(const uint32_t *)b];
+    return (x < y) - (x > y); // largest first
+}
+
+/* Find a seed for every bucket so its names land in free slots. Returns
+ * 0, or -1 if some bucket found none */
+static int place(struct host_table_header *hdr, struct build_entry **keys, const uint32_t *names,
+                 const uint32_t *answers, uint32_t *disp, struct host_slot *slots){
+    uint64_t n = hdr -> names, r = hdr -> buckets, m = hdr -> slots;
+    uint64_t *start = calloc(r + 1, sizeof(*start));
+    uint64_t *sizes = calloc(r, sizeof(*sizes));
+    uint32_t *members = malloc(sizeof(*members) * (n ? n : 1));
+    uint32_t *order = malloc(sizeof(*order) * r);
+    uint64_t pos[64];
+    int status = -1;
+
+    if(!start || !sizes || !members || !order){
+        goto out;
+    }
+    /* names grouped by bucket */
+    for(uint64_t i = 0; i < n; i++){
+        sizes[bucket_of(keys[i] -> hash, hdr -> seed, r)]++;
+    }
+    for(uint64_t b = 0; b < r; b++){
+        start[b + 1] = start[b] + sizes[b];
+        order[b] = b;
+    }
+    for(uint64_t i = 0; i < n; i++){
+        uint64_t b = bucket_of(keys[i] -> hash, hdr -> seed, r);
+        members[start[b] + --sizes[b]] = i;
+    }
+    for(uint64_t b = 0; b < r; b++){
+        sizes[b] = start[b + 1] - start[b];
+    }
+    sort_sizes = sizes;
+    qsort(order, r, sizeof(*order), by_bucket_size);
+
+    memset(slots, 0xff, sizeof(*slots) * m);
+    for(uint64_t k = 0; k < r && sizes[order[k]] > 0; k++){
+        uint64_t b = order[k], count = sizes[b];
+        uint32_t d;
+
+        if(count > sizeof(pos) / sizeof(pos[0])){
+            goto out; // a seed this bad is not worth placing, try the next one
+        }
+        for(d = 0; d < HOST_TABLE_MAX_DISPLACE; d++){
+            uint64_t j;
+            for(j = 0; j < count; j++){
+                pos[j] = slot_of(keys[members[start[b] + j]] -> hash, hdr -> seed, d, m);
+                if(slots[pos[j]].name != SLOT_EMPTY){
+                    break;
+                }
+                uint64_t i;
+                for(i = 0; i < j && pos[i] != pos[j]; i++){
+                }
+                if(i < j){
+                    break;
+                }
+            }
+            if(j == count){
+                break;
+            }
+        }
+        if(d == HOST_TABLE_MAX_DISPLACE){
+            goto out;
+        }
+        disp[b] = d;
+        for(uint64_t j = 0; j < count; j++){
+            uint32_t i = members[start[b] + j];
+            slots[pos[j]].name = names[i];
+            slots[pos[j]].answer = answers[i];
+        }
+    }
+    status = 0;
+out:
+    free(start);
+    free(sizes);
+    free(members);
+    free(order);
+    return status;
+}
+
+/* Turn the collected names into the flat block */
+static host_table *build(struct builder *bld){
+    uint64_t n = bld -> count;
+    struct build_entry **keys = malloc(sizeof(*keys) * (n ? n : 1));
+    uint32_t *names = malloc(sizeof(*names) * (n ? n : 1));
+    uint32_t *answers = malloc(sizeof(*answers) * (n ? n : 1));
+    host_table *t = calloc(1, sizeof(*t));
+    struct host_table_header hdr;
+    uint64_t blob_size = 0, k = 0;
+
+    if(!keys || !names || !answers || !t){
+        goto fail;
+    }
+    for(size_t i = 0; i < bld -> buckets; i++){
+        for(struct build_entry *e = bld -> table[i]; e; e = e -> next){
+            keys[k++] = e;
+            blob_size += strlen(e -> name) + 1 + 2;
+            for(int a = 0; a < e -> count; a++){
+                blob_size += 1 + (e -> addrs[a].family == AF_INET6 ? 16 : 4);
+            }
+        }
+    }
+    if(blob_size >= SLOT_EMPTY){
+        goto fail; // offsets are 32 bits
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, HOST_TABLE_MAGIC, 4);
+    hdr.version = HOST_TABLE_VERSION;
+    hdr.names = n;
+    hdr.buckets = n / HOST_TABLE_BUCKET_NAMES + 1;
+    hdr.slots = n + n / 8 + 1; // about 89% full
+    hdr.disp_off = sizeof(hdr);
+    hdr.slot_off = (hdr.disp_off + sizeof(uint32_t) * hdr.buckets + 7) & ~7ULL;
+    hdr.blob_off = hdr.slot_off + sizeof(struct host_slot) * hdr.slots;
+    hdr.blob_size = blob_size;
+    hdr.size = hdr.blob_off + blob_size;
+    if(!(t -> base = calloc(1, hdr.size))){
+        goto fail;
+    }
+    t -> size = hdr.size;
+
+    /* the blob: every name, then its answer */
+    char *blob = (char *)t -> base + hdr.blob_off;
+    uint64_t used = 0;
+    for(uint64_t i = 0; i < n; i++){
+        dns_addr_list list;
+
+        names[i] = used;
+        used += sprintf(blob + used, "%s", keys[i] -> name) + 1;
+        answers[i] = used;
+        list.count = keys[i] -> count;
+        memcpy(list.addrs, keys[i] -> addrs, sizeof(dns_addr) * list.count);
+        used += lookup_proto_put_answer((unsigned char *)blob + used, UTIL_SUCCESS, &list);
+    }
+
+    for(int s = 0; s < TABLE_SEEDS; s++){
+        hdr.seed = mix64(0x686f737473ULL + s);
+        if(!place(&hdr, keys, names, answers, (uint32_t *)(t -> base + hdr.disp_off),
+                  (struct host_slot *)(t -> base + hdr.slot_off))){
+            memcpy(t -> base, &hdr, sizeof(hdr));
+            set_pointers(t);
+            free(keys);
+            free(names);
+            free(answers);
+            return t;
+        }
+    }
+fail:
+    if(t){
+        free(t -> base);
+    }
+    free(t);
+    free(keys);
+    free(names);
+    free(answers);
+    return NULL;
+}
+
+/* --- loading --- */
+
+/* Map an image and check everything a lookup will trust */
+static host_table *map_image(int fd, size_t size){
+    host_table *t = calloc(1, sizeof(*t));
+    const struct host_table_header *h;
+
+    if(!t){
+        return NULL;
+    }
+    t -> base = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if(t -> base == MAP_FAILED){
+        free(t);
+        return NULL;
+    }
+    t -> size = size;
+    t -> mapped = 1;
+    h = (const struct host_table_header *)t -> base;
+    /* every offset is checked against size before anything is added to
+     * it, so a damaged header cannot wrap around and pass */
+    if(h -> version != HOST_TABLE_VERSION || h -> size != size || h -> buckets == 0 || h -> slots == 0 ||
+       h -> disp_off < sizeof(*h) || h -> disp_off > size || h -> disp_off % 4 ||
+       h -> buckets > (size - h -> disp_off) / sizeof(uint32_t) ||
+       h -> slot_off < h -> disp_off + sizeof(uint32_t) * h -> buckets || h -> slot_off > size || h -> slot_off % 4 ||
+       h -> slots > (size - h -> slot_off) / sizeof(struct host_slot) ||
+       h -> blob_off < h -> slot_off + sizeof(struct host_slot) * h -> slots || h -> blob_off > size ||
+       h -> blob_size != size - h -> blob_off){
+        host_table_close(t);
+        return NULL;
+    }
+    set_pointers(t);
+    return t;
+}
+
+host_table *host_table_open(const char *path){
+    char magic[4], line[HOST_TABLE_MAX_LINE];
+    struct builder bld = { NULL, 0, 0 };
+    struct stat st;
+    host_table *t;
+    FILE *fp;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    if(fd < 0){
+        return NULL;
+    }
+    if(!fstat(fd, &st) && S_ISREG(st.st_mode) && pread(fd, magic, 4, 0) == 4 && !memcmp(magic, HOST_TABLE_MAGIC, 4)){
+        /* an image cut short before the end of its header is damaged too */
+        t = ((size_t)st.st_size >= sizeof(struct host_table_header)) ? map_image(fd, st.st_size) : NULL;
+        close(fd);
+        return t;
+    }
+    if(!(fp = fdopen(fd, "r"))){
+        close(fd);
+        return NULL;
+    }
+    while(fgets(line, sizeof(line), fp)){
+        if(parse_line(&bld, line)){
+            fclose(fp);
+            builder_free(&bld);
+            return NULL;
+        }
+    }
+    fclose(fp);
+    t = build(&bld);
+    builder_free(&bld);
+    return t;
+}
+
+int host_table_save(const host_table *t, const char *path){
+    FILE *fp = fopen(path, "w");
+
+    if(!fp){
+        return -1;
+    }
+    if(fwrite(t -> base, 1, t -> size, fp) != t -> size){
+        fclose(fp);
+        return -1;
+    }
+    return fclose(fp) ? -1 : 0;
+}
+
+int host_table_lookup(const host_table *t, const char *hostname, dns_addr_list *list){
+    const struct host_table_header *h = t -> hdr;
+    char name[NI_MAXHOST];
+    const struct host_slot *s;
+    uint64_t hash;
+    size_t len;
+    int status;
+
+    if(!dns_name_normalize(hostname, name, sizeof(name))){
+        return HOST_TABLE_MISS;
+    }
+    hash = fnv64(name);
+    s = &t -> slots[slot_of(hash, h -> seed, t -> disp[bucket_of(hash, h -> seed, h -> buckets)], h -> slots)];
+    len = strlen(name);
+    /* a name not in the table lands on some other name's slot */
+    if(s -> name == SLOT_EMPTY || s -> name >= h -> blob_size || h -> blob_size - s -> name <= len ||
+       memcmp(t -> blob + s -> name, name, len + 1) || s -> answer >= h -> blob_size){
+        return HOST_TABLE_MISS;
+    }
+    if(!lookup_proto_get_answer((const unsigned char *)t -> blob + s -> answer,
+                                (const unsigned char *)t -> blob + h -> blob_size, &status, list)){
+        return HOST_TABLE_MISS; // damaged image
+    }
+    return UTIL_SUCCESS;
+}
+
+size_t host_table_count(const host_table *t){
+    return t -> hdr -> names;
+}
+
+int host_table_mapped(const host_table *t){
+    return t -> mapped;
+}
+
+void host_table_close(host_table *t){
+    if(!t){
+        return;
+    }
+    if(t -> mapped){
+        munmap(t -> base, t -> size);
+    }
+    else{
+        free(t -> base);
+    }
+    free(t);
+}
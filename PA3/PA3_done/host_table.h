@@ -0,0 +1,60 @@
+/*
+ * File: host_table.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Read-only name -> addresses table with a perfect hash, for names
+ *      whose answers are known before the run: -Z/--preload=PATH answers
+ *      them in the resolver stage without any lookup, and -B hosts uses
+ *      it as its whole backend.
+ *
+ *      The source is a hosts file ("ADDR NAME ALIAS...") or zone file
+ *      lines ("NAME [TTL] [IN] A|AAAA ADDR"). Names are matched without
+ *      case and trailing dot, and keep up to UTIL_MAX_ADDRS addresses in
+ *      file order. Loading one builds the table (hash and displace: names
+ *      are hashed into buckets of about HOST_TABLE_BUCKET_NAMES, and each
+ *      bucket, largest first, gets the first seed that puts all its names
+ *      in free slots), so a lookup is one hash, one displacement and one
+ *      string compare, never a probe sequence.
+ *
+ *      The built table is one flat block, which hosts_image saves as an
+ *      image file. Opening an image maps it instead of parsing anything,
+ *      so millions of names cost nothing at startup and every process
+ *      using the image shares its pages. Images are in host byte order,
+ *      for the machine that built them.
+ */
+
+#ifndef HOST_TABLE_H
+#define HOST_TABLE_H
+
+#include <stddef.h>
+#include "util.h"
+
+#define HOST_TABLE_MAGIC "MLHT"
+#define HOST_TABLE_VERSION 1
+#define HOST_TABLE_MISS 1 // host_table_lookup(): not in the table
+#define HOST_TABLE_BUCKET_NAMES 4
+#define HOST_TABLE_MAX_DISPLACE (1 << 22) // seeds tried per bucket before a new table seed
+#define HOST_TABLE_MAX_LINE 4096
+
+typedef struct host_table host_table;
+
+/* Load path: an image from hosts_image is mapped, anything else is read
+ * as a hosts or zone file and built. NULL if it cannot be read, is a
+ * damaged image or there is no memory */
+host_table *host_table_open(const char *path);
+
+/* Write the table as an image to path. Returns 0 or -1 */
+int host_table_save(const host_table *t, const char *path);
+
+/* UTIL_SUCCESS and the name's addresses, or HOST_TABLE_MISS. Safe from
+ * any number of threads */
+int host_table_lookup(const host_table *t, const char *hostname, dns_addr_list *list);
+
+size_t host_table_count(const host_table *t);
+
+/* 1 if the table was mapped from an image */
+int host_table_mapped(const host_table *t);
+
+void host_table_close(host_table *t);
+
+#endif
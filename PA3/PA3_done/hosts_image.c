@@ -0,0 +1,41 @@
+/*
+ * File: hosts_image.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Builds a table image from a hosts or zone file (host_table.h), for
+ *      multi-lookup -Z IMAGE or -B hosts:IMAGE. Parsing and hashing
+ *      millions of names happens once here instead of at every start;
+ *      the image is mapped as it is.
+ *
+ *      ./hosts_image SOURCE IMAGE
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/time.h>
+#include "host_table.h"
+
+int main(int argc, char *argv[]){
+    struct timeval start, end;
+    host_table *t;
+
+    if(argc != 3){
+        fprintf(stderr, "USAGE: \n %s SOURCE IMAGE\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+    gettimeofday(&start, NULL);
+    if(!(t = host_table_open(argv[1]))){
+        fprintf(stderr, "Unable to build a table from %s\n", argv[1]);
+        return EXIT_FAILURE;
+    }
+    if(host_table_save(t, argv[2])){
+        perror(argv[2]);
+        host_table_close(t);
+        return EXIT_FAILURE;
+    }
+    gettimeofday(&end, NULL);
+    printf("%zu names from %s in %s, built in %ld ms\n", host_table_count(t), argv[1], argv[2],
+           (end.tv_sec - start.tv_sec) * 1000 + (end.tv_usec - start.tv_usec) / 1000);
+    host_table_close(t);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,133 @@
+/*
+ * File: input_units.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Input files split into work units for the requester threads.
+ *      See input_units.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "input_units.h"
+
+#define SCAN_BLOCK 4096
+
+static int add_unit(input_units *u, int *room, const char *path, off_t start, off_t end, int whole, int stream){
+    if(u -> count == *room){
+        int more = *room ? *room * 2 : 16;
+        input_unit *grown = realloc(u -> units, sizeof(input_unit) * more);
+        if(!grown){
+            return -1;
+        }
+        u -> units = grown;
+        *room = more;
+    }
+    input_unit *unit = &u -> units[u -> count++];
+    memset(unit, 0, sizeof(*unit));
+    unit -> path = path;
+    unit -> start = start;
+    unit -> end = end;
+    unit -> whole = whole;
+    unit -> stream = stream;
+    return 0;
+}
+
+/* First line start at or after pos, size if the file ends first */
+static off_t line_start(int fd, off_t pos, off_t size){
+    char block[SCAN_BLOCK];
+
+    /* pos starts a line if the byte before it ends one */
+    for(off_t at = pos - 1; at < size; ){
+        ssize_t n = pread(fd, block, sizeof(block), at);
+        if(n < 0 && errno == EINTR){
+            continue;
+        }
+        if(n <= 0){
+            break;
+        }
+        char *nl = memchr(block, '\n', n);
+        if(nl){
+            return at + (nl - block) + 1;
+        }
+        at += n;
+    }
+    return size;
+}
+
+/* Split one file into units, appending them to u */
+static int plan_file(input_units *u, int *room, const char *path){
+    struct stat st;
+    int fd;
+    int failed = 0;
+
+    if(!strcmp(path, INPUT_STDIN) || (!stat(path, &st) && !S_ISREG(st.st_mode))){
+        return add_unit(u, room, path, 0, -1, 1, 1);
+    }
+    fd = open(path, O_RDONLY);
+    if(fd < 0 || fstat(fd, &st) || st.st_size <= INPUT_CHUNK_SIZE){
+        if(fd >= 0){
+            close(fd);
+        }
+        return add_unit(u, room, path, 0, -1, 1, 0);
+    }
+    for(off_t start = 0; start < st.st_size && !failed; ){
+        off_t end = st.st_size;
+        if(start + INPUT_CHUNK_SIZE < st.st_size){
+            end = line_start(fd, start + INPUT_CHUNK_SIZE, st.st_size);
+        }
+        failed = add_unit(u, room, path, start, end, 0, 0);
+        start = end;
+    }
+    close(fd);
+    return failed ? -1 : 0;
+}
+
+/* Map the file behind units [first, last) once and give each its part */
+static void map_units(input_units *u, int first, int last){
+    name_map_reader whole;
+
+    if(name_map_open_shared(&whole, u -> units[first].path, last - first)){
+        return; // read with stdio instead
+    }
+    size_t size = (size_t)(whole.end - whole.pos);
+    for(int i = first; i < last; i++){
+        input_unit *unit = &u -> units[i];
+        name_map_part(&unit -> map, &whole, (size_t)unit -> start,
+                      unit -> end < 0 ? size : (size_t)unit -> end);
+        unit -> mapped = 1;
+    }
+}
+
+int input_units_plan(input_units *u, char **paths, int num_paths, int map){
+    int room = 0;
+
+    u -> units = NULL;
+    u -> count = 0;
+    atomic_init(&u -> next, 0);
+    for(int i = 0; i < num_paths; i++){
+        int first = u -> count;
+        if(plan_file(u, &room, paths[i])){
+            input_units_cleanup(u);
+            return -1;
+        }
+        if(map && !u -> units[first].stream){
+            map_units(u, first, u -> count);
+        }
+    }
+    return 0;
+}
+
+input_unit *input_units_claim(input_units *u){
+    int i = atomic_fetch_add(&u -> next, 1);
+    return (i < u -> count) ? &u -> units[i] : NULL;
+}
+
+void input_units_cleanup(input_units *u){
+    free(u -> units);
+    u -> units = NULL;
+    u -> count = 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * File: input_units.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Input files split into work units for the requester threads.
+ *
+ *      Requesters are no longer tied to one input file each. Before they
+ *      start, every input file becomes one or more units: a file up to
+ *      INPUT_CHUNK_SIZE bytes is a single unit, a bigger one is cut into
+ *      byte ranges of about INPUT_CHUNK_SIZE that start and end on line
+ *      boundaries. Requesters claim units one at a time until none are
+ *      left, so one big file is read by every requester at once and
+ *      there may be more files than requesters.
+ *
+ *      With -m a file is mapped once and its units read parts of the
+ *      same mapping (name_map_part()).
+ *
+ *      Pipes, FIFOs, terminals and "-" (standard input) cannot be split
+ *      or mapped: each is one stream unit, read as data arrives. They are
+ *      not opened while planning, so a FIFO's writer is never met by a
+ *      reader that goes away again.
+ */
+
+#ifndef INPUT_UNITS_H
+#define INPUT_UNITS_H
+
+#include <stdatomic.h>
+#include <sys/types.h>
+#include "name_map.h"
+
+/* Bytes per unit of a split file.
+ * Build with -DINPUT_CHUNK_SIZE=4096 to try splitting on small files */
+#ifndef INPUT_CHUNK_SIZE
+#define INPUT_CHUNK_SIZE (1024 * 1024)
+#endif
+
+#define INPUT_STDIN "-" // input path that means standard input
+
+typedef struct input_unit {
+    const char *path;
+    off_t start;         // first byte, on a line boundary
+    off_t end;           // one past the last byte, -1 for the end of the file
+    int whole;           // the unit is the entire file
+    int mapped;          // read through map instead of stdio
+    int stream;          // not a regular file: read as data arrives
+    name_map_reader map;
+} input_unit;
+
+typedef struct input_units {
+    input_unit *units;
+    int count;
+    atomic_int next; // next unit to hand out
+} input_units;
+
+/* Turn the num_paths files at paths into units. With map, files that can
+ * be mapped get mapped units. Files that cannot be opened get one whole
+ * unit so the requester that claims it reports the error.
+ * Returns 0 on success, -1 on failure */
+int input_units_plan(input_units *u, char **paths, int num_paths, int map);
+
+/* Next unit to read, NULL once every unit has been claimed */
+input_unit *input_units_claim(input_units *u);
+
+/* Free the unit table. Mapped units must have been finished */
+void input_units_cleanup(input_units *u);
+
+#endif
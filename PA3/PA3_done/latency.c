@@ -0,0 +1,157 @@
+/*
+ * File: latency.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Per-name lookup latency histogram. See latency.h.
+ */
+
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "latency.h"
+
+#define SUB_COUNT (1 << LATENCY_SUB_BITS)
+
+/* Only the owning thread writes, others may read while it runs (-M):
+ * relaxed atomics keep that cheap, a load and a plain store per count */
+struct latency_hist {
+    struct latency_hist *next;
+    atomic_llong total;
+    atomic_llong max;
+    atomic_llong counts[LATENCY_BUCKETS];
+};
+
+static void bump(atomic_llong *v, long long by){
+    atomic_store_explicit(v, atomic_load_explicit(v, memory_order_relaxed) + by, memory_order_relaxed);
+}
+
+static long long get(atomic_llong *v){
+    return atomic_load_explicit(v, memory_order_relaxed);
+}
+
+static struct latency_hist *hists = NULL; // every thread's, merged when read
+static pthread_mutex_t hists_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread struct latency_hist *mine = NULL;
+
+static int bucket_of(unsigned long long v){
+    if(v < SUB_COUNT){
+        return (int)v;
+    }
+    int e = 63 - __builtin_clzll(v) - LATENCY_SUB_BITS + 1;
+    return (e << LATENCY_SUB_BITS) + (int)((v >> (e - 1)) - SUB_COUNT);
+}
+
+/* Smallest value that lands in bucket b, and how many values do */
+static long long bucket_low(int b){
+    int e = b >> LATENCY_SUB_BITS;
+    return e ? (long long)((b & (SUB_COUNT - 1)) + SUB_COUNT) << (e - 1) : b;
+}
+
+static long long bucket_width(int b){
+    int e = b >> LATENCY_SUB_BITS;
+    return e ? 1LL << (e - 1) : 1;
+}
+
+/* Middle of the values that land in bucket b */
+static long long bucket_value(int b){
+    return bucket_low(b) + bucket_width(b) / 2;
+}
+
+void latency_record(long long ns){
+    if(!mine){
+        if(!(mine = calloc(1, sizeof(*mine)))){
+            return; // this thread's names go unmeasured
+        }
+        pthread_mutex_lock(&hists_lock);
+        mine -> next = hists;
+        hists = mine;
+        pthread_mutex_unlock(&hists_lock);
+    }
+    if(ns < 0){
+        ns = 0;
+    }
+    bump(&mine -> counts[bucket_of(ns)], 1);
+    bump(&mine -> total, 1);
+    if(ns > get(&mine -> max)){
+        atomic_store_explicit(&mine -> max, ns, memory_order_relaxed);
+    }
+}
+
+long long latency_count(void){
+    long long n = 0;
+
+    pthread_mutex_lock(&hists_lock);
+    for(struct latency_hist *h = hists; h; h = h -> next){
+        n += get(&h -> total);
+    }
+    pthread_mutex_unlock(&hists_lock);
+    return n;
+}
+
+long long latency_percentile(double p){
+    long long n = latency_count(), seen = 0, max = 0;
+    long long rank;
+
+    if(n == 0){
+        return 0;
+    }
+    rank = (long long)(p * n + 0.5);
+    if(rank < 1){
+        rank = 1;
+    }
+    pthread_mutex_lock(&hists_lock);
+    for(struct latency_hist *h = hists; h; h = h -> next){
+        if(get(&h -> max) > max){
+            max = get(&h -> max);
+        }
+    }
+    for(int b = 0; b < LATENCY_BUCKETS; b++){
+        for(struct latency_hist *h = hists; h; h = h -> next){
+            seen += get(&h -> counts[b]);
+        }
+        if(seen >= rank){
+            pthread_mutex_unlock(&hists_lock);
+            long long v = bucket_value(b);
+            return v < max ? v : max;
+        }
+    }
+    pthread_mutex_unlock(&hists_lock);
+    return max;
+}
+
+void latency_report(FILE *out){
+    fprintf(out, "Lookup latency (us): %lld names, p50 %lld, p90 %lld, p99 %lld, p99.9 %lld, max %lld\n",
+            latency_count(), latency_percentile(0.5) / 1000, latency_percentile(0.9) / 1000,
+            latency_percentile(0.99) / 1000, latency_percentile(0.999) / 1000, latency_percentile(1.0) / 1000);
+}
+
+void latency_json(FILE *out){
+    int first = 1;
+
+    fprintf(out, "{\"count\":%lld,\"p50_ns\":%lld,\"p90_ns\":%lld,\"p99_ns\":%lld,\"p999_ns\":%lld,\"max_ns\":%lld,\"buckets\":[",
+            latency_count(), latency_percentile(0.5), latency_percentile(0.9),
+            latency_percentile(0.99), latency_percentile(0.999), latency_percentile(1.0));
+    pthread_mutex_lock(&hists_lock);
+    for(int b = 0; b < LATENCY_BUCKETS; b++){
+        long long n = 0;
+        for(struct latency_hist *h = hists; h; h = h -> next){
+            n += get(&h -> counts[b]);
+        }
+        if(n > 0){
+            fprintf(out, "%s[%lld,%lld]", first ? "" : ",", bucket_low(b) + bucket_width(b) - 1, n);
+            first = 0;
+        }
+    }
+    pthread_mutex_unlock(&hists_lock);
+    fprintf(out, "]}");
+}
+
+void latency_cleanup(void){
+    pthread_mutex_lock(&hists_lock);
+    while(hists){
+        struct latency_hist *h = hists;
+        hists = h -> next;
+        free(h);
+    }
+    pthread_mutex_unlock(&hists_lock);
+}
@@ -0,0 +1,44 @@
+/*
+ * File: latency.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Per-name lookup latency histogram.
+ *
+ *      Resolvers record how long each name took into a histogram of
+ *      their own, so recording never touches shared memory. Buckets are
+ *      exact below 2^LATENCY_SUB_BITS ns and above that split every power
+ *      of two into 2^LATENCY_SUB_BITS steps, about 3% apart, which is
+ *      enough for percentiles from a few ns up to hours in 15 KiB.
+ *      Histograms can be read while resolvers are still recording; the
+ *      result is then a snapshot that may miss the latest names.
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include <stdio.h>
+
+#define LATENCY_SUB_BITS 5
+#define LATENCY_BUCKETS ((64 - LATENCY_SUB_BITS + 1) << LATENCY_SUB_BITS)
+
+/* Add one name that took ns nanoseconds to this thread's histogram */
+void latency_record(long long ns);
+
+/* Names recorded by every thread so far */
+long long latency_count(void);
+
+/* Latency in ns that fraction p (0 to 1) of the names stayed within,
+ * 0 if nothing was recorded */
+long long latency_percentile(double p);
+
+/* Print count, p50, p90, p99, p99.9 and max in microseconds */
+void latency_report(FILE *out);
+
+/* Count, percentiles and every non-empty bucket as one JSON object:
+ * "buckets" holds [highest ns in the bucket, names] pairs */
+void latency_json(FILE *out);
+
+/* Free every thread's histogram */
+void latency_cleanup(void);
+
+#endif
@@ -0,0 +1,189 @@
+/*
+ * File: lookup_client.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Client for multi-lookup -L: sends the names in the input files
+ *      (or standard input) to the daemon in batches and prints one line
+ *      per name in input order, the same lines multi-lookup writes to
+ *      its results file: "name, first address, first IPv4 address", or
+ *      with -A every address. Protocol in lookup_proto.h.
+ *
+ *      ./lookup_client [-b batch] [-A] SOCKET [input files...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "lookup_proto.h"
+#include "result_format.h"
+
+#define CLIENT_DEFAULT_BATCH 256
+#define CLIENT_USAGE "[-b batch] [-A] SOCKET [input files...]"
+#define CLIENT_INPUTFS "%1024s" // LOOKUP_PROTO_MAX_NAME
+
+static int all_addresses = 0;
+
+static int connect_to(const char *path){
+    struct sockaddr_un addr;
+    int fd;
+
+    if(strlen(path) >= sizeof(addr.sun_path)){
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    if((fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0 ||
+       connect(fd, (struct sockaddr *)&addr, sizeof(addr))){
+        perror(path);
+        if(fd >= 0){
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+static void print_answer(const char *name, int status, const dns_addr_list *list){
+    char line[RESULT_FORMAT_MAX_LINE];
+    int len = result_format_line(line, name, status, list, all_addresses);
+
+    fwrite(line, 1, len, stdout);
+}
+
+/* Send the count names in request (frame already built) and print the
+ * answers. names holds them NUL separated, in order */
+static int exchange(int fd, unsigned char *request, size_t len, uint32_t count, const char *names){
+    unsigned char *reply;
+    uint32_t reply_len;
+    const unsigned char *p, *end;
+
+    lookup_proto_put_u32(request, len - 4);
+    lookup_proto_put_u32(request + 4, count);
+    if(lookup_proto_write_all(fd, request, len)){
+        perror("Error to send request");
+        return -1;
+    }
+    if(lookup_proto_read_frame(fd, &reply, &reply_len, 4 + count * LOOKUP_PROTO_ANSWER_SIZE)){
+        fprintf(stderr, "No reply from the server\n");
+        return -1;
+    }
+    p = reply + 4;
+    end = reply + reply_len;
+    if(reply_len < 4 || lookup_proto_get_u32(reply) != count){
+        p = NULL;
+    }
+    for(uint32_t i = 0; p && i < count; i++){
+        int status;
+        dns_addr_list list;
+
+        if((p = lookup_proto_get_answer(p, end, &status, &list))){
+            print_answer(names, status, &list);
+            names += strlen(names) + 1;
+        }
+    }
+    free(reply);
+    if(!p){
+        fprintf(stderr, "Malformed reply from the server\n");
+        return -1;
+    }
+    return 0;
+}
+
+/* Read every name of fp, a batch per request */
+static int send_file(int fd, FILE *fp, int batch){
+    char hostname[LOOKUP_PROTO_MAX_NAME + 1];
+    unsigned char *request = malloc(8 + (size_t)batch * (2 + LOOKUP_PROTO_MAX_NAME));
+    char *names = malloc((size_t)batch * (LOOKUP_PROTO_MAX_NAME + 1));
+    size_t used = 8, names_used = 0;
+    uint32_t count = 0;
+    int failed = 0;
+
+    if(!request || !names){
+        perror("Error to allocate batch");
+        free(request);
+        free(names);
+        return -1;
+    }
+    while(!failed && fscanf(fp, CLIENT_INPUTFS, hostname) > 0){
+        size_t len = strlen(hostname);
+
+        if(count > 0 && used + 2 + len > LOOKUP_PROTO_MAX_FRAME + 4){
+            /* the server refuses bigger frames: send what fits first */
+            failed = exchange(fd, request, used, count, names);
+            used = 8;
+            names_used = 0;
+            count = 0;
+            if(failed){
+                break;
+            }
+        }
+        request[used] = len >> 8;
+        request[used + 1] = len;
+        memcpy(request + used + 2, hostname, len);
+        used += 2 + len;
+        memcpy(names + names_used, hostname, len + 1);
+        names_used += len + 1;
+        if(++count == (uint32_t)batch){
+            failed = exchange(fd, request, used, count, names);
+            used = 8;
+            names_used = 0;
+            count = 0;
+        }
+    }
+    if(!failed && count > 0){
+        failed = exchange(fd, request, used, count, names);
+    }
+    free(request);
+    free(names);
+    return failed ? -1 : 0;
+}
+
+int main(int argc, char *argv[]){
+    int batch = CLIENT_DEFAULT_BATCH;
+    int opt, fd, failed = 0;
+
+    while((opt = getopt(argc, argv, "b:A")) != -1){
+        switch(opt){
+        case 'b':
+            batch = atoi(optarg);
+            if(batch < 1 || batch > LOOKUP_PROTO_MAX_NAMES){
+                fprintf(stderr, "Batch size must be between 1 and %d\n", LOOKUP_PROTO_MAX_NAMES);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'A':
+            all_addresses = 1;
+            break;
+        default:
+            fprintf(stderr, "USAGE: \n %s %s\n", argv[0], CLIENT_USAGE);
+            return EXIT_FAILURE;
+        }
+    }
+    if(optind >= argc){
+        fprintf(stderr, "USAGE: \n %s %s\n", argv[0], CLIENT_USAGE);
+        return EXIT_FAILURE;
+    }
+    if((fd = connect_to(argv[optind])) < 0){
+        return EXIT_FAILURE;
+    }
+    if(optind + 1 == argc){
+        failed = send_file(fd, stdin, batch);
+    }
+    for(int i = optind + 1; !failed && i < argc; i++){
+        FILE *fp = fopen(argv[i], "r");
+        if(!fp){
+            perror(argv[i]);
+            failed = 1;
+            break;
+        }
+        failed = send_file(fd, fp, batch);
+        fclose(fp);
+    }
+    close(fd);
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,118 @@
+/*
+ * File: lookup_proto.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Framed binary protocol of multi-lookup -L. See lookup_proto.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "lookup_proto.h"
+
+void lookup_proto_put_u32(unsigned char *p, uint32_t v){
+    p[0] = v >> 24;
+    p[1] = v >> 16;
+    p[2] = v >> 8;
+    p[3] = v;
+}
+
+uint32_t lookup_proto_get_u32(const unsigned char *p){
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+/* Fill buf, 1 if the connection ended before the first byte */
+static int read_all(int fd, unsigned char *buf, size_t len){
+    size_t got = 0;
+
+    while(got < len){
+        ssize_t n = read(fd, buf + got, len - got);
+        if(n < 0 && errno == EINTR){
+            continue;
+        }
+        if(n <= 0){
+            return (n == 0 && got == 0) ? 1 : -1;
+        }
+        got += n;
+    }
+    return 0;
+}
+
+int lookup_proto_read_frame(int fd, unsigned char **payload, uint32_t *len, uint32_t max){
+    unsigned char head[4];
+    int status = read_all(fd, head, sizeof(head));
+
+    if(status){
+        return status;
+    }
+    *len = lookup_proto_get_u32(head);
+    if(*len > max || !(*payload = malloc(*len + 1))){ // + 1: room to NUL terminate the last name
+        return -1;
+    }
+    if(read_all(fd, *payload, *len)){
+        free(*payload);
+        return -1;
+    }
+    return 0;
+}
+
+int lookup_proto_write_all(int fd, const void *data, size_t len){
+    const char *p = data;
+
+    while(len > 0){
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if(n < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+size_t lookup_proto_put_answer(unsigned char *p, int status, const dns_addr_list *list){
+    unsigned char *start = p;
+    int count = (status == UTIL_SUCCESS) ? list -> count : 0;
+
+    *p++ = (status == UTIL_SUCCESS) ? LOOKUP_PROTO_FOUND : LOOKUP_PROTO_FAILED;
+    *p++ = count;
+    for(int i = 0; i < count; i++){
+        int v6 = (list -> addrs[i].family == AF_INET6);
+        *p++ = v6 ? 6 : 4;
+        memcpy(p, list -> addrs[i].bytes, v6 ? 16 : 4);
+        p += v6 ? 16 : 4;
+    }
+    return (size_t)(p - start);
+}
+
+const unsigned char *lookup_proto_get_answer(const unsigned char *p, const unsigned char *end,
+                                             int *status, dns_addr_list *list){
+    if(end - p < 2 || p[1] > UTIL_MAX_ADDRS){
+        return NULL;
+    }
+    *status = (p[0] == LOOKUP_PROTO_FOUND) ? UTIL_SUCCESS : UTIL_FAILURE;
+    list -> count = p[1];
+    p += 2;
+    for(int i = 0; i < list -> count; i++){
+        dns_addr *a = &list -> addrs[i];
+        int size;
+
+        if(end - p < 1 || (*p != 4 && *p != 6)){
+            return NULL;
+        }
+        size = (*p == 6) ? 16 : 4;
+        if(end - p < 1 + size){
+            return NULL;
+        }
+        memset(a, 0, sizeof(*a));
+        a -> family = (*p == 6) ? AF_INET6 : AF_INET;
+        memcpy(a -> bytes, p + 1, size);
+        p += 1 + size;
+    }
+    return p;
+}
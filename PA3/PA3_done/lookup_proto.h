@@ -0,0 +1,56 @@
+/*
+ * File: lookup_proto.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Framed binary protocol between multi-lookup -L (lookup_server.h)
+ *      and its clients (lookup_client.c), over a Unix stream socket.
+ *
+ *      Every frame is a 32-bit payload length followed by the payload;
+ *      all integers are big-endian. A client sends any number of
+ *      request frames on one connection and gets one reply frame per
+ *      request, in the same order:
+ *      request: u32 count, then count names as u16 length + bytes
+ *      reply:   u32 count, then one answer per name, in request order:
+ *               u8 status (LOOKUP_PROTO_FOUND or LOOKUP_PROTO_FAILED),
+ *               u8 address count, then each address as u8 family (4 or
+ *               6) + 4 or 16 bytes in network order
+ *      A malformed or oversized request gets no reply: the server closes
+ *      the connection.
+ */
+
+#ifndef LOOKUP_PROTO_H
+#define LOOKUP_PROTO_H
+
+#include <stdint.h>
+#include "util.h"
+
+#define LOOKUP_PROTO_MAX_FRAME (4 * 1024 * 1024) // payload bytes, either way
+#define LOOKUP_PROTO_MAX_NAMES 16384 // per request
+#define LOOKUP_PROTO_MAX_NAME 1024 // bytes per name
+#define LOOKUP_PROTO_FOUND 0
+#define LOOKUP_PROTO_FAILED 1
+
+/* Most bytes one answer takes */
+#define LOOKUP_PROTO_ANSWER_SIZE (2 + UTIL_MAX_ADDRS * 17)
+
+void lookup_proto_put_u32(unsigned char *p, uint32_t v);
+uint32_t lookup_proto_get_u32(const unsigned char *p);
+
+/* Read one frame into a malloc()ed buffer of *len payload bytes. Returns 0
+ * on success, 1 if the peer closed the connection before a new frame,
+ * -1 on errors, truncated frames and frames over max bytes */
+int lookup_proto_read_frame(int fd, unsigned char **payload, uint32_t *len, uint32_t max);
+
+/* Send len bytes, without SIGPIPE if the peer went away. Returns 0 or -1 */
+int lookup_proto_write_all(int fd, const void *data, size_t len);
+
+/* Encode the answer for one name at p, returns the bytes used (at most
+ * LOOKUP_PROTO_ANSWER_SIZE). status is UTIL_SUCCESS or UTIL_FAILURE */
+size_t lookup_proto_put_answer(unsigned char *p, int status, const dns_addr_list *list);
+
+/* Decode one answer from [p, end), returns where the next one starts or
+ * NULL if it is malformed */
+const unsigned char *lookup_proto_get_answer(const unsigned char *p, const unsigned char *end,
+                                             int *status, dns_addr_list *list);
+
+#endif
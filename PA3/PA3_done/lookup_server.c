@@ -0,0 +1,286 @@
+/*
+ * File: lookup_server.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Resolver daemon on a Unix domain socket. See lookup_server.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "lookup_server.h"
+#include "lookup_proto.h"
+
+struct handler;
+
+/* one name of a request, what the resolver queue carries */
+struct lookup_job {
+    char *name;
+    struct handler *owner;
+    int status;
+    dns_addr_list list;
+};
+
+struct handler {
+    pthread_t tid;
+    int conn; // connection being served, -1 if none (under server_lock)
+    atomic_int remaining; // names of the current request without an answer
+    pthread_mutex_t lock;
+    pthread_cond_t done;
+};
+
+static int listen_fd = -1;
+static char socket_path[sizeof(((struct sockaddr_un *)0) -> sun_path)];
+static struct handler *handlers = NULL;
+static int num_handlers = 0;
+static int (*push_items)(char **items, int n);
+static int push_batch = 1;
+
+static pthread_mutex_t server_lock = PTHREAD_MUTEX_INITIALIZER;
+static int stopping = 0; // under server_lock
+static atomic_long connections, requests, names, bad_requests;
+
+/* Turn a request payload into jobs, NULL if it is malformed. The names
+ * are NUL terminated in place: each name's terminator overwrites the
+ * length of the next one, which has been read by then */
+static struct lookup_job *parse_request(struct handler *h, unsigned char *payload, uint32_t len, uint32_t *count){
+    unsigned char *p = payload + 4, *end = payload + len;
+    struct lookup_job *jobs;
+
+    if(len < 4 || (*count = lookup_proto_get_u32(payload)) > LOOKUP_PROTO_MAX_NAMES){
+        return NULL;
+    }
+    if(!(jobs = malloc(sizeof(*jobs) * (*count ? *count : 1)))){
+        return NULL;
+    }
+    for(uint32_t i = 0; i < *count; i++){
+        size_t size;
+
+        if(end - p < 2 || (size = ((size_t)p[0] << 8) | p[1]) > LOOKUP_PROTO_MAX_NAME ||
+           (size_t)(end - p - 2) < size){
+            free(jobs);
+            return NULL;
+        }
+        jobs[i].name = (char *)p + 2;
+        jobs[i].owner = h;
+        p += 2 + size;
+    }
+    if(p != end){
+        free(jobs);
+        return NULL;
+    }
+    /* back to front, so no length is read after it was overwritten. The
+     * payload has one spare byte past its end for the last name */
+    for(uint32_t i = *count; i-- > 0; ){
+        size_t size = ((size_t)(unsigned char)jobs[i].name[-2] << 8) | (unsigned char)jobs[i].name[-1];
+        jobs[i].name[size] = '\0';
+    }
+    return jobs;
+}
+
+/* Queue every job and wait until all of them have an answer */
+static void resolve_request(struct handler *h, struct lookup_job *jobs, uint32_t count){
+    char *items[push_batch];
+
+    atomic_store(&h -> remaining, count);
+    for(uint32_t i = 0; i < count; ){
+        int n = 0, queued;
+
+        while(n < push_batch && i + n < count){
+            items[n] = (char *)&jobs[i + n];
+            n++;
+        }
+        queued = push_items(items, n);
+        /* the queue only refuses names once it is closed: fail the rest */
+        for(int j = queued; j < n; j++){
+            lookup_server_complete(items[j], UTIL_FAILURE, NULL);
+        }
+        i += n;
+    }
+    pthread_mutex_lock(&h -> lock);
+    while(atomic_load(&h -> remaining) > 0){
+        pthread_cond_wait(&h -> done, &h -> lock);
+    }
+    pthread_mutex_unlock(&h -> lock);
+}
+
+static int send_reply(int fd, struct lookup_job *jobs, uint32_t count){
+    unsigned char *reply = malloc(8 + (size_t)count * LOOKUP_PROTO_ANSWER_SIZE);
+    size_t used = 8;
+    int status;
+
+    if(!reply){
+        return -1;
+    }
+    lookup_proto_put_u32(reply + 4, count);
+    for(uint32_t i = 0; i < count; i++){
+        used += lookup_proto_put_answer(reply + used, jobs[i].status, &jobs[i].list);
+    }
+    lookup_proto_put_u32(reply, used - 4);
+    status = lookup_proto_write_all(fd, reply, used);
+    free(reply);
+    return status;
+}
+
+/* Answer requests on one connection until the client closes it */
+static void serve(struct handler *h, int fd){
+    unsigned char *payload;
+    uint32_t len, count;
+    int status;
+
+    while((status = lookup_proto_read_frame(fd, &payload, &len, LOOKUP_PROTO_MAX_FRAME)) == 0){
+        struct lookup_job *jobs = parse_request(h, payload, len, &count);
+        if(!jobs){
+            atomic_fetch_add(&bad_requests, 1);
+            free(payload);
+            return;
+        }
+        resolve_request(h, jobs, count);
+        atomic_fetch_add(&requests, 1);
+        atomic_fetch_add(&names, count);
+        int sent = send_reply(fd, jobs, count);
+        free(jobs);
+        free(payload);
+        if(sent){
+            return;
+        }
+    }
+    if(status < 0){
+        atomic_fetch_add(&bad_requests, 1); // oversized or cut short
+    }
+}
+
+static void *handler_main(void *arg){
+    struct handler *h = arg;
+
+    for(;;){
+        int fd = accept(listen_fd, NULL, NULL);
+
+        pthread_mutex_lock(&server_lock);
+        if(stopping){
+            pthread_mutex_unlock(&server_lock);
+            if(fd >= 0){
+                close(fd);
+            }
+            return NULL;
+        }
+        h -> conn = fd;
+        pthread_mutex_unlock(&server_lock);
+        if(fd < 0){
+            if(errno != EINTR && errno != ECONNABORTED){
+                perror("Error to accept a client");
+                usleep(100000); // out of descriptors, most likely: let some close
+            }
+            continue;
+        }
+        atomic_fetch_add(&connections, 1);
+        serve(h, fd);
+
+        pthread_mutex_lock(&server_lock);
+        h -> conn = -1;
+        pthread_mutex_unlock(&server_lock);
+        close(fd);
+    }
+}
+
+int lookup_server_start(const char *path, int count, int (*push)(char **items, int n), int batch){
+    struct sockaddr_un addr;
+
+    if(strlen(path) >= sizeof(addr.sun_path)){
+        return -1;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+    strcpy(socket_path, path);
+    if((listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)) < 0){
+        return -1;
+    }
+    unlink(path); // left behind by a server that did not stop cleanly
+    if(bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(listen_fd, LOOKUP_SERVER_BACKLOG)){
+        close(listen_fd);
+        listen_fd = -1;
+        return -1;
+    }
+
+    push_items = push;
+    push_batch = batch;
+    if(!(handlers = calloc(count, sizeof(*handlers)))){
+        lookup_server_stop();
+        return -1;
+    }
+    for(int i = 0; i < count; i++){
+        struct handler *h = &handlers[i];
+        h -> conn = -1;
+        atomic_init(&h -> remaining, 0);
+        pthread_mutex_init(&h -> lock, NULL);
+        pthread_cond_init(&h -> done, NULL);
+        if(pthread_create(&h -> tid, NULL, handler_main, h)){
+            lookup_server_stop();
+            return -1;
+        }
+        num_handlers++;
+    }
+    return 0;
+}
+
+char *lookup_server_name(char *item){
+    return ((struct lookup_job *)item) -> name;
+}
+
+void lookup_server_complete(char *item, int status, const dns_addr_list *list){
+    struct lookup_job *job = (struct lookup_job *)item;
+    struct handler *h = job -> owner;
+
+    job -> status = status;
+    job -> list.count = 0;
+    if(status == UTIL_SUCCESS && list){
+        memcpy(&job -> list, list, DNS_ADDR_LIST_SIZE(list -> count));
+    }
+    if(atomic_fetch_sub(&h -> remaining, 1) == 1){
+        pthread_mutex_lock(&h -> lock);
+        pthread_cond_signal(&h -> done);
+        pthread_mutex_unlock(&h -> lock);
+    }
+}
+
+void lookup_server_stop(void){
+    pthread_mutex_lock(&server_lock);
+    stopping = 1;
+    /* clients get the reply they are waiting for, then end of file */
+    for(int i = 0; i < num_handlers; i++){
+        if(handlers[i].conn >= 0){
+            shutdown(handlers[i].conn, SHUT_RD);
+        }
+    }
+    pthread_mutex_unlock(&server_lock);
+
+    /* wake every handler still in accept() */
+    if(listen_fd >= 0){
+        shutdown(listen_fd, SHUT_RDWR);
+    }
+    for(int i = 0; i < num_handlers; i++){
+        pthread_join(handlers[i].tid, NULL);
+        pthread_mutex_destroy(&handlers[i].lock);
+        pthread_cond_destroy(&handlers[i].done);
+    }
+    free(handlers);
+    handlers = NULL;
+    num_handlers = 0;
+    if(listen_fd >= 0){
+        close(listen_fd);
+        unlink(socket_path);
+        listen_fd = -1;
+    }
+}
+
+void lookup_server_report(FILE *out){
+    fprintf(out, "Served %ld connections, %ld requests, %ld names, refused %ld malformed requests\n",
+            atomic_load(&connections), atomic_load(&requests), atomic_load(&names), atomic_load(&bad_requests));
+}
@@ -0,0 +1,52 @@
+/*
+ * File: lookup_server.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Resolver daemon (-L/--listen=SOCKET): multi-lookup keeps its
+ *      queue, resolvers and caches running and answers batches of names
+ *      sent over a Unix domain socket (protocol in lookup_proto.h,
+ *      client in lookup_client.c).
+ *
+ *      The requester threads become connection handlers: each accepts
+ *      a client, reads its request frames and queues the names for the
+ *      resolvers in batches, exactly as it would names read from a file.
+ *      Resolvers hand each answer back with lookup_server_complete()
+ *      instead of writing a results file; once every name of a request
+ *      has its answer the handler sends the reply, answers in request
+ *      order. Each handler serves one connection at a time, so as many
+ *      clients as handlers are served at once and more wait in the
+ *      listen backlog.
+ *
+ *      While serving, the resolver queue carries lookup_server items
+ *      instead of names; lookup_server_name() gives the name back.
+ */
+
+#ifndef LOOKUP_SERVER_H
+#define LOOKUP_SERVER_H
+
+#include <stdio.h>
+#include "util.h"
+
+#define LOOKUP_SERVER_MAX_HANDLERS 64
+#define LOOKUP_SERVER_BACKLOG 128
+
+/* Listen on a Unix socket at path (a stale socket file there is
+ * replaced) and start handlers threads that queue names with push,
+ * batch at a time. push returns how many it queued.
+ * Returns 0 on success, -1 on failure */
+int lookup_server_start(const char *path, int handlers, int (*push)(char **items, int n), int batch);
+
+/* The name behind a queued item */
+char *lookup_server_name(char *item);
+
+/* The answer for a queued item, status UTIL_SUCCESS or UTIL_FAILURE */
+void lookup_server_complete(char *item, int status, const dns_addr_list *list);
+
+/* Stop accepting, let every handler finish the request it is working on,
+ * close the connections and remove the socket file */
+void lookup_server_stop(void);
+
+/* Connections, requests and names served, for the summary */
+void lookup_server_report(FILE *out);
+
+#endif
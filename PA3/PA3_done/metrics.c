@@ -0,0 +1,196 @@
+/*
+ * File: metrics.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Runtime metrics for the multi-lookup pipeline. See metrics.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+#include "latency.h"
+#include "metrics.h"
+
+struct metrics_slot {
+    struct metrics_slot *next;
+    const char *role;
+    int tid;
+    atomic_llong names;
+    atomic_llong work_ns;
+    atomic_llong queue_ns;
+};
+
+static FILE *out = NULL;
+static int interval;
+static safe_q *watch_q;
+static steal_pool *watch_pool;
+static long long started;
+static long long occupancy[METRICS_OCCUPANCY_BUCKETS]; // metrics thread only
+static long long samples = 0;
+
+static struct metrics_slot *slots = NULL;
+static pthread_mutex_t slots_lock = PTHREAD_MUTEX_INITIALIZER;
+static __thread struct metrics_slot *mine = NULL;
+
+static pthread_t metrics_tid;
+static pthread_mutex_t stop_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t stop_cond = PTHREAD_COND_INITIALIZER;
+static int stopping = 0;
+
+long long metrics_clock_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* single writer: a relaxed load and store instead of a locked add */
+static void bump(atomic_llong *v, long long by){
+    atomic_store_explicit(v, atomic_load_explicit(v, memory_order_relaxed) + by, memory_order_relaxed);
+}
+
+static long long get(atomic_llong *v){
+    return atomic_load_explicit(v, memory_order_relaxed);
+}
+
+void metrics_thread(const char *role){
+    if(!out || mine){
+        return;
+    }
+    if(!(mine = calloc(1, sizeof(*mine)))){
+        return; // this thread goes uncounted
+    }
+    mine -> role = role;
+    mine -> tid = (int)syscall(SYS_gettid);
+    pthread_mutex_lock(&slots_lock);
+    mine -> next = slots;
+    slots = mine;
+    pthread_mutex_unlock(&slots_lock);
+}
+
+void metrics_names(long long n){
+    if(mine){
+        bump(&mine -> names, n);
+    }
+}
+
+void metrics_work(long long ns){
+    if(mine){
+        bump(&mine -> work_ns, ns);
+    }
+}
+
+void metrics_queue(long long ns){
+    if(mine){
+        bump(&mine -> queue_ns, ns);
+    }
+}
+
+long long metrics_queue_total(void){
+    return mine ? get(&mine -> queue_ns) : 0;
+}
+
+static void sample_queue(void){
+    int depth = watch_q ? safe_q_size(watch_q) : steal_pool_size(watch_pool);
+    int capacity = watch_q ? watch_q -> capacity : watch_pool -> num_deques * watch_pool -> capacity;
+    int b = (int)((long long)depth * (METRICS_OCCUPANCY_BUCKETS - 1) / capacity);
+
+    occupancy[b < METRICS_OCCUPANCY_BUCKETS ? b : METRICS_OCCUPANCY_BUCKETS - 1]++;
+    samples++;
+}
+
+/* One JSON line with everything collected so far */
+static void write_record(int final){
+    safe_q_stats *st = watch_q ? &watch_q -> stats : &watch_pool -> stats;
+
+    fprintf(out, "{\"elapsed_ms\":%lld,\"final\":%s,\"queue\":{", (metrics_clock_ns() - started) / 1000000,
+            final ? "true" : "false");
+    fprintf(out, "\"backend\":\"%s\",\"capacity\":%d,\"depth\":%d,\"samples\":%lld,\"occupancy\":[",
+            watch_q ? safe_q_kind_name(watch_q -> kind) : "steal",
+            watch_q ? watch_q -> capacity : watch_pool -> num_deques * watch_pool -> capacity,
+            watch_q ? safe_q_size(watch_q) : steal_pool_size(watch_pool), samples);
+    for(int i = 0; i < METRICS_OCCUPANCY_BUCKETS; i++){
+        fprintf(out, "%s%lld", i ? "," : "", occupancy[i]);
+    }
+    fprintf(out, "],\"push_waits\":%lld,\"push_wait_ns\":%lld,\"pop_waits\":%lld,\"pop_wait_ns\":%lld,"
+            "\"lock_contended\":%lld,\"cas_retries\":%lld,\"steals\":%lld},\"latency\":",
+            get(&st -> push_waits), get(&st -> push_wait_ns), get(&st -> pop_waits), get(&st -> pop_wait_ns),
+            get(&st -> lock_contended), get(&st -> cas_retries), get(&st -> steals));
+    latency_json(out);
+    fprintf(out, ",\"threads\":[");
+    pthread_mutex_lock(&slots_lock);
+    for(struct metrics_slot *s = slots; s; s = s -> next){
+        fprintf(out, "%s{\"role\":\"%s\",\"tid\":%d,\"names\":%lld,\"work_ns\":%lld,\"queue_ns\":%lld}",
+                s == slots ? "" : ",", s -> role, s -> tid, get(&s -> names), get(&s -> work_ns), get(&s -> queue_ns));
+    }
+    pthread_mutex_unlock(&slots_lock);
+    fprintf(out, "]}\n");
+    fflush(out);
+}
+
+static void *metrics_main(void *unused){
+    long long next_record = started + (long long)interval * 1000000;
+    (void)unused;
+
+    pthread_mutex_lock(&stop_lock);
+    while(!stopping){
+        struct timespec wake;
+        clock_gettime(CLOCK_REALTIME, &wake);
+        wake.tv_nsec += METRICS_SAMPLE_MS * 1000000L;
+        wake.tv_sec += wake.tv_nsec / 1000000000L;
+        wake.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&stop_cond, &stop_lock, &wake);
+        if(stopping){
+            break;
+        }
+        pthread_mutex_unlock(&stop_lock);
+        sample_queue();
+        if(metrics_clock_ns() >= next_record){
+            write_record(0);
+            next_record += (long long)interval * 1000000;
+        }
+        pthread_mutex_lock(&stop_lock);
+    }
+    pthread_mutex_unlock(&stop_lock);
+    return NULL;
+}
+
+int metrics_start(const char *path, int interval_ms, safe_q *q, steal_pool *pool){
+    if(!(out = fopen(path, "a"))){ // each run ends with its "final" line
+        return -1;
+    }
+    interval = interval_ms;
+    watch_q = q;
+    watch_pool = pool;
+    started = metrics_clock_ns();
+    stopping = 0;
+    if(pthread_create(&metrics_tid, NULL, metrics_main, NULL)){
+        fclose(out);
+        out = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+void metrics_stop(void){
+    if(!out){
+        return;
+    }
+    pthread_mutex_lock(&stop_lock);
+    stopping = 1;
+    pthread_cond_signal(&stop_cond);
+    pthread_mutex_unlock(&stop_lock);
+    pthread_join(metrics_tid, NULL);
+
+    write_record(1);
+    fclose(out);
+    out = NULL;
+    while(slots){
+        struct metrics_slot *s = slots;
+        slots = s -> next;
+        free(s);
+    }
+}
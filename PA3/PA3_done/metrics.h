@@ -0,0 +1,57 @@
+/*
+ * File: metrics.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Runtime metrics for the requester -> queue -> resolver pipeline
+ *      (-M/--metrics=PATH).
+ *
+ *      A metrics thread samples the queue depth every METRICS_SAMPLE_MS
+ *      into an occupancy histogram and every interval appends one JSON
+ *      line to PATH with:
+ *      - the queue: occupancy histogram, how often and how long pushers
+ *        slept on a full queue and poppers on an empty one, lock
+ *        contention, lost CAS races and steals (safe_q_stats)
+ *      - the lookup latency histogram (latency.h)
+ *      - per thread: names handled, time working (parsing input for a
+ *        requester, resolving for a resolver) and time inside queue
+ *        calls, blocked or not
+ *      A last line with "final":true is written by metrics_stop().
+ *
+ *      Threads only add to counters of their own, so recording costs a
+ *      couple of plain stores; nothing is recorded unless -M is given.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include "safe_q.h"
+#include "steal_pool.h"
+
+#define METRICS_DEFAULT_INTERVAL_MS 1000
+#define METRICS_SAMPLE_MS 10
+#define METRICS_OCCUPANCY_BUCKETS 11 // 0-9% full, ..., 90-99%, 100%
+
+/* Open path for appending and start the metrics thread, watching q, or
+ * pool if q is NULL. Returns 0 on success, -1 on failure */
+int metrics_start(const char *path, int interval_ms, safe_q *q, steal_pool *pool);
+
+/* Called by each requester and resolver before it records anything.
+ * role is "requester" or "resolver" */
+void metrics_thread(const char *role);
+
+/* Add to the calling thread's counters */
+void metrics_names(long long n);
+void metrics_work(long long ns);
+void metrics_queue(long long ns);
+
+/* Queue time added by the calling thread so far */
+long long metrics_queue_total(void);
+
+/* CLOCK_MONOTONIC in ns */
+long long metrics_clock_ns(void);
+
+/* Stop the metrics thread and write the final line. Call once the
+ * requesters and resolvers are done */
+void metrics_stop(void);
+
+#endif
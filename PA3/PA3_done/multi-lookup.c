@@ -9,6 +9,13 @@
 #include <sys/syscall.h> // gettid()
 #include "multi-lookup.h"
 #include <sys/time.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <ctype.h>
+#include <signal.h>
+#include <stdatomic.h>
 
 /* Test for extra creait */
 #include <netdb.h>
@@ -16,11 +23,181 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 
-// declare  mutex object
-pthread_mutex_t shared_array_input_lock;
-pthread_mutex_t shared_array_output_lock;
-safe_q shared_array;
-bool finishedEnding = false;
+safe_q *shared_array; // mapped on the resolvers' node, see safe_q_create()
+int queue_kind = SAFE_Q_DEFAULT;
+steal_pool *resolver_pool; // per-resolver deques, used instead of shared_array with -w
+bool work_stealing = false;
+int batch_size = 1; // names moved per queue operation
+bool use_mmap = false; // read input files through name_map
+bool use_cache = false; // answer repeated names from dns_cache
+char *cache_file = NULL; // dns_store file shared between runs
+int cache_ttl = DNS_STORE_DEFAULT_TTL;
+bool use_async = false; // resolvers send their own queries through dns_async
+int worker_procs = 0; // -P: lookups made by this many forked processes
+const char *preload_path = NULL; // -Z: names answered from a table, no lookup
+host_table *preload = NULL;
+atomic_long preload_hits;
+int async_inflight = DNS_ASYNC_DEFAULT_INFLIGHT; // per resolver
+char *dns_server = NULL; // NULL = first nameserver in /etc/resolv.conf
+bool all_addresses = false; // list every address of a name, not just the first
+bool echo_results = false; // copy the results file to the terminal
+int output_format = RESULT_FORMAT_TEXT; // -F: results file layout
+FILE *serviced_fp; // which requester read which input unit
+bool adaptive_pool = false; // resize the resolver pool while running
+int pool_min = 1, pool_max = MAX_RESOLVER_THREADS;
+char *backend_spec = NULL; // -B, NULL = system getaddrinfo()
+char *metrics_file = NULL; // JSON metrics every metrics_interval ms
+int metrics_interval = METRICS_DEFAULT_INTERVAL_MS;
+bool ordered_output = false; // results in input order, queue items are reorder slots
+int reorder_window = REORDER_DEFAULT_WINDOW;
+bool stream_mode = false; // results leave as soon as the resolvers run out of names
+char *listen_path = NULL; // -L: serve lookups on this Unix socket, queue items are lookup_server jobs
+bool hedging = false; // -H: look slow names up a second time
+bool pinning = false; // --pin-*: threads pinned to CPU sets
+double hedge_pct = HEDGE_DEFAULT_PERCENTILE, hedge_budget = HEDGE_DEFAULT_BUDGET;
+bool dedup = false; // -D: resolve each distinct name once, expand the results afterwards
+size_t dedup_memory = (size_t)DEDUP_DEFAULT_MB << 20;
+
+/* the unit a requester is reading and how many of its names it has queued, for -o */
+static __thread int unit_index;
+static __thread long long unit_names;
+
+/* long options without a short one */
+enum {
+    OPT_PIN_REQUESTERS = 256, // same order as AFFINITY_REQUESTER...
+    OPT_PIN_RESOLVERS,
+    OPT_PIN_WRITER
+};
+
+static struct option long_options[] = {
+    {"queue", required_argument, NULL, 'q'},
+    {"steal", no_argument, NULL, 'w'},
+    {"batch", required_argument, NULL, 'b'},
+    {"mmap", no_argument, NULL, 'm'},
+    {"cache", no_argument, NULL, 'c'},
+    {"cache-file", required_argument, NULL, 'C'},
+    {"cache-ttl", required_argument, NULL, 'T'},
+    {"async", no_argument, NULL, 'a'},
+    {"inflight", required_argument, NULL, 'n'},
+    {"dns-server", required_argument, NULL, 's'},
+    {"all-addresses", no_argument, NULL, 'A'},
+    {"echo", no_argument, NULL, 'e'},
+    {"pool", required_argument, NULL, 'p'},
+    {"metrics", required_argument, NULL, 'M'},
+    {"backend", required_argument, NULL, 'B'},
+    {"metrics-interval", required_argument, NULL, 'I'},
+    {"ordered", optional_argument, NULL, 'o'},
+    {"stream", no_argument, NULL, 'S'},
+    {"listen", required_argument, NULL, 'L'},
+    {"hedge", optional_argument, NULL, 'H'},
+    {"format", required_argument, NULL, 'F'},
+    {"processes", required_argument, NULL, 'P'},
+    {"preload", required_argument, NULL, 'Z'},
+    {"dedup", optional_argument, NULL, 'D'},
+    {"pin-requesters", required_argument, NULL, OPT_PIN_REQUESTERS},
+    {"pin-resolvers", required_argument, NULL, OPT_PIN_RESOLVERS},
+    {"pin-writer", required_argument, NULL, OPT_PIN_WRITER},
+    {NULL, 0, NULL, 0}
+};
+
+/* Answer a name that is not in the in-memory cache: the cache file
+ * first, then the -B backend whose answer goes back into the file */
+static int backend_lookup(const char *hostname, dns_addr_list *list){
+    int status;
+
+    if(!cache_file){
+        return dns_backend_lookup(hostname, list);
+    }
+    if((status = dns_store_lookup(hostname, list)) != DNS_STORE_MISS){
+        return status;
+    }
+    status = dns_backend_lookup(hostname, list);
+    dns_store_insert(hostname, status, list);
+    return status;
+}
+
+/* What resolvers and -c ask on a miss: backend_lookup(), hedged with -H */
+static int lookup_name(const char *hostname, dns_addr_list *list){
+    return hedging ? hedge_lookup(hostname, list) : backend_lookup(hostname, list);
+}
+
+/* -P: what a worker process does with each name */
+static int worker_lookup(const char *hostname, dns_addr_list *list){
+    affinity_pin(AFFINITY_RESOLVER); // the worker's first name pins it
+    return backend_lookup(hostname, list);
+}
+
+/* The name behind a queue item: the item itself, its reorder slot's with
+ * -o or its client request's with -L */
+static char *queued_name(char *item){
+    if(listen_path){
+        return lookup_server_name(item);
+    }
+    return ordered_output ? reorder_name(item) : item;
+}
+
+/* Give back a name once it has been resolved. With -L names live in the
+ * client's request, which the connection handler frees */
+static void release_name(char *name){
+    if(!listen_path){
+        name_release(name);
+    }
+}
+
+/* Give back a queue item nobody will resolve */
+static void release_item(char *item){
+    release_name(queued_name(item));
+}
+
+static int dispatch_push_batch(char **names, int n);
+static void async_done(void *arg, int status, const dns_addr_list *list, long long elapsed_ns);
+
+/* -L: connection handlers queue client names like requesters queue file names */
+static int serve_push(char **items, int n){
+    metrics_thread("requester");
+    affinity_pin(AFFINITY_REQUESTER);
+    return dispatch_push_batch(items, n);
+}
+
+/* Pinned CPU sets and the node the queue ended up on */
+static void report_placement(FILE *out){
+    /* the control block and the rings share the queue's own mapping */
+    int node = affinity_node_of(work_stealing ? (const void *)resolver_pool : (const void *)shared_array);
+
+    affinity_report(out);
+    if(node >= 0){
+        fprintf(out, "Queue memory on node %d\n", node);
+    }
+    else{
+        fprintf(out, "Queue memory on an unknown node (no NUMA support)\n");
+    }
+}
+
+/* Names waiting for a resolver, for the adaptive pool's controller and -S */
+static int queued_names(void){
+    return work_stealing ? steal_pool_size(resolver_pool) : safe_q_size(shared_array);
+}
+
+/* -S: hand over the results this thread has so far instead of waiting
+ * for a full buffer */
+static void flush_results(void){
+    if(ordered_output){
+        reorder_flush();
+    }
+    else{
+        result_writer_flush();
+    }
+}
+
+/* -S: nothing left to resolve right now, so flush. Only for loops that
+ * come back here without sleeping; before sleeping on the queue use
+ * idle_pop_batch(), another resolver may take the last name in between */
+static void flush_if_idle(void){
+    if(!stream_mode || queued_names() > 0){
+        return;
+    }
+    flush_results();
+}
 
 int main(int argc, char *argv[])
 {
@@ -28,21 +205,225 @@ int main(int argc, char *argv[])
     struct timeval start, end;
 
     gettimeofday(&start, NULL);
+
+    /* options come before the positional arguments */
+    int opt;
+    while((opt = getopt_long(argc, argv, "+q:wb:mcC:T:an:s:Aep:M:I:B:o::SL:H::F:P:Z:D::", long_options, NULL)) != -1){
+        switch(opt){
+        case 'q':
+            if((queue_kind = safe_q_kind_from_name(optarg)) < 0){
+                fprintf(stderr, "Unknown queue backend %s\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'w':
+            work_stealing = true;
+            break;
+        case 'm':
+            use_mmap = true;
+            break;
+        case 'c':
+            use_cache = true;
+            break;
+        case 'C':
+            cache_file = optarg;
+            break;
+        case 'T':
+            cache_ttl = atoi(optarg);
+            if(cache_ttl < 1){
+                fprintf(stderr, "Cache TTL must be at least one second\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'a':
+            use_async = true;
+            break;
+        case 'n':
+            async_inflight = atoi(optarg);
+            if(async_inflight < 1 || async_inflight > DNS_ASYNC_MAX_INFLIGHT){
+                fprintf(stderr, "Queries in flight must be between 1 and %d\n", DNS_ASYNC_MAX_INFLIGHT);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 's':
+            dns_server = optarg;
+            break;
+        case 'A':
+            all_addresses = true;
+            break;
+        case 'e':
+            echo_results = true;
+            break;
+        case 'p':
+            if(sscanf(optarg, "%d:%d", &pool_min, &pool_max) != 2 ||
+               pool_min < 1 || pool_max < pool_min || pool_max > ADAPT_POOL_MAX_THREADS){
+                fprintf(stderr, "Resolver pool must be MIN:MAX with 1 <= MIN <= MAX <= %d\n", ADAPT_POOL_MAX_THREADS);
+                return EXIT_FAILURE;
+            }
+            adaptive_pool = true;
+            break;
+        case 'M':
+            metrics_file = optarg;
+            break;
+        case 'B':
+            backend_spec = optarg;
+            break;
+        case 'I':
+            metrics_interval = atoi(optarg);
+            if(metrics_interval < METRICS_SAMPLE_MS){
+                fprintf(stderr, "Metrics interval must be at least %d ms\n", METRICS_SAMPLE_MS);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'o':
+            ordered_output = true;
+            if(optarg){
+                reorder_window = atoi(optarg);
+                if(reorder_window < 1 || reorder_window > REORDER_MAX_WINDOW){
+                    fprintf(stderr, "Reorder window must be between 1 and %d names\n", REORDER_MAX_WINDOW);
+                    return EXIT_FAILURE;
+                }
+            }
+            break;
+        case 'F':
+            if(!strcmp(optarg, "text")){
+                output_format = RESULT_FORMAT_TEXT;
+            }
+            else if(!strcmp(optarg, "binary")){
+                output_format = RESULT_FORMAT_BINARY;
+            }
+            else{
+                fprintf(stderr, "Unknown format %s (text or binary)\n", optarg);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'P':
+            worker_procs = atoi(optarg);
+            if(worker_procs < 1 || worker_procs > PROC_POOL_MAX_WORKERS){
+                fprintf(stderr, "Resolver processes must be between 1 and %d\n", PROC_POOL_MAX_WORKERS);
+                return EXIT_FAILURE;
+            }
+            break;
+        case 'Z':
+            preload_path = optarg;
+            break;
+        case 'D':
+            dedup = true;
+            if(optarg){
+                long mb = atol(optarg);
+                if(mb < 1 || mb > DEDUP_MAX_MB){
+                    fprintf(stderr, "Dedup memory must be between 1 and %d MB\n", DEDUP_MAX_MB);
+                    return EXIT_FAILURE;
+                }
+                dedup_memory = (size_t)mb << 20;
+            }
+            break;
+        case 'S':
+            stream_mode = true;
+            break;
+        case 'L':
+            listen_path = optarg;
+            break;
+        case 'H':
+            hedging = true;
+            if(optarg && (sscanf(optarg, "%lf:%lf", &hedge_pct, &hedge_budget) < 1 ||
+                          hedge_pct <= 0 || hedge_pct >= 100 || hedge_budget <= 0 || hedge_budget > 100)){
+                fprintf(stderr, "Hedge must be PCT[:BUDGET], a percentile below 100 and a budget up to 100%%\n");
+                return EXIT_FAILURE;
+            }
+            break;
+        case OPT_PIN_REQUESTERS:
+        case OPT_PIN_RESOLVERS:
+        case OPT_PIN_WRITER:
+            if(affinity_set(AFFINITY_REQUESTER + (opt - OPT_PIN_REQUESTERS), optarg)){
+                fprintf(stderr, "No usable CPU in %s (a list like 0-3,8 or nodeN)\n", optarg);
+                return EXIT_FAILURE;
+            }
+            pinning = true;
+            break;
+        case 'b':
+            batch_size = atoi(optarg);
+            if(batch_size < 1 || batch_size > MAX_BATCH_SIZE){
+                fprintf(stderr, "Batch size must be between 1 and %d\n", MAX_BATCH_SIZE);
+                return EXIT_FAILURE;
+            }
+            break;
+        default:
+            fprintf(stderr, "USAGE: \n %s %s \n%s", argv[0], USAGE, OPTIONS);
+            return EXIT_FAILURE;
+        }
+    }
+    /* -a sends its own queries instead of asking a backend */
+    if((backend_spec || hedging) && use_async){
+        fprintf(stderr, "%s cannot be combined with -a/--async\n", hedging ? "-H/--hedge" : "-B/--backend");
+        return EXIT_FAILURE;
+    }
+    /* the daemon has no input files and answers over its socket, not a results file */
+    if(listen_path && (ordered_output || stream_mode || echo_results)){
+        fprintf(stderr, "-L/--listen cannot be combined with %s\n",
+                ordered_output ? "-o/--ordered" : stream_mode ? "-S/--stream" : "-e/--echo");
+        return EXIT_FAILURE;
+    }
+    /* -e copies the results file to the terminal as it is */
+    if(output_format == RESULT_FORMAT_BINARY && (echo_results || listen_path)){
+        fprintf(stderr, "-F/--format=binary cannot be combined with %s\n", echo_results ? "-e/--echo" : "-L/--listen");
+        return EXIT_FAILURE;
+    }
+    /* -D reads every name before resolving any and writes the results grouped by name,
+     * through an ordered binary file of its own */
+    if(dedup && (listen_path || stream_mode || echo_results || ordered_output)){
+        fprintf(stderr, "-D/--dedup cannot be combined with %s\n", listen_path ? "-L/--listen" :
+                stream_mode ? "-S/--stream" : echo_results ? "-e/--echo" : "-o/--ordered");
+        return EXIT_FAILURE;
+    }
+    /* the workers make every lookup, one blocking call at a time, in processes without threads */
+    if(worker_procs && (use_async || hedging || adaptive_pool)){
+        fprintf(stderr, "-P/--processes cannot be combined with %s\n",
+                use_async ? "-a/--async" : hedging ? "-H/--hedge" : "-p/--pool");
+        return EXIT_FAILURE;
+    }
+    /* -w gives every resolver its own deque and -a keeps queries in flight
+     * per resolver, neither can lose or gain resolvers halfway through */
+    if(adaptive_pool && (work_stealing || use_async)){
+        fprintf(stderr, "-p/--pool cannot be combined with %s\n", work_stealing ? "-w/--steal" : "-a/--async");
+        return EXIT_FAILURE;
+    }
+    /* drop the options so argv[1] is the requester thread count again */
+    argv[optind - 1] = argv[0];
+    argc -= optind - 1;
+    argv += optind - 1;
+
     //local variables
     int num_names = argc -5;
+    char **inputs = argv + 5;
+    static char *stdin_only[] = {INPUT_STDIN};
+    char **prepassed = NULL; // -D: the input files, read by the pre-pass
+    int num_prepassed = 0;
+    if(stream_mode && argc == MIN_ARGUMENT - 1){
+        /* -S with no input files reads standard input */
+        inputs = stdin_only;
+        num_names = 1;
+        argc++;
+    }
     int num_requester_threads = atoi(argv[1]);
     int num_resolver_threads = atoi(argv[2]);
-    //initialize mutex object
-    pthread_mutex_init(&shared_array_input_lock, NULL);
-    pthread_mutex_init(&shared_array_output_lock, NULL);
     // check amount of arguments
-    if(argc < MIN_ARGUMENT){
-        fprintf(stderr, "I need more arguments %d\n", (argc - 5));
-        fprintf(stderr, "USAGE: \n %s %s \n", argv[0], USAGE);
-        return EXIT_FAILURE;
+    if(listen_path){
+        if(argc != 3){
+            fprintf(stderr, "USAGE: \n %s -L SOCKET [options] %s \n", argv[0], SERVER_USAGE);
+            return EXIT_FAILURE;
+        }
+        if(num_requester_threads < 1 || num_requester_threads > LOOKUP_SERVER_MAX_HANDLERS){
+            fprintf(stderr, "Connection handlers must be between 1 and %d\n", LOOKUP_SERVER_MAX_HANDLERS);
+            return EXIT_FAILURE;
+        }
+        if(!adaptive_pool && num_resolver_threads > MAX_RESOLVER_THREADS){
+            fprintf(stderr, "Resolver threads are too many! %d\n", num_resolver_threads);
+            return EXIT_FAILURE;
+        }
     }
-    else if (argc > MAX_ARGUMENT){
-        fprintf(stderr, "Wat too much!! %d \n", (argc - 5));
+    else if(argc < MIN_ARGUMENT){
+        fprintf(stderr, "I need more arguments %d\n", (argc - 5));
         fprintf(stderr, "USAGE: \n %s %s \n", argv[0], USAGE);
         return EXIT_FAILURE;
     }
@@ -50,42 +431,193 @@ int main(int argc, char *argv[])
         fprintf(stderr, "Requeseter threads are too many! %d\n", num_requester_threads);
         return EXIT_FAILURE;
     }
-    else if (num_resolver_threads > MAX_RESOLVER_THREADS){
+    else if (!adaptive_pool && num_resolver_threads > MAX_RESOLVER_THREADS){
         fprintf(stderr, "Resolver threads are too many! %d\n", num_resolver_threads);
         return EXIT_FAILURE; 
     }
     
-    // get the number of processor cores and create that many resolvers
-    int availCPU = sysconf( _SC_NPROCESSORS_ONLN );
-
-    FILE *outfile_test = NULL;
-    FILE *inputfps[num_names];
-    // check for bogus output file path
-    if(!(outfile_test = fopen(argv[argc - 1], "w"))){
-        fprintf(stderr, "Bogus output file path...exiting\n");
-        fprintf(stderr, "Usage: \n %s %s \n", argv[0], USAGE);
-        return EXIT_FAILURE;
+    input_units units;
+    sigset_t stop_signals;
+    int final_format = output_format; // -D: what dedup_expand() writes
+    if(listen_path){
+        /* only main takes SIGINT and SIGTERM, every thread started later inherits the mask */
+        sigemptyset(&stop_signals);
+        sigaddset(&stop_signals, SIGINT);
+        sigaddset(&stop_signals, SIGTERM);
+        pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
     }
-    //Open input files or try at least
-    for(int i = 1; i < (argc -1); i++){
-        inputfps[i - 1] = fopen(argv[i], "r"); 
+    else{
+        unsigned char header[RESULT_FORMAT_HEADER_SIZE];
+        size_t header_len;
+        const char *results_path = argv[3];
+
+        if(dedup){
+            /* the resolvers only see the distinct names, in sorted order, and
+             * answer them into a binary file that dedup_expand() reads back */
+            if(dedup_init(argv[3], dedup_memory)){
+                fprintf(stderr, "Bogus output file path...exiting\n");
+                fprintf(stderr, "Usage: \n %s %s \n", argv[0], USAGE);
+                return EXIT_FAILURE;
+            }
+            if(dedup_prepass(inputs, num_names)){
+                fprintf(stderr, "Unable to deduplicate the input files\n");
+                dedup_cleanup();
+                return EXIT_FAILURE;
+            }
+            static char *unique_only[1];
+            unique_only[0] = (char *)dedup_unique_path();
+            prepassed = inputs;
+            num_prepassed = num_names;
+            inputs = unique_only;
+            num_names = 1;
+            results_path = dedup_answers_path();
+            final_format = output_format;
+            output_format = RESULT_FORMAT_BINARY;
+            ordered_output = true;
+        }
+        header_len = (output_format == RESULT_FORMAT_BINARY) ? result_format_header(header) : 0;
+
+        // check for bogus output file path, the writer thread owns the results file once it starts
+        if(result_writer_open(results_path, echo_results, header, header_len,
+                              adaptive_pool ? pool_max : num_resolver_threads)){
+            fprintf(stderr, "Bogus output file path...exiting\n");
+            fprintf(stderr, "Usage: \n %s %s \n", argv[0], USAGE);
+            return EXIT_FAILURE;
+        }
+        if(!strcmp(argv[3], "-")){
+            /* results own standard output now, progress messages go to stderr */
+            fflush(stdout);
+            dup2(STDERR_FILENO, STDOUT_FILENO);
+        }
+        if(!(serviced_fp = fopen(argv[4], "w"))){
+            fprintf(stderr, "Bogus serviced file path...exiting\n");
+            fprintf(stderr, "Usage: \n %s %s \n", argv[0], USAGE);
+            return EXIT_FAILURE;
+        }
+        if(dedup){
+            /* the pre-pass on this thread read the input files, the
+             * requesters only read the temporary file of distinct names */
+            for(int i = 0; i < num_prepassed; i++){
+                fprintf(serviced_fp, "Thread %d serviced %s\n", gettid(), prepassed[i]);
+            }
+        }
+        //Split the input files into units for the requesters
+        if(input_units_plan(&units, inputs, num_names, use_mmap)){
+            fprintf(stderr, "Unable to split the input files\n");
+            return EXIT_FAILURE;
+        }
     }
-    fclose(outfile_test); 
 
     printf("TID os this thread: %d\n", gettid());
     printf("Number for requester thread = %d\n", num_requester_threads);
     printf("Number for resolver threads = %d\n", num_resolver_threads);
-    
+    if(listen_path){
+        printf("Input = clients of %s, one connection per requester thread\n", listen_path);
+    }
+    else{
+        printf("Input = %d files in %d units\n", num_names, units.count);
+    }
+    if(adaptive_pool){
+        printf("Resolver pool = adaptive, %d to %d threads\n", pool_min, pool_max);
+    }
+    printf("Batch size = %d\n", batch_size);
+    if(stream_mode){
+        printf("Output = streamed, results written whenever the resolvers catch up\n");
+    }
+    if(ordered_output){
+        printf("Output order = input order, window of %d names\n", reorder_window);
+    }
+    printf("Queue backend = %s\n", work_stealing ? "per-resolver deques with stealing" : safe_q_kind_name(queue_kind));
+
+    if(backend_spec && dns_backend_select(backend_spec)){
+        fprintf(stderr, "Unable to use resolver backend %s\n", backend_spec);
+        return EXIT_FAILURE;
+    }
+    if(!use_async){
+        printf("Resolver backend = %s\n", dns_backend_name());
+    }
+    if(preload_path){
+        if(!(preload = host_table_open(preload_path))){
+            fprintf(stderr, "Unable to preload names from %s\n", preload_path);
+            return EXIT_FAILURE;
+        }
+        printf("Preloaded names = %zu from %s %s\n", host_table_count(preload),
+               host_table_mapped(preload) ? "image" : "file", preload_path);
+    }
+    if(hedging){
+        if(hedge_init(hedge_pct, hedge_budget, backend_lookup)){
+            fprintf(stderr, "Unable to set up hedged lookups\n");
+            return EXIT_FAILURE;
+        }
+        printf("Hedging = lookups slower than p%g of recent ones, at most %g%% of them\n", hedge_pct, hedge_budget);
+    }
+    if(use_async){
+        if(dns_async_set_server(dns_server)){
+            fprintf(stderr, "Bad name server address %s\n", dns_server ? dns_server : "in /etc/resolv.conf");
+            return EXIT_FAILURE;
+        }
+        printf("Resolver engine = async UDP to %s, %d queries in flight per resolver\n", dns_async_server_name(), async_inflight);
+    }
+
+    if(cache_file && dns_store_open(cache_file, cache_ttl)){
+        fprintf(stderr, "Unable to use cache file %s\n", cache_file);
+        return EXIT_FAILURE;
+    }
+    if(use_cache && dns_cache_init(lookup_name, cache_ttl)){
+        fprintf(stderr, "Unable to allocate the DNS cache\n");
+        return EXIT_FAILURE;
+    }
+
+    /* after the backend and the cache file are set up, which the workers
+     * inherit, and before any thread is started */
+    if(worker_procs){
+        if(proc_pool_start(worker_procs, worker_procs * PROC_POOL_SLOTS_PER_WORKER, worker_lookup, async_done)){
+            fprintf(stderr, "Unable to start the resolver processes\n");
+            return EXIT_FAILURE;
+        }
+        printf("Resolver processes = %d, %d names in flight each\n", worker_procs, PROC_POOL_SLOTS_PER_WORKER);
+    }
+    /* the first thread: the workers above are forked from a process without any */
+    if(!listen_path && result_writer_start()){
+        fprintf(stderr, "Unable to start the result writer\n");
+        return EXIT_FAILURE;
+    }
+
     // initialize the shared_array. Must be initialize before use
-    shared_array = create_safe_q(50);
+    /* on the resolvers' CPUs, so the queue's pages are on their node */
+    affinity_enter(AFFINITY_RESOLVER);
+    if(work_stealing){
+        if(!(resolver_pool = steal_pool_create(num_resolver_threads, QUEUE_SIZE))){
+            fprintf(stderr, "Unable to allocate the resolver deques\n");
+            return EXIT_FAILURE;
+        }
+    }
+    else if(!(shared_array = safe_q_create(QUEUE_SIZE, queue_kind))){
+        fprintf(stderr, "Unable to allocate the shared array\n");
+        return EXIT_FAILURE;
+    }
+    affinity_leave();
     
-    //Create requester thread pool for each input file
+    if(ordered_output && reorder_init(reorder_window, units.count)){
+        fprintf(stderr, "Unable to allocate the reorder window\n");
+        return EXIT_FAILURE;
+    }
+
+    if(metrics_file && metrics_start(metrics_file, metrics_interval, work_stealing ? NULL : shared_array, resolver_pool)){
+        fprintf(stderr, "Unable to write metrics to %s\n", metrics_file);
+        return EXIT_FAILURE;
+    }
+
+    // echoed results go straight to the terminal's file descriptor
+    fflush(stdout);
+
+    //Create requester thread pool, any requester reads any input unit
     int rc_req;
     pthread_t requester_threads[num_requester_threads];
 
-    for (int t = 0; t < num_requester_threads; t++){
+    for (int t = 0; !listen_path && t < num_requester_threads; t++){
         printf("In main: creating requester thread %d\n", t); 
-        rc_req = pthread_create(&(requester_threads[t]), NULL, addReqToArray, (void*)argv[t + 5]); //plus five to avoid the first argument, which is the executable.. 
+        rc_req = pthread_create(&(requester_threads[t]), NULL, addReqToArray, &units);
         if(rc_req){
             printf("ERROR; return code from pthread_create() is %d\n", rc_req);
             exit(EXIT_FAILURE);
@@ -94,190 +626,659 @@ int main(int argc, char *argv[])
     
     /* Create resolver thread pool for resolving DNS */
     int rc_res;
-    pthread_t resolver_threads[num_resolver_threads];
+    pthread_t resolver_threads[adaptive_pool ? 1 : num_resolver_threads];
 
-    for(int t = 0; t < num_resolver_threads; t ++){
+    if(adaptive_pool){
+        printf("In main: starting adaptive resolver pool with %d threads\n", num_resolver_threads);
+        if(adapt_pool_start(num_resolver_threads, pool_min, pool_max, resolve_DNS, queued_names, QUEUE_SIZE)){
+            printf("ERROR; unable to start the resolver pool\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    for(int t = 0; !adaptive_pool && t < num_resolver_threads; t ++){
         printf("In main: creating resolver thread %d\n", t);
-        rc_res = pthread_create(&(resolver_threads[t]), NULL, resolve_DNS, (void*)argv[num_resolver_threads]); ////////////////// argc = 10 because 
+        rc_res = pthread_create(&(resolver_threads[t]), NULL, resolve_DNS, (void*)(intptr_t)t); // t picks the resolver's own deque with -w
         if(rc_res){
             printf("ERROR; return code from pthread_create() is %d\n", rc_res);
             exit(EXIT_FAILURE);
         }
     }
 
+    if(listen_path){
+        /* the requesters are the server's connection handlers */
+        int sig;
+        if(lookup_server_start(listen_path, num_requester_threads, serve_push, batch_size)){
+            fprintf(stderr, "Unable to listen on %s\n", listen_path);
+            exit(EXIT_FAILURE);
+        }
+        printf("Listening on %s until SIGINT or SIGTERM\n", listen_path);
+        fflush(stdout);
+        sigwait(&stop_signals, &sig);
+        printf("Stopping on signal %d\n", sig);
+        lookup_server_stop();
+    }
     /* Wait for requester threads to finish*/
-    for (int i = 0; i < num_requester_threads; i++){
+    for (int i = 0; !listen_path && i < num_requester_threads; i++){
         // Shall suspend execution of the calling thread until the target thread terminates
         pthread_join(requester_threads[i], NULL);
     }
     printf("All of the requester threads done!\n");
+    if(!listen_path){
+        fclose(serviced_fp);
+        input_units_cleanup(&units);
+    }
 
-    //set the flag true after creating thread pools
-    finishedEnding = true;
+    //no more input: resolvers drain what is left in the queue and exit
+    if(work_stealing){
+        steal_pool_close(resolver_pool);
+    }
+    else{
+        safe_q_close(shared_array);
+    }
     
     /* Wait for resolver threads to finish */
-    for (int i = 0; i < num_resolver_threads; i++){
+    if(adaptive_pool){
+        adapt_pool_stop();
+    }
+    for (int i = 0; !adaptive_pool && i < num_resolver_threads; i++){
         pthread_join(resolver_threads[i], NULL);
     }
+    if(worker_procs){
+        proc_pool_stop(); // every answer is in, the workers may go
+    }
+    metrics_stop();
+    int exit_status = EXIT_SUCCESS;
+    if(!listen_path && result_writer_stop()){
+        fprintf(stderr, "Unable to write every result to %s\n", argv[3]);
+        exit_status = EXIT_FAILURE;
+    }
+    else if(dedup && dedup_expand(final_format, all_addresses)){
+        fprintf(stderr, "Unable to expand the results into %s\n", argv[3]);
+        exit_status = EXIT_FAILURE;
+    }
     printf("All of the resolver threads done\n");
+    if(worker_procs){
+        proc_pool_report(stdout);
+    }
+    if(hedging){
+        /* every result is out; a hedge's loser may still be using the caches */
+        hedge_cleanup();
+        hedge_report(stdout);
+    }
+    if(adaptive_pool){
+        adapt_pool_report(stdout);
+    }
+    if(listen_path){
+        lookup_server_report(stdout);
+    }
+    latency_report(stdout);
+    latency_cleanup();
+    if(pinning){
+        report_placement(stdout);
+    }
+    if(ordered_output){
+        reorder_report(stdout);
+    }
+    if(use_cache){
+        dns_cache_report(stdout);
+        dns_cache_cleanup();
+    }
+    if(cache_file){
+        dns_store_report(stdout);
+        dns_store_close();
+    }
+    if(preload){
+        printf("Preloaded table answered %ld names\n", atomic_load(&preload_hits));
+        host_table_close(preload);
+    }
+    if(dedup){
+        dedup_report(stdout);
+        dedup_cleanup();
+    }
 
     /* clean up the shared array*/
-    safe_q_cleanup(&shared_array);
-    pthread_mutex_destroy(&shared_array_input_lock);
-    pthread_mutex_destroy(&shared_array_output_lock); 
+    if(work_stealing){
+        steal_pool_destroy(resolver_pool, release_item);
+    }
+    else{
+        safe_q_destroy(shared_array, release_item);
+    }
+    reorder_cleanup();
+    name_arena_pool_cleanup();
+    dns_backend_cleanup();
 
     gettimeofday(&end, NULL);
 
-    printf("Total run time: %ld\n", ((end.tv_sec - start.tv_sec)/1000000L + end.tv_usec) - start.tv_usec);
-    return 0;
+    printf("Total run time: %ld in microseconds\n", (end.tv_sec - start.tv_sec) * 1000000L + (end.tv_usec - start.tv_usec));
+    return exit_status;
 }
 
-/*Function that returns a void* and that takes a void* argument*/
-void *addReqToArray(void *input_file){
-    char hostname[SBUFFSIZE]; //hostname
-    
-    pid_t tid = gettid();
-    
-    FILE *tidopen = fopen("serviced.txt", "a");
-    fprintf(tidopen, "Thread %d serviced %s\n", tid, input_file);
-    if(!tidopen){
+/* Hand a batch of hostnames to the resolvers through whichever queue is in use.
+ * Returns how many were queued; fewer than n only if the queue was closed */
+static int dispatch_push_batch(char **names, int n){
+    long long since = metrics_clock_ns();
+    int pushed;
+
+    if(work_stealing){
+        pushed = steal_pool_push_batch(resolver_pool, names, n);
+    }
+    else{
+        pushed = safe_q_push_batch(shared_array, names, n);
+    }
+    metrics_queue(metrics_clock_ns() - since);
+    metrics_names(pushed);
+    return pushed;
+}
+
+/* Claim up to max hostnames for this resolver, 0 once there is no more input */
+static int dispatch_pop_batch(int resolver, char **names, int max){
+    long long since = metrics_clock_ns();
+    int took;
+
+    if(work_stealing){
+        took = steal_pool_pop_batch(resolver_pool, resolver, names, max);
+    }
+    else{
+        took = safe_q_pop_batch(shared_array, names, max);
+    }
+    metrics_queue(metrics_clock_ns() - since);
+    return took;
+}
+
+/* dispatch_pop_batch without sleeping: 0 if nothing is queued right now,
+ * -1 once there is no more input */
+static int dispatch_try_pop_batch(int resolver, char **names, int max){
+    long long since = metrics_clock_ns();
+    int took;
+
+    if(work_stealing){
+        took = steal_pool_try_pop_batch(resolver_pool, resolver, names, max);
+    }
+    else{
+        took = safe_q_try_pop_batch(shared_array, names, max);
+    }
+    metrics_queue(metrics_clock_ns() - since);
+    return took;
+}
+
+/* dispatch_pop_batch for a resolver that has results buffered: with -S
+ * it only sleeps after an empty try has flushed them */
+static int idle_pop_batch(int resolver, char **names, int max){
+    if(stream_mode){
+        int took = dispatch_try_pop_batch(resolver, names, max);
+        if(took != 0){
+            return took < 0 ? 0 : took;
+        }
+        flush_results();
+    }
+    return dispatch_pop_batch(resolver, names, max);
+}
+
+/* Queue the names collected so far and free any the queue refused */
+static void flush_batch(char **batch, int *pending){
+    if(*pending == 0){
+        return;
+    }
+    int pushed = dispatch_push_batch(batch, *pending);
+    for(int i = pushed; i < *pending; i++){
+        release_item(batch[i]);
+    }
+    *pending = 0;
+}
+
+/* Add one name to the batch, queueing the batch once it is full. With -o
+ * the name first needs its place in the reorder window; if it has to
+ * wait for one, the names held back in the batch go out first since the
+ * window may be waiting for them */
+static void add_to_batch(char *name, char **batch, int *pending){
+    if(ordered_output){
+        char *item = reorder_admit(unit_index, unit_names, name, 0);
+        if(!item){
+            flush_batch(batch, pending);
+            item = reorder_admit(unit_index, unit_names, name, 1);
+        }
+        unit_names++;
+        name = item;
+    }
+    batch[(*pending)++] = name;
+    if(*pending == batch_size){
+        flush_batch(batch, pending);
+    }
+}
+
+/* Queue the names of a mapped unit, pointers straight into the file */
+static void read_mapped_unit(input_unit *unit, name_arena *arena, char **batch, int *pending){
+    char *push_in;
+    size_t len;
+
+    while((push_in = name_map_next(&unit -> map, &len)) != NULL){
+        if(len <= NAME_MAP_MAX_TOKEN){
+            add_to_batch(push_in, batch, pending);
+            continue;
+        }
+        /* longer tokens are split like INPUTFS splits them, so -m reads the same names */
+        for(size_t at = 0; at < len; at += NAME_MAP_MAX_TOKEN){
+            size_t piece = (len - at < NAME_MAP_MAX_TOKEN) ? len - at : NAME_MAP_MAX_TOKEN;
+            char *copy = name_arena_copy(arena, push_in + at, piece);
+            if(!copy){
+                perror("Error to allocate hostname");
+                break;
+            }
+            add_to_batch(copy, batch, pending);
+        }
+    }
+    name_map_finish(&unit -> map);
+}
+
+/* Queue the names of a pipe, FIFO or standard input as they arrive: all
+ * that one read() returns is queued before the next read(), which may
+ * block for a long time. A full queue stops the reading, and so the
+ * writer at the other end of the pipe */
+static void read_stream_unit(input_unit *unit, name_arena *arena, char **batch, int *pending){
+    char buf[SBUFFSIZE + STREAM_READ_SIZE];
+    size_t have = 0; // start of a name the last read() cut off
+    int fd = strcmp(unit -> path, INPUT_STDIN) ? open(unit -> path, O_RDONLY) : STDIN_FILENO;
+
+    if(fd < 0){
         perror("Error to open file!");
-        return NULL;
+        return;
+    }
+    for(;;){
+        ssize_t n = read(fd, buf + have, STREAM_READ_SIZE);
+        if(n < 0 && errno == EINTR){
+            continue;
+        }
+        if(n < 0){
+            perror("Error to read input");
+            break;
+        }
+        size_t len = have + n, pos = 0;
+        have = 0;
+        while(pos < len){
+            while(pos < len && isspace((unsigned char)buf[pos])){
+                pos++;
+            }
+            size_t first = pos;
+            /* longer names are cut at SBUFFSIZE - 1 like INPUTFS does */
+            while(pos < len && !isspace((unsigned char)buf[pos]) && pos - first < SBUFFSIZE - 1){
+                pos++;
+            }
+            if(pos == first){
+                break;
+            }
+            if(pos == len && n > 0 && pos - first < SBUFFSIZE - 1){
+                have = pos - first;
+                memmove(buf, buf + first, have);
+                break;
+            }
+            char *push_in = name_arena_copy(arena, buf + first, pos - first);
+            if(!push_in){
+                perror("Error to allocate hostname");
+                break;
+            }
+            add_to_batch(push_in, batch, pending);
+        }
+        /* the next read() may wait: do not sit on names meanwhile */
+        flush_batch(batch, pending);
+        if(n == 0){
+            break;
+        }
     }
+    if(fd != STDIN_FILENO){
+        close(fd);
+    }
+}
 
-    //printf("Thread %d serviced %s\n", tid, input_file);
+/* Queue the names of a unit read with stdio, copied into arena */
+static void read_file_unit(input_unit *unit, name_arena *arena, char **batch, int *pending){
+    char hostname[SBUFFSIZE]; //hostname
 
     /* open file with file pointer*/
-    FILE *inputfp = fopen(input_file, "r");
+    FILE *inputfp = fopen(unit -> path, "r");
     if(!inputfp){
         perror("Error to open file!");
-        return NULL;   
+        return;
+    }
+    if(unit -> start > 0 && fseeko(inputfp, unit -> start, SEEK_SET)){
+        perror("Error to seek in file!");
+        fclose(inputfp);
+        return;
     }
 
     //fscanf(FILE *stream, const char *format, ...) reads formatted input from a stream
-    while(fscanf(inputfp, INPUTFS, hostname) > 0){
-        pthread_mutex_lock(&shared_array_input_lock);
-
+    //A chunk owns the names that start before its end: skip the whitespace first to see where the next one starts.
+    while((unit -> end < 0 || (fscanf(inputfp, " ") != EOF && ftello(inputfp) < unit -> end)) &&
+          fscanf(inputfp, INPUTFS, hostname) > 0){
         //This will be assigned each domain name individually and then be pushed onto the queue.
-        // Allocate space for the max domain name size
-        char *push_in = (char *)malloc(sizeof(char) * SBUFFSIZE); 
-
-        //char *strncpy(char *dest, const char *src, size_t n) copies up to n characters from the string pointed to, by src to dest. In a case where the length of src is less than that of n, the remainder of dest will be padded with null bytes.
-        strncpy(push_in, hostname, SBUFFSIZE);
-        while(safe_q_is_full(&shared_array)){
-            fprintf(stderr, "queue_is_full reports that the queue is full\n");
-            /* while the queue is full, we put the thread to sleep for a random period of time between 0 and 100 microseconds. 
-            Unlock before they sleep so that another thread whether its resolver or requester can take the lock. 
-            Optimally it would be a resolver so that they could empty out the queue a bit and the requester thread could break out of this while loop.*/ 
-            pthread_mutex_unlock(&shared_array_input_lock);
-            usleep(rand() % 101);
-            pthread_mutex_lock(&shared_array_input_lock); // lock shared array or try
-        }
-        safe_q_push(&shared_array, push_in);
-        pthread_mutex_unlock(&shared_array_input_lock);
-    }
-    fclose(inputfp);    
-    return NULL;
+        // Only the bytes of the name are stored, resolvers give them back with name_release
+        char *push_in = name_arena_copy(arena, hostname, strlen(hostname));
+        if(!push_in){
+            perror("Error to allocate hostname");
+            break;
+        }
+        /* sleeps while the queue is full and is woken as soon as a resolver pops */
+        add_to_batch(push_in, batch, pending);
+    }
+    fclose(inputfp);
 }
 
-void *resolve_DNS(void *output_file){
-   
-    /* test for extra credit */
+/*Function that returns a void* and that takes a void* argument*/
+/* Requesters claim input units (whole files or line-aligned chunks of big
+ * ones) until there are none left, see input_units.h */
+void *addReqToArray(void *units){
+    input_unit *unit;
+    pid_t tid = gettid();
 
-    //create IP array with size 100 for dnslookup fxn 
-    //char IPstr[100];
-    char IPstr[INET6_ADDRSTRLEN];
-    char IPPstr[INET_ADDRSTRLEN];
-    /* Lock up so other resolver threads can't fuck it up while we pulling data out of shared array.
-    We want to ensure they stay alive until all resolver thread are complete, otherwise, requester threads will get stuck with a full shared array */
-    FILE *outputfp = fopen("result.txt", "a");
-    if(!outputfp){
-        perror("Error to open output file");
+    /* names are queued batch_size at a time, one critical section per batch */
+    char **batch = malloc(sizeof(char*) * batch_size);
+    int pending = 0;
+    if(!batch){
+        perror("Error to allocate batch");
         return NULL;
     }
+    /* queued names are packed into this thread's arena */
+    name_arena arena;
+    name_arena_init(&arena);
+    metrics_thread("requester");
+    /* before the arena's first chunk, which then lands on our node */
+    affinity_pin(AFFINITY_REQUESTER);
 
-    while(!finishedEnding || !safe_q_is_empty(&shared_array)){
-        //Pull domains out of queue, look up and shit them in the result.txt file
-        char *output_in = safe_q_pop(&shared_array);
-        //pthread_mutex_unlock(&shared_array_output_lock);
-        if(output_in == NULL){
-            pthread_mutex_unlock(&shared_array_input_lock);
-            usleep(rand() % 101);
-            pthread_mutex_lock(&shared_array_input_lock);
-            //continue;
+    while((unit = input_units_claim(units)) != NULL){
+        long long began = metrics_clock_ns();
+        long long queued = metrics_queue_total();
+        if(dedup){
+            /* main listed the real input files already */
+        }
+        else if(unit -> whole){
+            fprintf(serviced_fp, "Thread %d serviced %s\n", tid, unit -> path);
         }
         else{
-            /* Look up hostname and get IP*/
-            //if(dnslookup(output_in, IPstr, sizeof(IPstr)) == UTIL_SUCCESS)
-            //    strncpy(IPstr, "", sizeof(IPstr));   
-            dnslookup(output_in, IPstr, sizeof(IPstr));
-            dnslookup(output_in, IPPstr, sizeof(IPPstr));
-             
-            pthread_mutex_lock(&shared_array_output_lock);
-
-            /* write the domain name, IP addr to the result.txt */
-            //fprintf(outputfp, "%s, %s\n", output_in, IPstr);
-            fprintf(outputfp, "%s, %s, %s\n", output_in, IPstr, IPPstr);
+            fprintf(serviced_fp, "Thread %d serviced %s bytes %lld-%lld\n", tid, unit -> path,
+                    (long long)unit -> start, (long long)unit -> end);
+        }
+        unit_index = unit - ((input_units *)units) -> units;
+        unit_names = 0;
+        /* with -m the queue gets pointers straight into the mapped file */
+        if(unit -> stream){
+            read_stream_unit(unit, &arena, batch, &pending);
+        }
+        else if(unit -> mapped){
+            read_mapped_unit(unit, &arena, batch, &pending);
+        }
+        else{
+            read_file_unit(unit, &arena, batch, &pending);
+        }
+        /* even a unit that could not be read, later units' places depend on it */
+        if(ordered_output){
+            reorder_unit_done(unit_index, unit_names);
+        }
+        /* parsing is whatever was not spent handing names to the queue */
+        metrics_work(metrics_clock_ns() - began - (metrics_queue_total() - queued));
+    }
+    flush_batch(batch, &pending);
+    name_arena_finish(&arena);
+    free(batch);
+    return NULL;
+}
 
-            /* print to terminal to test  */
-            printf("Resolveing %s to be %s, %s\n", output_in, IPstr, IPPstr);
+/* Queued names may point into a mapped input file and end at whitespace,
+ * not NUL: copy one into hostname (SBUFFSIZE bytes) as a C string */
+static void copy_name(char *hostname, const char *name){
+    size_t len = name_token_length(name);
+    if(len >= SBUFFSIZE){
+        len = SBUFFSIZE - 1;
+    }
+    memcpy(hostname, name, len);
+    hostname[len] = '\0';
+}
 
-            pthread_mutex_unlock(&shared_array_output_lock);
-        }
-        free(output_in);
+/* Queue one line for the results file: "name, first address, first
+ * IPv4 address", or with -A every address. item is what the queue held */
+static void write_result(char *item, const char *hostname, int status, const dns_addr_list *list){
+    if(listen_path){
+        lookup_server_complete(item, status, list); // the client gets addresses, not a line
+        return;
     }
 
-    pthread_mutex_unlock(&shared_array_input_lock);
-    fclose(outputfp);
+    char line[RESULT_FORMAT_MAX_LINE > RESULT_FORMAT_MAX_RECORD ? RESULT_FORMAT_MAX_LINE : RESULT_FORMAT_MAX_RECORD];
+    int len;
 
-    return NULL;
+    /* the domain name, IP addr for the results file, no lock: it goes into this thread's buffer */
+    if(output_format == RESULT_FORMAT_BINARY){
+        len = (int)result_format_record((unsigned char *)line, hostname, status, list);
+    }
+    else{
+        len = result_format_line(line, hostname, status, list, all_addresses);
+    }
+    if(ordered_output){
+        reorder_complete(item, line, len); // waits its turn in the window instead
+    }
+    else{
+        result_writer_append(line, len);
+    }
 }
 
-int safe_q_count_full_slots(safe_q *q){
-    return mod(q -> end - q -> first , q -> capacity);
+/* -Z: 1 if the preloaded table has hostname, its addresses in list */
+static int preloaded_answer(const char *hostname, dns_addr_list *list){
+    if(!preload || host_table_lookup(preload, hostname, list) != UTIL_SUCCESS){
+        return 0;
+    }
+    atomic_fetch_add_explicit(&preload_hits, 1, memory_order_relaxed);
+    return 1;
 }
 
-int safe_q_is_full(safe_q *q){
-    return safe_q_count_full_slots(q) == (q->capacity - 1); 
+/* Answer from -Z, -c or -C without sending anything, DNS_CACHE_MISS if neither knows the name */
+static int cached_answer(const char *hostname, dns_addr_list *list){
+    int status = DNS_CACHE_MISS;
+
+    if(preloaded_answer(hostname, list)){
+        return UTIL_SUCCESS;
+    }
+    if(use_cache){
+        status = dns_cache_peek(hostname, list);
+    }
+    if(status == DNS_CACHE_MISS && cache_file){
+        int stored = dns_store_lookup(hostname, list);
+        if(stored != DNS_STORE_MISS){
+            status = stored;
+            if(use_cache){
+                dns_cache_insert(hostname, status, list);
+            }
+        }
+    }
+    return status;
 }
 
-int mod(int numerator, int denominator){
-    int n = numerator % denominator;
-    if(n < 0){
-        n += denominator;
+static void remember_answer(const char *hostname, int status, const dns_addr_list *list){
+    if(use_cache){
+        dns_cache_insert(hostname, status, list);
+    }
+    if(cache_file){
+        dns_store_insert(hostname, status, list);
     }
-    return n;
 }
 
-int safe_q_is_empty(safe_q *q){
-    return (q -> first == q -> end) && !safe_q_is_full(q);
-    //return safe_q_count_full_slots(q) == 0;
+/* dns_async or a -P worker process finished the queue item at arg */
+static void async_done(void *arg, int status, const dns_addr_list *list, long long elapsed_ns){
+    char hostname[SBUFFSIZE];
+    char *name = queued_name(arg);
+
+    latency_record(elapsed_ns);
+    metrics_names(1);
+    copy_name(hostname, name);
+    remember_answer(hostname, status, list);
+    write_result(arg, hostname, status, list);
+    release_name(name);
 }
 
-int safe_q_push(safe_q *q, char *domainName){
-    //pthread_mutex_lock(&q);
-    if(safe_q_is_full(q)){
-    //      pthread_mutex_unlock(&q);
-          return 0;
+/* -a: keep up to async_inflight queries on the wire instead of one
+ * getaddrinfo() at a time. While queries are outstanding the resolver
+ * must not sleep on the queue, so it only peeks at it between polls */
+static void resolve_async(int id){
+    char hostname[SBUFFSIZE];
+    dns_addr_list list;
+    dns_async *engine = dns_async_new(async_inflight, async_done);
+    char **claimed = malloc(sizeof(char*) * async_inflight);
+    bool closed = false;
+
+    if(!engine || !claimed){
+        fprintf(stderr, "Unable to start the async resolver engine\n");
+        free(claimed);
+        if(engine){
+            dns_async_free(engine);
+        }
+        return;
     }
-    q -> names[q -> end] = domainName;
-    q -> end = ((q -> end + 1) % q -> capacity);
-    //pthread_mutex_unlock(&q);
-    return 1;
+    while(!closed || dns_async_inflight(engine) > 0){
+        int room = dns_async_room(engine);
+        int num_claimed = 0;
+
+        if(!closed && room > 0){
+            if(dns_async_inflight(engine) == 0){
+                /* nothing to wait for but input: sleep on the queue */
+                num_claimed = idle_pop_batch(id, claimed, room);
+                closed = (num_claimed == 0);
+            }
+            else if((num_claimed = dispatch_try_pop_batch(id, claimed, room)) < 0){
+                closed = true;
+                num_claimed = 0;
+            }
+        }
+        for(int i = 0; i < num_claimed; i++){
+            char *name = queued_name(claimed[i]);
+            copy_name(hostname, name);
+            int status = cached_answer(hostname, &list);
+            if(status != DNS_CACHE_MISS){
+                latency_record(0);
+                metrics_names(1);
+                write_result(claimed[i], hostname, status, &list);
+                release_name(name);
+                continue;
+            }
+            dns_async_submit(engine, hostname, strlen(hostname), claimed[i]);
+        }
+        if(dns_async_inflight(engine) > 0){
+            long long since = metrics_clock_ns();
+            dns_async_poll(engine, num_claimed > 0 ? 0 : ASYNC_QUEUE_POLL_MS);
+            metrics_work(metrics_clock_ns() - since);
+        }
+        flush_if_idle();
+    }
+    free(claimed);
+    dns_async_free(engine);
 }
 
-void *safe_q_pop(safe_q *q){
-    if(safe_q_is_empty(q)){
-       return NULL; 
+/* -P: hand names to the worker processes and write their answers. Any
+ * resolver writes any answer, so all of them stay until none is left */
+static void resolve_procs(int id){
+    char hostname[SBUFFSIZE];
+    dns_addr_list list;
+    char **claimed = malloc(sizeof(char*) * batch_size);
+    bool closed = false;
+
+    if(!claimed){
+        perror("Error to allocate batch");
+        return;
+    }
+    while(!closed || proc_pool_inflight() > 0){
+        int num_claimed = 0;
+
+        if(!closed){
+            if(proc_pool_inflight() == 0){
+                /* nothing to wait for but input: sleep on the queue */
+                num_claimed = idle_pop_batch(id, claimed, batch_size);
+                closed = (num_claimed == 0);
+            }
+            else if((num_claimed = dispatch_try_pop_batch(id, claimed, batch_size)) < 0){
+                closed = true;
+                num_claimed = 0;
+            }
+        }
+        for(int i = 0; i < num_claimed; i++){
+            char *name = queued_name(claimed[i]);
+            copy_name(hostname, name);
+            int status = cached_answer(hostname, &list);
+            if(status != DNS_CACHE_MISS){
+                latency_record(0);
+                metrics_names(1);
+                write_result(claimed[i], hostname, status, &list);
+                release_name(name);
+                continue;
+            }
+            proc_pool_submit(hostname, claimed[i]);
+        }
+        if(proc_pool_inflight() > 0){
+            long long since = metrics_clock_ns();
+            proc_pool_reap(num_claimed > 0 ? 0 : ASYNC_QUEUE_POLL_MS);
+            metrics_work(metrics_clock_ns() - since);
+        }
+        flush_if_idle();
     }
-    char *reset = q -> names[q -> first];
-    q -> first = (q -> first + 1) % q -> capacity;
-    return reset;
+    free(claimed);
 }
 
-void safe_q_cleanup(safe_q *q){
-    while(!safe_q_is_empty(q)){
-        safe_q_pop(q);
+void *resolve_DNS(void *resolver_id){
+    int id = (int)(intptr_t)resolver_id;
+   
+    /* test for extra credit */
+
+    char hostname[SBUFFSIZE];
+    /* every address of the name from one lookup */
+    dns_addr_list list;
+    metrics_thread("resolver");
+    affinity_pin(AFFINITY_RESOLVER); // hedge helpers started from here inherit it
+    /* Resolvers stay alive until the queue is closed and drained, otherwise requester threads would get stuck with a full shared array */
+    if(use_async){
+        resolve_async(id);
+        result_writer_flush();
+        return NULL;
+    }
+    if(worker_procs){
+        resolve_procs(id);
+        result_writer_flush();
+        return NULL;
     }
-    free(q -> names);
+
+    char **claimed = malloc(sizeof(char*) * batch_size);
+    int num_claimed;
+    if(!claimed){
+        perror("Error to allocate batch");
+        return NULL;
+    }
+
+    //Pull domains out of queue, look up and put them in the result.txt file. idle_pop_batch sleeps while the queue is empty, with -S after flushing.
+    //With -p a resolver the pool no longer needs returns between batches.
+    while(adapt_pool_keep_going() && (num_claimed = idle_pop_batch(id, claimed, batch_size)) > 0){
+        for(int i = 0; i < num_claimed; i++){
+            int status;
+            struct timespec begin, done;
+            /* with -o the slot is reused as soon as the result is written, hold on to the name */
+            char *name = queued_name(claimed[i]);
+            copy_name(hostname, name);
+            clock_gettime(CLOCK_MONOTONIC, &begin);
+            /* Look up hostname and get its IPs, both columns come from this one answer */
+            if(preloaded_answer(hostname, &list)){
+                status = UTIL_SUCCESS;
+            }
+            else if(use_cache){
+                status = dns_cache_lookup(hostname, &list);
+            }
+            else{
+                status = lookup_name(hostname, &list);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &done);
+            long long took = (done.tv_sec - begin.tv_sec) * 1000000000LL + (done.tv_nsec - begin.tv_nsec);
+            adapt_pool_record(took);
+            latency_record(took);
+            metrics_work(took);
+            write_result(claimed[i], hostname, status, &list);
+            release_name(name);
+        }
+        metrics_names(num_claimed);
+    }
+    free(claimed);
+    /* whatever is left in this thread's buffer */
+    result_writer_flush();
+
+    return NULL;
 }
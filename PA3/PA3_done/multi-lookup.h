@@ -1,18 +1,70 @@
 #include <pthread.h>
+#include "safe_q.h"
+#include "steal_pool.h"
+#include "name_arena.h"
+#include "name_map.h"
+#include "dns_cache.h"
+#include "dns_store.h"
+#include "dns_async.h"
+#include "result_writer.h"
+#include "adapt_pool.h"
+#include "input_units.h"
+#include "latency.h"
+#include "metrics.h"
+#include "dns_backend.h"
+#include "reorder.h"
+#include "lookup_server.h"
+#include "hedge.h"
+#include "affinity.h"
+#include "result_format.h"
+#include "proc_pool.h"
+#include "host_table.h"
+#include "dedup.h"
 
-#define USAGE "<inputFilePath> <outputFilePath>"
+#define USAGE "[options] <# requester threads> <# resolver threads> <results file> <serviced file> <input files...>"
+#define SERVER_USAGE "<# connection handlers> <# resolver threads>"
+#define OPTIONS \
+    "  -q, --queue=mutex|lockfree   shared queue backend (default " SAFE_Q_DEFAULT_NAME ")\n" \
+    "  -w, --steal                  one deque per resolver, idle resolvers steal\n" \
+    "  -b, --batch=N                queue/claim up to N names per queue operation (default 1)\n" \
+    "  -m, --mmap                   map input files and queue names without copying them\n" \
+    "  -c, --cache                  share lookups of repeated names between resolvers\n" \
+    "  -C, --cache-file=PATH        keep answers in a mapped file shared by runs and processes\n" \
+    "  -T, --cache-ttl=SECONDS      how long cached answers stay valid, with -c or -C (default 3600)\n" \
+    "  -B, --backend=SPEC           system, hosts[:PATH] or fake[:MS[:FAIL%[:fixed|exp|jitter]]] (default system)\n" \
+    "  -a, --async                  resolvers send their own UDP queries, many at a time\n" \
+    "  -n, --inflight=N             with -a, queries outstanding per resolver (default 256)\n" \
+    "  -s, --dns-server=ADDR[:PORT] with -a, name server to ask (default from /etc/resolv.conf)\n" \
+    "  -A, --all-addresses          write every IPv4 and IPv6 address of a name\n" \
+    "  -e, --echo                   also print every result line to the terminal\n" \
+    "  -p, --pool=MIN:MAX           resize the resolver pool between MIN and MAX threads as it runs\n" \
+    "  -M, --metrics=PATH           append pipeline metrics to PATH as JSON lines\n" \
+    "  -I, --metrics-interval=MS    with -M, how often to write them (default 1000)\n" \
+    "  -o, --ordered[=WINDOW]       write results in input order, at most WINDOW waiting (default 4096)\n" \
+    "  -S, --stream                 write results as soon as resolvers catch up; no input files = stdin\n" \
+    "  -L, --listen=SOCKET          serve lookups on a Unix socket instead: " SERVER_USAGE "\n" \
+    "  -H, --hedge[=PCT[:BUDGET]]   repeat lookups slower than pPCT, at most BUDGET% of them (default 95:5)\n" \
+    "  -P, --processes=N            make lookups in N forked worker processes fed through shared memory\n" \
+    "  -Z, --preload=PATH           answer names in a hosts/zone file or hosts_image image without lookups\n" \
+    "  -F, --format=text|binary     results file layout; result_convert turns binary into text\n" \
+    "  -D, --dedup[=MB]             resolve each distinct name once in MB of memory (default 256), spilling to disk\n" \
+    "      --pin-requesters=CPUS    run requesters on CPUS, a list like 0-3,8 or nodeN\n" \
+    "      --pin-resolvers=CPUS     run resolvers on CPUS; the queue is placed on their node\n" \
+    "      --pin-writer=CPUS        run the result writer thread on CPUS\n"
 //%1024s maximizes the length of the string to be scanned in 1024 characters, so it will always fit in an 1025 byte long buffer (1024 + 1 for the 0-terminator).
 #define INPUTFS "%1024s"
 
-#define MAX_INPUT_FILES 10
 #define MAX_RESOLVER_THREADS 10
 #define MAX_REQUESTER_THREADS 5
 #define MAX_NAME_LENGTHS 1025
 #define MAX_IP_LENGTH INET6_ADDRSTRLEN
 
-#define MIN_ARGUMENT (MAX_INPUT_FILES - 4) // 6
-#define MAX_ARGUMENT MAX_INPUT_FILES // 10
+#define MIN_ARGUMENT 6 // program, 2 thread counts, 2 output files, one input file; any number of input files may follow
 #define SBUFFSIZE 1025
+#define QUEUE_SIZE 50 // names per queue, per resolver deque with -w
+#define MAX_BATCH_SIZE 4096
+#define STREAM_READ_SIZE (64 * 1024) // bytes asked of a pipe or stdin per read()
+#define ASYNC_QUEUE_POLL_MS 2 // how often a busy -a resolver looks for more names
 
 
 /* Test for extra credit */
@@ -30,36 +82,8 @@ pid_t gettid(void) {
 }
 #endif
 
-typedef struct safe_q {
-    char ** names; //equal to *names[], strings character arrays so char**
-    int capacity;
-    int first;
-    int end;
-    pthread_mutex_t *bufferMutex;
-    pthread_mutex_t *outMutex;
-} safe_q;
-
-
-// initialize queue and pointers
-safe_q create_safe_q(int capacity){
-    safe_q q;
-    q.names = malloc(sizeof(char*) * capacity);
-    q.capacity = capacity;
-    q.first = 0;
-    q.end = 0;
-    return q;
-}
-
-void *addReqToArray(void *input_file);
-void *resolve_DNS(void *output_file);
-int safe_q_is_full(safe_q *q);
-int safe_q_count_full_slots(safe_q *q);
-int safe_q_is_empty(safe_q *q);
-int mod(int numerator, int denominator);
-int safe_q_push(safe_q *q, char *name);
-void *safe_q_pop(safe_q *q);
-void safe_q_cleanup(safe_q *q);
-//int queue_init(safe_q* q, int size);
+void *addReqToArray(void *units);
+void *resolve_DNS(void *resolver_id);
 
 /*
 //Threads
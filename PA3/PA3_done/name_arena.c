@@ -0,0 +1,129 @@
+/*
+ * File: name_arena.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Packed storage for queued hostnames. See name_arena.h.
+ *
+ *      Reference counting is biased so the requester never touches the
+ *      shared counter per name: refs starts at 0 and every release
+ *      subtracts one. When the requester moves on to a new chunk it adds
+ *      the number of names it handed out. Whoever brings refs to exactly
+ *      0 - the requester, or the last resolver after that - recycles it.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include "name_arena.h"
+#include "name_map.h"
+
+struct name_chunk {
+    atomic_int refs;
+    struct name_chunk *next; // free list link
+    char data[];
+};
+
+#define NAME_CHUNK_DATA (NAME_CHUNK_SIZE - offsetof(struct name_chunk, data))
+
+static pthread_mutex_t free_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct name_chunk *free_chunks = NULL;
+static int num_free_chunks = 0;
+
+static struct name_chunk *chunk_get(void){
+    struct name_chunk *c;
+
+    pthread_mutex_lock(&free_lock);
+    c = free_chunks;
+    if(c){
+        free_chunks = c -> next;
+        num_free_chunks--;
+    }
+    pthread_mutex_unlock(&free_lock);
+    if(!c){
+        c = aligned_alloc(NAME_CHUNK_SIZE, NAME_CHUNK_SIZE);
+        if(!c){
+            return NULL;
+        }
+    }
+    atomic_init(&c -> refs, 0);
+    c -> next = NULL;
+    return c;
+}
+
+static void chunk_recycle(struct name_chunk *c){
+    pthread_mutex_lock(&free_lock);
+    if(num_free_chunks < NAME_CHUNK_CACHE){
+        c -> next = free_chunks;
+        free_chunks = c;
+        num_free_chunks++;
+        c = NULL;
+    }
+    pthread_mutex_unlock(&free_lock);
+    free(c);
+}
+
+/* Hand the arena's current chunk over to its outstanding names */
+static void chunk_retire(name_arena *a){
+    if(!a -> chunk){
+        return;
+    }
+    if(atomic_fetch_add(&a -> chunk -> refs, a -> handed_out) + a -> handed_out == 0){
+        chunk_recycle(a -> chunk);
+    }
+    a -> chunk = NULL;
+    a -> used = 0;
+    a -> handed_out = 0;
+}
+
+void name_arena_init(name_arena *a){
+    a -> chunk = NULL;
+    a -> used = 0;
+    a -> handed_out = 0;
+}
+
+char *name_arena_copy(name_arena *a, const char *name, size_t len){
+    char *copy;
+
+    if(len + 1 > NAME_CHUNK_DATA){
+        return NULL;
+    }
+    if(!a -> chunk || a -> used + len + 1 > NAME_CHUNK_DATA){
+        chunk_retire(a);
+        if(!(a -> chunk = chunk_get())){
+            return NULL;
+        }
+    }
+    copy = a -> chunk -> data + a -> used;
+    memcpy(copy, name, len);
+    copy[len] = '\0';
+    a -> used += len + 1;
+    a -> handed_out++;
+    return copy;
+}
+
+void name_arena_finish(name_arena *a){
+    chunk_retire(a);
+}
+
+void name_release(char *name){
+    if(name_map_release(name)){
+        return;
+    }
+    struct name_chunk *c = (struct name_chunk *)((uintptr_t)name & ~(uintptr_t)(NAME_CHUNK_SIZE - 1));
+    if(atomic_fetch_sub(&c -> refs, 1) - 1 == 0){
+        chunk_recycle(c);
+    }
+}
+
+void name_arena_pool_cleanup(void){
+    pthread_mutex_lock(&free_lock);
+    while(free_chunks){
+        struct name_chunk *c = free_chunks;
+        free_chunks = c -> next;
+        free(c);
+    }
+    num_free_chunks = 0;
+    pthread_mutex_unlock(&free_lock);
+}
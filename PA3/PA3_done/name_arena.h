@@ -0,0 +1,48 @@
+/*
+ * File: name_arena.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Packed storage for queued hostnames.
+ *
+ *      Each requester thread owns a name_arena and copies names into
+ *      64 KiB chunks at their real length instead of malloc'ing a
+ *      SBUFFSIZE buffer per name. Chunks are aligned to their size, so a
+ *      resolver can find the chunk of any name from its address and hand
+ *      the name back with name_release(). Once every name in a chunk has
+ *      been released, the whole chunk goes back on a shared free list and
+ *      is reused by the next requester that needs one.
+ */
+
+#ifndef NAME_ARENA_H
+#define NAME_ARENA_H
+
+#include <stddef.h>
+
+#define NAME_CHUNK_SIZE (64 * 1024)
+#define NAME_CHUNK_CACHE 64 // free chunks kept around for reuse
+
+struct name_chunk;
+
+typedef struct name_arena {
+    struct name_chunk *chunk; // chunk currently being filled
+    size_t used;              // bytes of it handed out so far
+    int handed_out;           // names handed out from it so far
+} name_arena;
+
+void name_arena_init(name_arena *a);
+
+/* Copy len bytes of name plus a terminating NUL into the arena.
+ * Returns NULL if no chunk could be allocated */
+char *name_arena_copy(name_arena *a, const char *name, size_t len);
+
+/* The requester is done: its current chunk is freed once the names
+ * still out there are released */
+void name_arena_finish(name_arena *a);
+
+/* Give back a name returned by name_arena_copy or name_map_next */
+void name_release(char *name);
+
+/* Free the cached chunks at exit */
+void name_arena_pool_cleanup(void);
+
+#endif
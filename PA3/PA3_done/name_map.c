@@ -0,0 +1,171 @@
+/*
+ * File: name_map.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Zero-copy reader for hostname files. See name_map.h.
+ *
+ *      Every mapping gets a slot in an append-only table so name_release()
+ *      can tell which file a name points into. Slots are never reused:
+ *      once published only their live flag changes. A range the kernel
+ *      hands out again after munmap() can then never be mistaken for the
+ *      old file.
+ *
+ *      Names are not counted one by one while they are handed out. refs
+ *      starts at a large bias and every release subtracts one. Readers add
+ *      the number of names they handed out when they finish, and the last
+ *      reader takes the bias away again, so refs only reaches zero once the
+ *      file is done and every name from it has been released.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "name_map.h"
+
+static name_map maps[MAX_MAPPED_FILES];
+static atomic_int num_maps = 0;
+static pthread_mutex_t maps_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* whitespace as fscanf's %s sees it, plus NUL */
+static unsigned char is_delim[256] = {
+    [0] = 1, [' '] = 1, ['\t'] = 1, ['\n'] = 1, ['\v'] = 1, ['\f'] = 1, ['\r'] = 1
+};
+
+#define MAP_REFS_BIAS (1LL << 62)
+
+static void map_drop(name_map *m, long long count){
+    if(atomic_fetch_add(&m -> refs, count) + count == 0){
+        atomic_store_explicit(&m -> live, 0, memory_order_release);
+        munmap(m -> base, m -> map_len);
+    }
+}
+
+int name_map_open_shared(name_map_reader *r, const char *path, int readers){
+    struct stat st;
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    name_map *m;
+    char *base;
+    int fd;
+
+    memset(r, 0, sizeof(*r));
+    if((fd = open(path, O_RDONLY)) < 0){
+        return -1;
+    }
+    if(fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size == 0){
+        close(fd);
+        return -1;
+    }
+
+    /* Reserve the file plus at least one zero byte, then lay the file over
+     * the front. The tail of the last file page and the extra anonymous
+     * page read as zero, which terminates the last token. */
+    size_t size = (size_t)st.st_size;
+    size_t map_len = (size + page) & ~(page - 1);
+    base = mmap(NULL, map_len, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(base == MAP_FAILED){
+        close(fd);
+        return -1;
+    }
+    if(mmap(base, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0) == MAP_FAILED){
+        munmap(base, map_len);
+        close(fd);
+        return -1;
+    }
+    close(fd);
+    madvise(base, size, MADV_SEQUENTIAL);
+
+    pthread_mutex_lock(&maps_lock);
+    int slot = atomic_load(&num_maps);
+    if(slot == MAX_MAPPED_FILES){
+        pthread_mutex_unlock(&maps_lock);
+        munmap(base, map_len);
+        return -1;
+    }
+    m = &maps[slot];
+    m -> base = base;
+    m -> size = size;
+    m -> map_len = map_len;
+    atomic_init(&m -> refs, MAP_REFS_BIAS);
+    atomic_init(&m -> readers, readers);
+    atomic_init(&m -> live, 1);
+    atomic_store_explicit(&num_maps, slot + 1, memory_order_release);
+    pthread_mutex_unlock(&maps_lock);
+
+    r -> map = m;
+    r -> pos = base;
+    r -> end = base + size;
+    return 0;
+}
+
+int name_map_open(name_map_reader *r, const char *path){
+    return name_map_open_shared(r, path, 1);
+}
+
+void name_map_part(name_map_reader *part, const name_map_reader *whole, size_t start, size_t end){
+    memset(part, 0, sizeof(*part));
+    part -> map = whole -> map;
+    part -> pos = whole -> map -> base + start;
+    part -> end = whole -> map -> base + end;
+}
+
+char *name_map_next(name_map_reader *r, size_t *len){
+    const unsigned char *p = (const unsigned char *)r -> pos;
+    const unsigned char *end = (const unsigned char *)r -> end;
+
+    const unsigned char *start;
+
+    while(p < end && is_delim[*p]){
+        p++;
+    }
+    r -> pos = (const char *)p;
+    if(p == end){
+        return NULL;
+    }
+    start = p;
+    while(p < end && !is_delim[*p]){
+        p++;
+    }
+    r -> pos = (const char *)p;
+    *len = p - start;
+    if(*len <= NAME_MAP_MAX_TOKEN){
+        r -> handed_out++; // only these hold the mapping
+    }
+    return (char *)start;
+}
+
+void name_map_finish(name_map_reader *r){
+    if(r -> map){
+        map_drop(r -> map, r -> handed_out);
+        if(atomic_fetch_sub(&r -> map -> readers, 1) == 1){
+            map_drop(r -> map, -MAP_REFS_BIAS);
+        }
+        r -> map = NULL;
+    }
+}
+
+int name_map_release(const char *name){
+    int n = atomic_load_explicit(&num_maps, memory_order_acquire);
+
+    for(int i = n - 1; i >= 0; i--){
+        name_map *m = &maps[i];
+        if(name >= m -> base && name < m -> base + m -> size &&
+           atomic_load_explicit(&m -> live, memory_order_acquire)){
+            map_drop(m, -1);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+size_t name_token_length(const char *name){
+    const unsigned char *p = (const unsigned char *)name;
+    while(!is_delim[*p]){
+        p++;
+    }
+    return (size_t)(p - (const unsigned char *)name);
+}
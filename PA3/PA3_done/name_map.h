@@ -0,0 +1,80 @@
+/*
+ * File: name_map.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Zero-copy reader for hostname files.
+ *
+ *      name_map_open() maps a whole names file read-only and
+ *      name_map_next() hands out pointers straight into the mapping, one
+ *      per whitespace separated token, without copying or terminating
+ *      them. Queued names are therefore only terminated by whitespace or
+ *      NUL: use name_token_length() instead of strlen() on them. The
+ *      mapping is followed by at least one zero byte, so the last token
+ *      of a file is terminated too.
+ *
+ *      A mapping stays alive until every name handed out from it has
+ *      been given back with name_release() (see name_arena.h), and is
+ *      unmapped by whichever thread gives back the last one.
+ *
+ *      One mapping can be read by several threads at once, each through
+ *      its own reader covering a line-aligned part of the file (see
+ *      input_units.h).
+ */
+
+#ifndef NAME_MAP_H
+#define NAME_MAP_H
+
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define MAX_MAPPED_FILES 256
+#define NAME_MAP_MAX_TOKEN 1024 // same limit as INPUTFS in multi-lookup.h
+
+typedef struct name_map {
+    char *base;     // first byte of the file
+    size_t size;    // bytes of file
+    size_t map_len; // bytes mapped, file plus zero padding
+    atomic_llong refs;   // biased while readers are active, see name_map.c
+    atomic_int readers;
+    atomic_int live; // cleared before munmap, the range may be reused after
+} name_map;
+
+typedef struct name_map_reader {
+    name_map *map;
+    const char *pos;
+    const char *end;
+    long long handed_out;
+} name_map_reader;
+
+/* Map path for reading. Returns 0 on success, -1 if the file cannot be
+ * mapped (empty, not a regular file, too many mappings) and the caller
+ * should fall back to reading it with stdio */
+int name_map_open(name_map_reader *r, const char *path);
+
+/* name_map_open for a file that is read in parts by several readers.
+ * r covers the whole file and only serves as the template for
+ * name_map_part(). Each of the readers parts must be finished with
+ * name_map_finish(); r itself must not be */
+int name_map_open_shared(name_map_reader *r, const char *path, int readers);
+
+/* Reader for bytes [start, end) of the file behind whole. start and end
+ * must be 0, the file size or just after a newline */
+void name_map_part(name_map_reader *part, const name_map_reader *whole, size_t start, size_t end);
+
+/* Next token of the file and its length in *len, or NULL at the end.
+ * A token of at most NAME_MAP_MAX_TOKEN bytes is handed out as a name.
+ * A longer one is not: the caller copies it out in pieces of
+ * NAME_MAP_MAX_TOKEN, as INPUTFS splits it, before name_map_finish() */
+char *name_map_next(name_map_reader *r, size_t *len);
+
+/* Done reading: the mapping goes away once its names are released */
+void name_map_finish(name_map_reader *r);
+
+/* Give back a name if it points into a mapping.
+ * Returns 1 if it did, 0 if the name came from somewhere else */
+int name_map_release(const char *name);
+
+/* Length of a queued name, up to the first whitespace or NUL */
+size_t name_token_length(const char *name);
+
+#endif
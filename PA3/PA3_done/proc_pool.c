@@ -0,0 +1,344 @@
+/*
+ * File: proc_pool.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Resolver worker processes. See proc_pool.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include "proc_pool.h"
+
+enum { SLOT_FREE, SLOT_QUEUED, SLOT_RUNNING, SLOT_DONE };
+
+struct proc_slot {
+    int state;
+    pid_t worker; // while SLOT_RUNNING
+    void *arg; // the parent's, workers never use it
+    long long submitted_ns, elapsed_ns;
+    int status;
+    dns_addr_list list;
+    char name[PROC_POOL_MAX_NAME + 1];
+};
+
+/* everything below is in the shared mapping and changed under lock */
+struct proc_shared {
+    pthread_mutex_t lock; // process-shared, robust
+    pthread_cond_t have_request; // workers wait on it
+    pthread_cond_t have_answer; // the parent's resolvers wait on it
+    int closing;
+    int req_head, req_count; // ring of queued slots
+    int ans_head, ans_count; // ring of answered slots
+    int free_count; // stack of free slots
+    long lost; // names failed because their worker died
+    long lookups[PROC_POOL_MAX_WORKERS];
+};
+
+static struct proc_shared *shared = NULL;
+static size_t shared_size;
+static int num_slots;
+static int *requests, *answers, *free_slots; // num_slots each, in the mapping
+static struct proc_slot *slot_table;
+
+/* parent only */
+static pid_t pids[PROC_POOL_MAX_WORKERS]; // 0 once reaped
+static int num_workers, alive;
+static proc_pool_done done_fn;
+static atomic_int inflight;
+static long final_lookups[PROC_POOL_MAX_WORKERS], final_lost; // kept past proc_pool_stop()
+
+static int (*lookup_fn)(const char *hostname, dns_addr_list *list);
+
+static long long now_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* A worker killed while holding the lock leaves it to the next owner.
+ * Nothing is half changed then: every update under it is a few stores */
+static void shared_lock(void){
+    if(pthread_mutex_lock(&shared -> lock) == EOWNERDEAD){
+        pthread_mutex_consistent(&shared -> lock);
+    }
+}
+
+static void shared_unlock(void){
+    pthread_mutex_unlock(&shared -> lock);
+}
+
+static int shared_wait(pthread_cond_t *cond, const struct timespec *deadline){
+    int rc = deadline ? pthread_cond_timedwait(cond, &shared -> lock, deadline)
+                      : pthread_cond_wait(cond, &shared -> lock);
+    if(rc == EOWNERDEAD){
+        pthread_mutex_consistent(&shared -> lock);
+        rc = 0;
+    }
+    return rc;
+}
+
+/* Move slot i to the answered ring with status. Under lock */
+static void answer(int i, int status){
+    struct proc_slot *s = &slot_table[i];
+
+    s -> status = status;
+    if(status != UTIL_SUCCESS){
+        s -> list.count = 0;
+    }
+    s -> elapsed_ns = now_ns() - s -> submitted_ns;
+    s -> state = SLOT_DONE;
+    answers[(shared -> ans_head + shared -> ans_count++) % num_slots] = i;
+    pthread_cond_signal(&shared -> have_answer);
+}
+
+static void worker_main(int index, pid_t parent){
+    pid_t self = getpid();
+
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if(getppid() != parent){
+        _exit(0); // the parent is already gone
+    }
+    signal(SIGINT, SIG_IGN); // Ctrl-C is for the parent, which shuts us down
+    signal(SIGTERM, SIG_IGN);
+    for(;;){
+        struct proc_slot *s;
+        dns_addr_list list;
+        int i, status;
+
+        shared_lock();
+        while(shared -> req_count == 0 && !shared -> closing){
+            shared_wait(&shared -> have_request, NULL);
+        }
+        if(shared -> req_count == 0){
+            shared_unlock();
+            break; // closing and nothing left
+        }
+        i = requests[shared -> req_head];
+        shared -> req_head = (shared -> req_head + 1) % num_slots;
+        shared -> req_count--;
+        s = &slot_table[i];
+        s -> state = SLOT_RUNNING;
+        s -> worker = self;
+        shared_unlock();
+
+        /* the name stays put while the slot is ours */
+        status = lookup_fn(s -> name, &list);
+
+        shared_lock();
+        if(status == UTIL_SUCCESS){
+            memcpy(&s -> list, &list, DNS_ADDR_LIST_SIZE(list.count));
+        }
+        answer(i, status);
+        shared -> lookups[index]++;
+        shared_unlock();
+    }
+    _exit(0); // exit() would flush stdio buffers copied from the parent
+}
+
+/* Fail what dead workers were looking up, and with none left everything
+ * still queued. Under lock */
+static void check_workers(void){
+    for(int w = 0; w < num_workers; w++){
+        if(pids[w] == 0 || waitpid(pids[w], NULL, WNOHANG) != pids[w]){
+            continue;
+        }
+        for(int i = 0; i < num_slots; i++){
+            if(slot_table[i].state == SLOT_RUNNING && slot_table[i].worker == pids[w]){
+                answer(i, UTIL_FAILURE);
+                shared -> lost++;
+            }
+        }
+        pids[w] = 0;
+        alive--;
+    }
+    while(alive == 0 && shared -> req_count > 0){
+        int i = requests[shared -> req_head];
+        shared -> req_head = (shared -> req_head + 1) % num_slots;
+        shared -> req_count--;
+        answer(i, UTIL_FAILURE);
+        shared -> lost++;
+    }
+}
+
+static struct timespec deadline_in(int ms){
+    long long at = now_ns() + ms * 1000000LL;
+    struct timespec ts = { .tv_sec = at / 1000000000LL, .tv_nsec = at % 1000000000LL };
+    return ts;
+}
+
+int proc_pool_start(int workers, int slots, int (*lookup)(const char *hostname, dns_addr_list *list), proc_pool_done done){
+    pthread_mutexattr_t mattr;
+    pthread_condattr_t cattr;
+    size_t rings = 3 * sizeof(int) * slots;
+    pid_t parent = getpid();
+
+    if(workers < 1 || workers > PROC_POOL_MAX_WORKERS || slots < 1){
+        return -1;
+    }
+    rings = (rings + 63) & ~(size_t)63;
+    shared_size = sizeof(struct proc_shared) + rings + sizeof(struct proc_slot) * slots;
+    shared = mmap(NULL, shared_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if(shared == MAP_FAILED){
+        shared = NULL;
+        return -1;
+    }
+    /* the mapping is at the same address in every worker, so are these */
+    requests = (int *)(shared + 1);
+    answers = requests + slots;
+    free_slots = answers + slots;
+    slot_table = (struct proc_slot *)((char *)(shared + 1) + rings);
+    num_slots = slots;
+    for(int i = 0; i < slots; i++){
+        free_slots[i] = i;
+    }
+    shared -> free_count = slots;
+
+    pthread_mutexattr_init(&mattr);
+    pthread_mutexattr_setpshared(&mattr, PTHREAD_PROCESS_SHARED);
+    pthread_mutexattr_setrobust(&mattr, PTHREAD_MUTEX_ROBUST);
+    pthread_condattr_init(&cattr);
+    pthread_condattr_setpshared(&cattr, PTHREAD_PROCESS_SHARED);
+    pthread_condattr_setclock(&cattr, CLOCK_MONOTONIC);
+    if(pthread_mutex_init(&shared -> lock, &mattr) || pthread_cond_init(&shared -> have_request, &cattr) ||
+       pthread_cond_init(&shared -> have_answer, &cattr)){
+        munmap(shared, shared_size);
+        shared = NULL;
+        return -1;
+    }
+    pthread_mutexattr_destroy(&mattr);
+    pthread_condattr_destroy(&cattr);
+
+    lookup_fn = lookup;
+    done_fn = done;
+    atomic_init(&inflight, 0);
+    num_workers = alive = 0;
+    for(int w = 0; w < workers; w++){
+        pid_t pid = fork();
+        if(pid == 0){
+            worker_main(w, parent);
+        }
+        if(pid < 0){
+            proc_pool_stop();
+            return -1;
+        }
+        pids[w] = pid;
+        num_workers++;
+        alive++;
+    }
+    return 0;
+}
+
+void proc_pool_submit(const char *hostname, void *arg){
+    struct proc_slot *s;
+    int i;
+
+    atomic_fetch_add(&inflight, 1);
+    shared_lock();
+    while(shared -> free_count == 0){
+        if(shared -> ans_count > 0){
+            /* every slot is out but some are answered: hand those on */
+            shared_unlock();
+            proc_pool_reap(0);
+            shared_lock();
+            continue;
+        }
+        struct timespec deadline = deadline_in(PROC_POOL_CHECK_MS);
+        if(shared_wait(&shared -> have_answer, &deadline) == ETIMEDOUT){
+            check_workers();
+        }
+    }
+    i = free_slots[--shared -> free_count];
+    s = &slot_table[i];
+    s -> arg = arg;
+    s -> submitted_ns = now_ns();
+    snprintf(s -> name, sizeof(s -> name), "%s", hostname);
+    if(alive == 0){
+        answer(i, UTIL_FAILURE); // no worker left to ask
+        shared -> lost++;
+    }
+    else{
+        s -> state = SLOT_QUEUED;
+        requests[(shared -> req_head + shared -> req_count++) % num_slots] = i;
+        pthread_cond_signal(&shared -> have_request);
+    }
+    shared_unlock();
+}
+
+int proc_pool_reap(int timeout_ms){
+    int reaped = 0;
+
+    shared_lock();
+    if(shared -> ans_count == 0 && timeout_ms > 0){
+        struct timespec deadline = deadline_in(timeout_ms < PROC_POOL_CHECK_MS ? timeout_ms : PROC_POOL_CHECK_MS);
+        if(shared_wait(&shared -> have_answer, &deadline) == ETIMEDOUT){
+            check_workers();
+        }
+    }
+    while(shared -> ans_count > 0){
+        int i = answers[shared -> ans_head];
+        struct proc_slot *s = &slot_table[i];
+        dns_addr_list list;
+        int status = s -> status;
+        long long elapsed = s -> elapsed_ns;
+        void *arg = s -> arg;
+
+        shared -> ans_head = (shared -> ans_head + 1) % num_slots;
+        shared -> ans_count--;
+        memcpy(&list, &s -> list, DNS_ADDR_LIST_SIZE(s -> list.count));
+        s -> state = SLOT_FREE;
+        free_slots[shared -> free_count++] = i;
+        shared_unlock();
+
+        done_fn(arg, status, &list, elapsed);
+        atomic_fetch_sub(&inflight, 1);
+        reaped++;
+        shared_lock();
+    }
+    shared_unlock();
+    return reaped;
+}
+
+int proc_pool_inflight(void){
+    return atomic_load(&inflight);
+}
+
+void proc_pool_stop(void){
+    if(!shared){
+        return;
+    }
+    shared_lock();
+    shared -> closing = 1;
+    pthread_cond_broadcast(&shared -> have_request);
+    shared_unlock();
+    for(int w = 0; w < num_workers; w++){
+        if(pids[w] > 0){
+            waitpid(pids[w], NULL, 0);
+            pids[w] = 0;
+        }
+    }
+    alive = 0;
+    memcpy(final_lookups, shared -> lookups, sizeof(final_lookups));
+    final_lost = shared -> lost;
+    pthread_mutex_destroy(&shared -> lock);
+    pthread_cond_destroy(&shared -> have_request);
+    pthread_cond_destroy(&shared -> have_answer);
+    munmap(shared, shared_size);
+    shared = NULL;
+}
+
+void proc_pool_report(FILE *out){
+    fprintf(out, "Resolver processes: %d, lookups per process", num_workers);
+    for(int w = 0; w < num_workers; w++){
+        fprintf(out, "%s%ld", w ? "/" : " ", final_lookups[w]);
+    }
+    fprintf(out, ", %ld names failed by workers that died\n", final_lost);
+}
@@ -0,0 +1,60 @@
+/*
+ * File: proc_pool.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Resolver worker processes (-P/--processes=N).
+ *
+ *      Lookups in one process share glibc's resolver state and locks, so
+ *      past a point more resolver threads stop helping. With -P the
+ *      lookups are made by N forked worker processes instead. Requests and
+ *      answers go through one shared anonymous mapping set up before the
+ *      fork: a table of slots (name in, status and addresses out), a ring
+ *      of slots waiting for a worker and a ring of answered ones, under a
+ *      process-shared mutex. The resolver threads of the parent keep
+ *      taking names off the queue, put them into free slots and hand the
+ *      answers on, like -a resolvers do with their engine.
+ *
+ *      A worker that dies fails the name it was looking up; once none is
+ *      left every name fails. Workers ignore SIGINT and die with the
+ *      parent.
+ */
+
+#ifndef PROC_POOL_H
+#define PROC_POOL_H
+
+#include <stdio.h>
+#include "util.h"
+
+#define PROC_POOL_MAX_WORKERS 256
+#define PROC_POOL_SLOTS_PER_WORKER 64 // names in flight per worker
+#define PROC_POOL_MAX_NAME 1024
+#define PROC_POOL_CHECK_MS 100 // how often a waiting parent looks for dead workers
+
+/* Called in the parent once per submitted name, like dns_async_done */
+typedef void (*proc_pool_done)(void *arg, int status, const dns_addr_list *list, long long elapsed_ns);
+
+/* Fork workers processes that answer names with lookup (same contract
+ * as dnslookup_all()), slots names in flight at most. done is called
+ * from proc_pool_submit() and proc_pool_reap(). Returns 0 or -1 */
+int proc_pool_start(int workers, int slots, int (*lookup)(const char *hostname, dns_addr_list *list), proc_pool_done done);
+
+/* Hand hostname to the workers. With every slot in flight this answers
+ * names (calling done) until one is free */
+void proc_pool_submit(const char *hostname, void *arg);
+
+/* Call done for every answered name, waiting up to timeout_ms for the
+ * first. Returns how many there were */
+int proc_pool_reap(int timeout_ms);
+
+/* Submitted names whose done has not returned yet */
+int proc_pool_inflight(void);
+
+/* Let the workers finish, wait for them and unmap the rings. Nothing may
+ * be in flight */
+void proc_pool_stop(void);
+
+/* Lookups per worker and names lost to dead workers, for the summary.
+ * After proc_pool_stop() */
+void proc_pool_report(FILE *out);
+
+#endif
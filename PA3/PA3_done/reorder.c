@@ -0,0 +1,171 @@
+/*
+ * File: reorder.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Results written in input order through a bounded window.
+ *      See reorder.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <time.h>
+#include <pthread.h>
+#include "reorder.h"
+#include "result_writer.h"
+
+typedef struct reorder_slot {
+    char *name;
+    char *line; // inline_line or malloc()ed
+    size_t len;
+    int done; // under ring_lock
+    char inline_line[REORDER_INLINE_LINE];
+} reorder_slot;
+
+static reorder_slot *ring = NULL;
+static int ring_size = 0;
+static int num_units = 0;
+
+static atomic_llong written; // every seq below this is in the results file
+static atomic_llong *bases = NULL; // first seq of each unit, -1 until known
+static long long *totals = NULL; // names in each unit, -1 until read, under ring_lock
+
+static pthread_mutex_t ring_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ring_moved = PTHREAD_COND_INITIALIZER;
+static long long waits = 0, wait_ns = 0; // under ring_lock
+
+/* seq of name idx of unit if it may enter the window now, otherwise -1 */
+static long long admissible(int unit, long long idx){
+    long long base = atomic_load_explicit(&bases[unit], memory_order_acquire);
+
+    if(base < 0 || base + idx >= atomic_load_explicit(&written, memory_order_acquire) + ring_size){
+        return -1;
+    }
+    return base + idx;
+}
+
+int reorder_init(int window, int units){
+    ring = calloc(window, sizeof(*ring));
+    bases = malloc(sizeof(*bases) * units);
+    totals = malloc(sizeof(*totals) * units);
+    if(!ring || !bases || !totals){
+        reorder_cleanup();
+        return -1;
+    }
+    ring_size = window;
+    num_units = units;
+    for(int i = 0; i < units; i++){
+        atomic_init(&bases[i], i ? -1 : 0);
+        totals[i] = -1;
+    }
+    atomic_init(&written, 0);
+    return 0;
+}
+
+char *reorder_admit(int unit, long long idx, char *name, int wait){
+    long long seq = admissible(unit, idx);
+
+    if(seq < 0){
+        struct timespec begin, end;
+
+        if(!wait){
+            return NULL;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        pthread_mutex_lock(&ring_lock);
+        while((seq = admissible(unit, idx)) < 0){
+            pthread_cond_wait(&ring_moved, &ring_lock);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        waits++;
+        wait_ns += (end.tv_sec - begin.tv_sec) * 1000000000LL + (end.tv_nsec - begin.tv_nsec);
+        pthread_mutex_unlock(&ring_lock);
+    }
+    /* the result that used this slot WINDOW names ago has been written */
+    reorder_slot *slot = &ring[seq % ring_size];
+    slot -> name = name;
+    return (char *)slot;
+}
+
+void reorder_unit_done(int unit, long long names){
+    pthread_mutex_lock(&ring_lock);
+    totals[unit] = names;
+    /* a finished unit whose base is known gives the next one its base */
+    for(int u = unit; u + 1 < num_units && totals[u] >= 0; u++){
+        long long base = atomic_load_explicit(&bases[u], memory_order_relaxed);
+        if(base < 0 || atomic_load_explicit(&bases[u + 1], memory_order_relaxed) >= 0){
+            break;
+        }
+        atomic_store_explicit(&bases[u + 1], base + totals[u], memory_order_release);
+    }
+    pthread_cond_broadcast(&ring_moved);
+    pthread_mutex_unlock(&ring_lock);
+}
+
+char *reorder_name(char *item){
+    return ((reorder_slot *)item) -> name;
+}
+
+void reorder_complete(char *item, const char *line, size_t len){
+    reorder_slot *slot = (reorder_slot *)item;
+    int moved = 0;
+
+    /* copy outside the lock, only the hand over to the writer is serial */
+    slot -> line = (len <= sizeof(slot -> inline_line)) ? slot -> inline_line : malloc(len);
+    if(slot -> line){
+        memcpy(slot -> line, line, len);
+        slot -> len = len;
+    }
+    else{
+        slot -> len = 0; // out of memory: the line is lost, the order is not
+    }
+
+    pthread_mutex_lock(&ring_lock);
+    slot -> done = 1;
+    for(;;){
+        long long next = atomic_load_explicit(&written, memory_order_relaxed);
+        reorder_slot *head = &ring[next % ring_size];
+        if(!head -> done){
+            break;
+        }
+        result_writer_append_ordered(head -> line, head -> len);
+        if(head -> line != head -> inline_line){
+            free(head -> line);
+        }
+        head -> done = 0;
+        atomic_store_explicit(&written, next + 1, memory_order_release);
+        moved = 1;
+    }
+    if(moved){
+        pthread_cond_broadcast(&ring_moved);
+    }
+    pthread_mutex_unlock(&ring_lock);
+}
+
+void reorder_flush(void){
+    pthread_mutex_lock(&ring_lock);
+    result_writer_flush_ordered();
+    pthread_mutex_unlock(&ring_lock);
+}
+
+void reorder_report(FILE *out){
+    pthread_mutex_lock(&ring_lock);
+    fprintf(out, "Reorder window = %d names, requesters waited for it %lld times, %.3f ms in all\n",
+            ring_size, waits, wait_ns / 1e6);
+    pthread_mutex_unlock(&ring_lock);
+}
+
+void reorder_cleanup(void){
+    for(int i = 0; ring && i < ring_size; i++){
+        if(ring[i].done && ring[i].line != ring[i].inline_line){
+            free(ring[i].line);
+        }
+    }
+    free(ring);
+    free(bases);
+    free(totals);
+    ring = NULL;
+    bases = NULL;
+    totals = NULL;
+    ring_size = num_units = 0;
+}
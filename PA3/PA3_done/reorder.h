@@ -0,0 +1,63 @@
+/*
+ * File: reorder.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Results written in input order (-o/--ordered[=WINDOW]).
+ *
+ *      Every name gets a sequence number: its place among all names of
+ *      all input files, in command line order. Name idx of input unit
+ *      u is number base(u) + idx, and base(u) is known once every unit
+ *      before u has been read to the end, so requesters never agree on
+ *      anything but those unit totals.
+ *
+ *      Results wait in a ring of WINDOW slots, slot seq % WINDOW, and
+ *      leave for the results file as soon as every earlier one has. A
+ *      requester may only queue name seq once seq < written + WINDOW:
+ *      that is the backpressure that keeps at most WINDOW results
+ *      buffered however slow the slowest lookup is. A requester that
+ *      is ahead (or whose unit's base is not known yet) sleeps until
+ *      the window moves.
+ *
+ *      In this mode the resolver queue carries slot pointers instead of
+ *      names; reorder_name() gives the name back.
+ */
+
+#ifndef REORDER_H
+#define REORDER_H
+
+#include <stdio.h>
+
+#define REORDER_DEFAULT_WINDOW 4096
+#define REORDER_MAX_WINDOW (1 << 20)
+#define REORDER_INLINE_LINE 112 // results up to this long are kept without malloc()
+
+/* Set up a window of window results for input split into num_units
+ * units. Returns 0 on success, -1 on failure */
+int reorder_init(int window, int num_units);
+
+/* Place name, number idx of unit, in the window and return what to queue
+ * for the resolvers. If its turn has not come yet this sleeps until it
+ * does, or with wait 0 returns NULL right away: queue anything admitted
+ * and held back first, it may be what the window is waiting for */
+char *reorder_admit(int unit, long long idx, char *name, int wait);
+
+/* Unit has been read to the end and had names names */
+void reorder_unit_done(int unit, long long names);
+
+/* The name behind a queued item */
+char *reorder_name(char *item);
+
+/* The result line of a queued item. Writes it and every result after it
+ * that is already done, in order, through result_writer */
+void reorder_complete(char *item, const char *line, size_t len);
+
+/* Hand the results written so far to the writer now instead of once a
+ * whole buffer has filled */
+void reorder_flush(void);
+
+/* How often requesters waited for the window, for the summary */
+void reorder_report(FILE *out);
+
+void reorder_cleanup(void);
+
+#endif
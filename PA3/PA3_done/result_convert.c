@@ -0,0 +1,84 @@
+/*
+ * File: result_convert.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Reads a results file written with multi-lookup -F binary (layout in
+ *      result_format.h) and prints it in the text layout, one line per
+ *      name: "name, first address, first IPv4 address", or with -A every
+ *      address. With -c it only scans the file and prints how many names
+ *      it holds, how many failed and how many addresses they have.
+ *
+ *      ./result_convert [-A] [-c] [results file]
+ *
+ *      Without a file, or with "-", standard input is read, so the
+ *      output of multi-lookup -F binary ... - can be piped in.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "result_format.h"
+
+#define CONVERT_USAGE "[-A] [-c] [results file]"
+#define CONVERT_OUT_BUF (256 * 1024)
+
+int main(int argc, char *argv[]){
+    int all_addresses = 0, count_only = 0;
+    int opt, fd = STDIN_FILENO, status;
+    long long failed = 0, addresses = 0;
+    result_reader reader;
+    result_record rec;
+
+    while((opt = getopt(argc, argv, "Ac")) != -1){
+        switch(opt){
+        case 'A':
+            all_addresses = 1;
+            break;
+        case 'c':
+            count_only = 1;
+            break;
+        default:
+            fprintf(stderr, "USAGE: \n %s %s\n", argv[0], CONVERT_USAGE);
+            return EXIT_FAILURE;
+        }
+    }
+    if(argc - optind > 1){
+        fprintf(stderr, "USAGE: \n %s %s\n", argv[0], CONVERT_USAGE);
+        return EXIT_FAILURE;
+    }
+    if(optind < argc && strcmp(argv[optind], "-") && (fd = open(argv[optind], O_RDONLY | O_CLOEXEC)) < 0){
+        perror(argv[optind]);
+        return EXIT_FAILURE;
+    }
+    if(result_reader_open(&reader, fd)){
+        fprintf(stderr, "%s is not a binary results file\n", optind < argc ? argv[optind] : "Standard input");
+        return EXIT_FAILURE;
+    }
+    setvbuf(stdout, NULL, _IOFBF, CONVERT_OUT_BUF);
+
+    while((status = result_reader_next(&reader, &rec)) == 1){
+        if(count_only){
+            failed += (rec.status != UTIL_SUCCESS);
+            addresses += (rec.status == UTIL_SUCCESS) ? rec.list.count : 0;
+        }
+        else{
+            char line[RESULT_FORMAT_MAX_LINE];
+            int len = result_format_line(line, rec.name, rec.status, &rec.list, all_addresses);
+            fwrite(line, 1, len, stdout);
+        }
+    }
+    if(count_only){
+        printf("%lld names, %lld failed, %lld addresses\n", reader.records, failed, addresses);
+    }
+    result_reader_close(&reader);
+    if(fd != STDIN_FILENO){
+        close(fd);
+    }
+    if(status < 0){
+        fprintf(stderr, "Malformed or truncated record after %lld names\n", reader.records);
+        return EXIT_FAILURE;
+    }
+    return fflush(stdout) ? EXIT_FAILURE : EXIT_SUCCESS;
+}
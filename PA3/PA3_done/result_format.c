@@ -0,0 +1,132 @@
+/*
+ * File: result_format.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Results file layouts. See result_format.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include "result_format.h"
+
+int result_format_line(char *line, const char *name, int status, const dns_addr_list *list, int all){
+    char IPstr[INET6_ADDRSTRLEN];
+    char IPPstr[INET_ADDRSTRLEN];
+    char addrs[UTIL_MAX_ADDRS * (INET6_ADDRSTRLEN + 2)];
+    int count = (status == UTIL_SUCCESS) ? list -> count : 0;
+    size_t used = 0;
+
+    if(all){
+        addrs[0] = '\0';
+        for(int i = 0; i < count; i++){
+            used += snprintf(addrs + used, sizeof(addrs) - used, i ? ", %s" : "%s",
+                             dns_addr_ntop(&list -> addrs[i], IPstr, sizeof(IPstr)));
+        }
+    }
+    else{
+        IPstr[0] = IPPstr[0] = '\0';
+        if(count > 0){
+            dns_addr_ntop(&list -> addrs[0], IPstr, sizeof(IPstr));
+        }
+        for(int i = 0; i < count; i++){
+            if(list -> addrs[i].family == AF_INET){
+                dns_addr_ntop(&list -> addrs[i], IPPstr, sizeof(IPPstr));
+                break;
+            }
+        }
+        snprintf(addrs, sizeof(addrs), "%s, %s", IPstr, IPPstr);
+    }
+    return snprintf(line, RESULT_FORMAT_MAX_LINE, "%s, %s\n", name, addrs);
+}
+
+size_t result_format_header(unsigned char *buf){
+    memcpy(buf, RESULT_FORMAT_MAGIC, 4);
+    buf[4] = RESULT_FORMAT_VERSION;
+    buf[5] = 0; // flags, none yet
+    buf[6] = buf[7] = 0;
+    return RESULT_FORMAT_HEADER_SIZE;
+}
+
+size_t result_format_record(unsigned char *buf, const char *name, int status, const dns_addr_list *list){
+    size_t len = strlen(name);
+
+    if(len > RESULT_FORMAT_MAX_NAME){
+        len = RESULT_FORMAT_MAX_NAME;
+    }
+    buf[0] = len >> 8;
+    buf[1] = len;
+    memcpy(buf + 2, name, len);
+    return 2 + len + lookup_proto_put_answer(buf + 2 + len, status, list);
+}
+
+/* Read until a whole record is buffered or the file ends. Returns 0 or -1 */
+static int fill(result_reader *r){
+    if(r -> end - r -> start >= RESULT_FORMAT_MAX_RECORD || r -> eof){
+        return 0;
+    }
+    memmove(r -> buf, r -> buf + r -> start, r -> end - r -> start);
+    r -> end -= r -> start;
+    r -> start = 0;
+    while(!r -> eof && r -> end < RESULT_FORMAT_MAX_RECORD){
+        ssize_t n = read(r -> fd, r -> buf + r -> end, RESULT_READER_BUF_SIZE - r -> end);
+        if(n < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return -1;
+        }
+        if(n == 0){
+            r -> eof = 1;
+        }
+        r -> end += n;
+    }
+    return 0;
+}
+
+int result_reader_open(result_reader *r, int fd){
+    memset(r, 0, sizeof(*r));
+    r -> fd = fd;
+    if(!(r -> buf = malloc(RESULT_READER_BUF_SIZE))){
+        return -1;
+    }
+    if(fill(r) || r -> end < RESULT_FORMAT_HEADER_SIZE || memcmp(r -> buf, RESULT_FORMAT_MAGIC, 4) ||
+       r -> buf[4] != RESULT_FORMAT_VERSION){
+        result_reader_close(r);
+        return -1;
+    }
+    r -> start = RESULT_FORMAT_HEADER_SIZE;
+    return 0;
+}
+
+int result_reader_next(result_reader *r, result_record *rec){
+    const unsigned char *p, *end, *next;
+    size_t len;
+
+    if(fill(r)){
+        return -1;
+    }
+    if(r -> start == r -> end){
+        return 0;
+    }
+    p = r -> buf + r -> start;
+    end = r -> buf + r -> end;
+    if(end - p < 2 || (len = ((size_t)p[0] << 8) | p[1]) > RESULT_FORMAT_MAX_NAME || (size_t)(end - p - 2) < len){
+        return -1;
+    }
+    memcpy(rec -> name, p + 2, len);
+    rec -> name[len] = '\0';
+    if(!(next = lookup_proto_get_answer(p + 2 + len, end, &rec -> status, &rec -> list))){
+        return -1;
+    }
+    r -> start = next - r -> buf;
+    r -> records++;
+    return 1;
+}
+
+void result_reader_close(result_reader *r){
+    free(r -> buf);
+    r -> buf = NULL;
+}
@@ -0,0 +1,73 @@
+/*
+ * File: result_format.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Results file layouts (-F/--format=text|binary).
+ *
+ *      text is the classic "name, first address, first IPv4 address" line
+ *      per name ("name, every address" with -A).
+ *
+ *      binary is a RESULT_FORMAT_HEADER_SIZE byte header (the magic
+ *      "MLRB", u8 version, u8 flags, two reserved bytes) followed by one
+ *      record per name: u16 big-endian name length, the name, then the
+ *      name's answer exactly as lookup_proto.h sends it (u8 status, u8
+ *      address count, u8 family 4|6 + 4 or 16 raw bytes per address).
+ *      Every address is kept whatever -A says; the reader picks the
+ *      layout. result_convert turns a binary file back into text.
+ */
+
+#ifndef RESULT_FORMAT_H
+#define RESULT_FORMAT_H
+
+#include <stddef.h>
+#include "lookup_proto.h"
+
+#define RESULT_FORMAT_MAGIC "MLRB"
+#define RESULT_FORMAT_VERSION 1
+#define RESULT_FORMAT_HEADER_SIZE 8
+#define RESULT_FORMAT_MAX_NAME LOOKUP_PROTO_MAX_NAME
+#define RESULT_FORMAT_MAX_RECORD (2 + RESULT_FORMAT_MAX_NAME + LOOKUP_PROTO_ANSWER_SIZE)
+/* longest text line, newline included */
+#define RESULT_FORMAT_MAX_LINE (RESULT_FORMAT_MAX_NAME + UTIL_MAX_ADDRS * (INET6_ADDRSTRLEN + 2) + 4)
+#define RESULT_READER_BUF_SIZE (256 * 1024)
+
+enum { RESULT_FORMAT_TEXT, RESULT_FORMAT_BINARY };
+
+/* The text line for one name into line (RESULT_FORMAT_MAX_LINE bytes),
+ * returns its length. all picks the -A layout */
+int result_format_line(char *line, const char *name, int status, const dns_addr_list *list, int all);
+
+/* The binary file header into buf, returns RESULT_FORMAT_HEADER_SIZE */
+size_t result_format_header(unsigned char *buf);
+
+/* The binary record for one name into buf (RESULT_FORMAT_MAX_RECORD
+ * bytes), returns its length. Names longer than the format allows are
+ * cut short */
+size_t result_format_record(unsigned char *buf, const char *name, int status, const dns_addr_list *list);
+
+/* Streaming reader of a binary results file */
+typedef struct {
+    int fd;
+    unsigned char *buf;
+    size_t start, end; // unread bytes in buf
+    int eof;
+    long long records;
+} result_reader;
+
+typedef struct {
+    char name[RESULT_FORMAT_MAX_NAME + 1];
+    int status;
+    dns_addr_list list;
+} result_record;
+
+/* Start reading fd, which must begin with the header. Returns 0, or -1 if
+ * it does not or there is no memory */
+int result_reader_open(result_reader *r, int fd);
+
+/* The next record. Returns 1, 0 at the end of the file, -1 on a read
+ * error or a malformed or truncated record */
+int result_reader_next(result_reader *r, result_record *rec);
+
+void result_reader_close(result_reader *r);
+
+#endif
@@ -0,0 +1,234 @@
+/*
+ * File: result_writer.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Output stage between the resolver threads and the results file.
+ *      See result_writer.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "result_writer.h"
+#include "affinity.h"
+
+struct out_buf {
+    struct out_buf *next;
+    size_t used;
+    char data[RESULT_WRITER_BUF_SIZE];
+};
+
+static int out_fd = -1;
+static int echo_stdout = 0;
+static int write_failed = 0;
+static pthread_t writer_thread;
+
+/* buffer pool: free ones for the resolvers, full ones for the writer (FIFO) */
+static pthread_mutex_t pool_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t have_free = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t have_full = PTHREAD_COND_INITIALIZER;
+static struct out_buf *free_bufs = NULL;
+static struct out_buf *full_first = NULL, *full_last = NULL;
+static int stopping = 0;
+
+/* the buffer this thread is filling */
+static __thread struct out_buf *current = NULL;
+/* the buffer result_writer_append_ordered() fills, its callers take turns */
+static struct out_buf *ordered_current = NULL;
+
+static int write_all(int fd, const char *data, size_t len){
+    while(len > 0){
+        ssize_t n = write(fd, data, len);
+        if(n < 0){
+            if(errno == EINTR){
+                continue;
+            }
+            return -1;
+        }
+        data += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static void *writer_main(void *unused){
+    (void)unused;
+    affinity_pin(AFFINITY_WRITER);
+    for(;;){
+        struct out_buf *b;
+
+        pthread_mutex_lock(&pool_lock);
+        while(!full_first && !stopping){
+            pthread_cond_wait(&have_full, &pool_lock);
+        }
+        if(!(b = full_first)){
+            pthread_mutex_unlock(&pool_lock);
+            return NULL; // stopping and drained
+        }
+        if(!(full_first = b -> next)){
+            full_last = NULL;
+        }
+        pthread_mutex_unlock(&pool_lock);
+
+        if(write_all(out_fd, b -> data, b -> used)){
+            perror("Error to write results file");
+            write_failed = 1;
+        }
+        if(echo_stdout){
+            write_all(STDOUT_FILENO, b -> data, b -> used);
+        }
+
+        b -> used = 0;
+        pthread_mutex_lock(&pool_lock);
+        b -> next = free_bufs;
+        free_bufs = b;
+        pthread_cond_signal(&have_free);
+        pthread_mutex_unlock(&pool_lock);
+    }
+}
+
+/* Queue b for the writer and, if want_new, wait for a free buffer */
+static struct out_buf *swap_buffer(struct out_buf *b, int want_new){
+    struct out_buf *fresh = NULL;
+
+    pthread_mutex_lock(&pool_lock);
+    if(b && b -> used > 0){
+        b -> next = NULL;
+        if(full_last){
+            full_last -> next = b;
+        }
+        else{
+            full_first = b;
+        }
+        full_last = b;
+        pthread_cond_signal(&have_full);
+    }
+    else if(b){
+        b -> next = free_bufs;
+        free_bufs = b;
+        pthread_cond_signal(&have_free);
+    }
+    if(want_new){
+        /* the writer is RESULT_WRITER_BUFS behind: wait for it */
+        while(!free_bufs){
+            pthread_cond_wait(&have_free, &pool_lock);
+        }
+        fresh = free_bufs;
+        free_bufs = fresh -> next;
+    }
+    pthread_mutex_unlock(&pool_lock);
+    return fresh;
+}
+
+int result_writer_open(const char *path, int echo, const void *header, size_t header_len, int threads){
+    if(!strcmp(path, "-")){
+        out_fd = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0); // the caller may point stdout elsewhere
+    }
+    else{
+        out_fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    }
+    if(out_fd < 0){
+        return -1;
+    }
+    if(header_len > 0 && write_all(out_fd, header, header_len)){
+        close(out_fd);
+        out_fd = -1;
+        return -1;
+    }
+    echo_stdout = echo;
+    write_failed = 0;
+    stopping = 0;
+    /* + 1 for the ordered buffer */
+    for(int i = 0; i < threads + 1 + RESULT_WRITER_BUFS; i++){
+        struct out_buf *b = malloc(sizeof(*b));
+        if(!b){
+            break; // fewer buffers only means resolvers wait sooner
+        }
+        b -> used = 0;
+        b -> next = free_bufs;
+        free_bufs = b;
+    }
+    if(!free_bufs){
+        close(out_fd);
+        out_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+int result_writer_start(void){
+    if(pthread_create(&writer_thread, NULL, writer_main, NULL)){
+        close(out_fd);
+        out_fd = -1;
+        return -1;
+    }
+    return 0;
+}
+
+static void append_to(struct out_buf **cur, const char *line, size_t len){
+    while(len > 0){
+        if(!*cur || (*cur) -> used == RESULT_WRITER_BUF_SIZE){
+            *cur = swap_buffer(*cur, 1);
+        }
+        /* a record bigger than a whole buffer is the only thing ever split */
+        if((*cur) -> used + len > RESULT_WRITER_BUF_SIZE && (*cur) -> used > 0){
+            *cur = swap_buffer(*cur, 1);
+        }
+        size_t take = RESULT_WRITER_BUF_SIZE - (*cur) -> used;
+        if(take > len){
+            take = len;
+        }
+        memcpy((*cur) -> data + (*cur) -> used, line, take);
+        (*cur) -> used += take;
+        line += take;
+        len -= take;
+    }
+}
+
+void result_writer_append(const char *line, size_t len){
+    append_to(&current, line, len);
+}
+
+void result_writer_append_ordered(const char *line, size_t len){
+    append_to(&ordered_current, line, len);
+}
+
+void result_writer_flush(void){
+    if(current){
+        swap_buffer(current, 0);
+        current = NULL;
+    }
+}
+
+void result_writer_flush_ordered(void){
+    if(ordered_current){
+        swap_buffer(ordered_current, 0);
+        ordered_current = NULL;
+    }
+}
+
+int result_writer_stop(void){
+    result_writer_flush(); // in case the caller appended too
+    result_writer_flush_ordered();
+
+    pthread_mutex_lock(&pool_lock);
+    stopping = 1;
+    pthread_cond_signal(&have_full);
+    pthread_mutex_unlock(&pool_lock);
+    pthread_join(writer_thread, NULL);
+
+    while(free_bufs){
+        struct out_buf *b = free_bufs;
+        free_bufs = b -> next;
+        free(b);
+    }
+    if(close(out_fd)){
+        write_failed = 1;
+    }
+    out_fd = -1;
+    return write_failed ? -1 : 0;
+}
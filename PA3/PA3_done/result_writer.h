@@ -0,0 +1,60 @@
+/*
+ * File: result_writer.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Output stage between the resolver threads and the results file.
+ *
+ *      Resolvers append finished lines to a buffer of their own without
+ *      taking any lock. A full buffer is handed to one writer thread,
+ *      which writes it to the results file descriptor in one write() and
+ *      gives the buffer back. Resolvers only meet on the buffer pool's
+ *      lock once per RESULT_WRITER_BUF_SIZE bytes of output, and block
+ *      there only if the writer falls RESULT_WRITER_BUFS buffers behind.
+ *
+ *      Lines from one resolver stay in order; lines from different
+ *      resolvers are interleaved a buffer at a time, never mid-line.
+ */
+
+#ifndef RESULT_WRITER_H
+#define RESULT_WRITER_H
+
+#include <stddef.h>
+
+#define RESULT_WRITER_BUF_SIZE (64 * 1024)
+#define RESULT_WRITER_BUFS 64 // buffers the writer may fall behind, on top of one per thread
+
+/* Create (truncate) the results file at path.
+ * A path of "-" writes to (a copy of) standard output instead.
+ * With echo, everything written is copied to standard output as well.
+ * The header_len bytes at header, if any, go first (the binary format's
+ * file header). threads is the most threads that will append: each keeps
+ * a buffer of its own, so the pool gets one per thread on top of
+ * RESULT_WRITER_BUFS. Returns 0 on success, -1 on failure */
+int result_writer_open(const char *path, int echo, const void *header, size_t header_len, int threads);
+
+/* Start the writer thread for the file result_writer_open() opened. Kept
+ * apart so -P can fork its workers before the process has any threads.
+ * Returns 0 on success, -1 on failure */
+int result_writer_start(void);
+
+/* Append len bytes (one or more whole lines) to this thread's buffer */
+void result_writer_append(const char *line, size_t len);
+
+/* Append to one buffer shared by every caller instead, for output that
+ * must keep a global order (-o, see reorder.h). Callers must not run it
+ * concurrently; lines come out exactly in the order of the calls */
+void result_writer_append_ordered(const char *line, size_t len);
+
+/* Hand this thread's partly filled buffer to the writer. Every thread
+ * that appended calls this before it exits */
+void result_writer_flush(void);
+
+/* Hand the shared buffer of result_writer_append_ordered() to the writer,
+ * called under the same turns as that */
+void result_writer_flush_ordered(void);
+
+/* Write out everything handed over, stop the writer and close the file.
+ * Returns 0, or -1 if a write failed */
+int result_writer_stop(void);
+
+#endif
@@ -0,0 +1,461 @@
+/*
+ * File: safe_q.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Bounded blocking queue shared by the requester and resolver
+ *      threads. See safe_q.h.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "safe_q.h"
+
+void safe_q_lock(pthread_mutex_t *m, safe_q_stats *stats){
+    if(pthread_mutex_trylock(m)){
+        atomic_fetch_add_explicit(&stats -> lock_contended, 1, memory_order_relaxed);
+        pthread_mutex_lock(m);
+    }
+}
+
+long long safe_q_clock_ns(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* Count one sleep that began at since */
+static void count_wait(atomic_llong *waits, atomic_llong *wait_ns, long long since){
+    atomic_fetch_add_explicit(waits, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(wait_ns, safe_q_clock_ns() - since, memory_order_relaxed);
+}
+
+/* --- SAFE_Q_MUTEX: array ring behind one mutex --- */
+
+static int mq_push_batch(safe_q *q, char **names, int n){
+    int pushed = 0;
+
+    safe_q_lock(&q -> lock, &q -> stats);
+    while(pushed < n){
+        /* sleep until a resolver makes room instead of polling */
+        if(q -> count == q -> capacity && !q -> closed){
+            long long since = safe_q_clock_ns();
+            while(q -> count == q -> capacity && !q -> closed){
+                pthread_cond_wait(&q -> not_full, &q -> lock);
+            }
+            count_wait(&q -> stats.push_waits, &q -> stats.push_wait_ns, since);
+        }
+        if(q -> closed){
+            break;
+        }
+        /* copy as much of the batch as fits under this one lock hold */
+        int room = q -> capacity - q -> count;
+        int take = (n - pushed < room) ? n - pushed : room;
+        for(int i = 0; i < take; i++){
+            q -> names[q -> end] = names[pushed + i];
+            q -> end = (q -> end + 1) % q -> capacity;
+        }
+        q -> count += take;
+        pushed += take;
+        if(take == 1){
+            pthread_cond_signal(&q -> not_empty);
+        }
+        else{
+            pthread_cond_broadcast(&q -> not_empty);
+        }
+    }
+    pthread_mutex_unlock(&q -> lock);
+    return pushed;
+}
+
+static int mq_pop_batch(safe_q *q, char **names, int max){
+    int take;
+
+    safe_q_lock(&q -> lock, &q -> stats);
+    if(q -> count == 0 && !q -> closed){
+        long long since = safe_q_clock_ns();
+        while(q -> count == 0 && !q -> closed){
+            pthread_cond_wait(&q -> not_empty, &q -> lock);
+        }
+        count_wait(&q -> stats.pop_waits, &q -> stats.pop_wait_ns, since);
+    }
+    /* 0 here means closed and drained */
+    take = (q -> count < max) ? q -> count : max;
+    for(int i = 0; i < take; i++){
+        names[i] = q -> names[q -> first];
+        q -> first = (q -> first + 1) % q -> capacity;
+    }
+    q -> count -= take;
+    if(take == 1){
+        pthread_cond_signal(&q -> not_full);
+    }
+    else if(take > 1){
+        pthread_cond_broadcast(&q -> not_full);
+    }
+    pthread_mutex_unlock(&q -> lock);
+    return take;
+}
+
+/* --- SAFE_Q_LOCKFREE: bounded MPMC ring with per-slot sequence numbers ---
+ *
+ * Slot i is free for the producer holding ticket pos when seq == pos and
+ * holds data for the consumer holding ticket pos when seq == pos + 1.
+ * Popping sets seq to pos + capacity, handing the slot to the producer one
+ * lap ahead. A batch claims a run of consecutive tickets with one CAS. */
+
+static int lf_try_push_batch(safe_q *q, char **names, int n){
+    size_t pos = atomic_load_explicit(&q -> tail, memory_order_relaxed);
+    int take, retries = 0;
+
+    for(;;){
+        /* count the free slots in a row starting at our ticket */
+        for(take = 0; take < n; take++){
+            safe_q_cell *cell = &q -> cells[(pos + take) & q -> mask];
+            size_t seq = atomic_load_explicit(&cell -> seq, memory_order_acquire);
+            if(seq != pos + take){
+                break;
+            }
+        }
+        if(take == 0){
+            safe_q_cell *cell = &q -> cells[pos & q -> mask];
+            intptr_t dif = (intptr_t)atomic_load_explicit(&cell -> seq, memory_order_acquire) - (intptr_t)pos;
+            if(dif < 0){
+                take = 0; // full
+                break;
+            }
+            pos = atomic_load_explicit(&q -> tail, memory_order_relaxed);
+            retries++;
+            continue;
+        }
+        if(atomic_compare_exchange_weak_explicit(&q -> tail, &pos, pos + take,
+                                                 memory_order_relaxed, memory_order_relaxed)){
+            break;
+        }
+        retries++;
+    }
+    if(retries){
+        atomic_fetch_add_explicit(&q -> stats.cas_retries, retries, memory_order_relaxed);
+    }
+    for(int i = 0; i < take; i++){
+        safe_q_cell *cell = &q -> cells[(pos + i) & q -> mask];
+        cell -> name = names[i];
+        atomic_store_explicit(&cell -> seq, pos + i + 1, memory_order_release);
+    }
+    return take;
+}
+
+static int lf_try_pop_batch(safe_q *q, char **names, int max){
+    size_t pos = atomic_load_explicit(&q -> head, memory_order_relaxed);
+    int take, retries = 0;
+
+    for(;;){
+        /* count the published slots in a row starting at our ticket */
+        for(take = 0; take < max; take++){
+            safe_q_cell *cell = &q -> cells[(pos + take) & q -> mask];
+            size_t seq = atomic_load_explicit(&cell -> seq, memory_order_acquire);
+            if(seq != pos + take + 1){
+                break;
+            }
+        }
+        if(take == 0){
+            safe_q_cell *cell = &q -> cells[pos & q -> mask];
+            intptr_t dif = (intptr_t)atomic_load_explicit(&cell -> seq, memory_order_acquire) - (intptr_t)(pos + 1);
+            if(dif < 0){
+                take = 0; // empty
+                break;
+            }
+            pos = atomic_load_explicit(&q -> head, memory_order_relaxed);
+            retries++;
+            continue;
+        }
+        if(atomic_compare_exchange_weak_explicit(&q -> head, &pos, pos + take,
+                                                 memory_order_relaxed, memory_order_relaxed)){
+            break;
+        }
+        retries++;
+    }
+    if(retries){
+        atomic_fetch_add_explicit(&q -> stats.cas_retries, retries, memory_order_relaxed);
+    }
+    for(int i = 0; i < take; i++){
+        safe_q_cell *cell = &q -> cells[(pos + i) & q -> mask];
+        names[i] = cell -> name;
+        atomic_store_explicit(&cell -> seq, pos + i + q -> mask + 1, memory_order_release);
+    }
+    return take;
+}
+
+/* Wake threads sleeping on cond if there are any. The fence pairs with the
+ * one in the sleeper: either we see its sleepers count or it sees our slot. */
+static void lf_wake(safe_q *q, atomic_int *sleepers, pthread_cond_t *cond){
+    atomic_thread_fence(memory_order_seq_cst);
+    if(atomic_load_explicit(sleepers, memory_order_relaxed) > 0){
+        safe_q_lock(&q -> lock, &q -> stats);
+        pthread_cond_broadcast(cond);
+        pthread_mutex_unlock(&q -> lock);
+    }
+}
+
+static int lf_push_batch(safe_q *q, char **names, int n){
+    int pushed = 0;
+
+    /* like the mutex ring, a closed queue takes nothing even with room */
+    while(pushed < n && !atomic_load_explicit(&q -> lf_closed, memory_order_relaxed)){
+        int took = lf_try_push_batch(q, names + pushed, n - pushed);
+        if(took > 0){
+            pushed += took;
+            lf_wake(q, &q -> pop_sleepers, &q -> not_empty);
+            continue;
+        }
+
+        safe_q_lock(&q -> lock, &q -> stats);
+        atomic_fetch_add(&q -> push_sleepers, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        if(!atomic_load(&q -> lf_closed) && !(took = lf_try_push_batch(q, names + pushed, n - pushed))){
+            long long since = safe_q_clock_ns();
+            pthread_cond_wait(&q -> not_full, &q -> lock);
+            count_wait(&q -> stats.push_waits, &q -> stats.push_wait_ns, since);
+        }
+        atomic_fetch_sub(&q -> push_sleepers, 1);
+        pthread_mutex_unlock(&q -> lock);
+        if(took > 0){
+            pushed += took;
+            lf_wake(q, &q -> pop_sleepers, &q -> not_empty);
+        }
+        else if(atomic_load(&q -> lf_closed)){
+            break;
+        }
+    }
+    return pushed;
+}
+
+static int lf_pop_batch(safe_q *q, char **names, int max){
+    int took;
+
+    while((took = lf_try_pop_batch(q, names, max)) == 0){
+        safe_q_lock(&q -> lock, &q -> stats);
+        atomic_fetch_add(&q -> pop_sleepers, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        if((took = lf_try_pop_batch(q, names, max)) == 0 && !atomic_load(&q -> lf_closed)){
+            long long since = safe_q_clock_ns();
+            pthread_cond_wait(&q -> not_empty, &q -> lock);
+            count_wait(&q -> stats.pop_waits, &q -> stats.pop_wait_ns, since);
+        }
+        atomic_fetch_sub(&q -> pop_sleepers, 1);
+        pthread_mutex_unlock(&q -> lock);
+        if(took > 0){
+            break;
+        }
+        /* producers are joined before close, so an empty ring stays empty */
+        if(atomic_load(&q -> lf_closed) && (took = lf_try_pop_batch(q, names, max)) == 0){
+            return 0;
+        }
+        if(took > 0){
+            break;
+        }
+    }
+    lf_wake(q, &q -> push_sleepers, &q -> not_full);
+    return took;
+}
+
+/* --- public interface --- */
+
+/* Bytes of ring a queue of capacity names needs with backend kind */
+static size_t ring_bytes(int capacity, int kind){
+    if(kind == SAFE_Q_LOCKFREE){
+        /* a one slot ring can't tell "full for ticket pos" from "free for
+         * ticket pos + 1": both are seq == pos + 1 */
+        size_t size = 2;
+        while(size < (size_t)capacity){
+            size <<= 1;
+        }
+        return sizeof(safe_q_cell) * size;
+    }
+    return sizeof(char*) * capacity;
+}
+
+/* Set q up over ring, ring_bytes() long. Every byte of both is written
+ * here, so fresh pages land on the calling thread's node */
+static void queue_setup(safe_q *q, int capacity, int kind, void *ring){
+    memset(q, 0, sizeof(*q));
+    q -> kind = kind;
+    q -> capacity = capacity;
+    if(kind == SAFE_Q_LOCKFREE){
+        size_t size = ring_bytes(capacity, kind) / sizeof(safe_q_cell);
+        q -> cells = ring;
+        for(size_t i = 0; i < size; i++){
+            atomic_init(&q -> cells[i].seq, i);
+            q -> cells[i].name = NULL;
+        }
+        q -> mask = size - 1;
+        q -> capacity = (int)size;
+        atomic_init(&q -> head, 0);
+        atomic_init(&q -> tail, 0);
+        atomic_init(&q -> push_sleepers, 0);
+        atomic_init(&q -> pop_sleepers, 0);
+        atomic_init(&q -> lf_closed, 0);
+    }
+    else{
+        q -> names = ring;
+        memset(q -> names, 0, sizeof(char*) * capacity);
+    }
+    pthread_mutex_init(&q -> lock, NULL);
+    pthread_cond_init(&q -> not_full, NULL);
+    pthread_cond_init(&q -> not_empty, NULL);
+}
+
+int safe_q_init(safe_q *q, int capacity, int kind){
+    void *ring = malloc(ring_bytes(capacity, kind));
+
+    if(!ring){
+        return -1;
+    }
+    queue_setup(q, capacity, kind, ring);
+    return 0;
+}
+
+safe_q *safe_q_create(int capacity, int kind){
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t head = (sizeof(safe_q) + SAFE_Q_CACHE_LINE - 1) & ~(size_t)(SAFE_Q_CACHE_LINE - 1);
+    size_t size = (head + ring_bytes(capacity, kind) + page - 1) & ~(page - 1);
+    char *m = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    safe_q *q = (safe_q *)m;
+
+    if(m == MAP_FAILED){
+        return NULL;
+    }
+    queue_setup(q, capacity, kind, m + head);
+    q -> mapped = size;
+    return q;
+}
+
+int safe_q_push_batch(safe_q *q, char **names, int n){
+    if(q -> kind == SAFE_Q_LOCKFREE){
+        return lf_push_batch(q, names, n);
+    }
+    return mq_push_batch(q, names, n);
+}
+
+int safe_q_pop_batch(safe_q *q, char **names, int max){
+    if(q -> kind == SAFE_Q_LOCKFREE){
+        return lf_pop_batch(q, names, max);
+    }
+    return mq_pop_batch(q, names, max);
+}
+
+int safe_q_try_pop_batch(safe_q *q, char **names, int max){
+    int took;
+
+    if(q -> kind == SAFE_Q_LOCKFREE){
+        int closed = atomic_load(&q -> lf_closed);
+        if((took = lf_try_pop_batch(q, names, max)) > 0){
+            lf_wake(q, &q -> push_sleepers, &q -> not_full);
+            return took;
+        }
+        /* closed was read first, so an empty ring after it stays empty */
+        return closed ? -1 : 0;
+    }
+    safe_q_lock(&q -> lock, &q -> stats);
+    took = (q -> count < max) ? q -> count : max;
+    for(int i = 0; i < took; i++){
+        names[i] = q -> names[q -> first];
+        q -> first = (q -> first + 1) % q -> capacity;
+    }
+    q -> count -= took;
+    if(took == 1){
+        pthread_cond_signal(&q -> not_full);
+    }
+    else if(took > 1){
+        pthread_cond_broadcast(&q -> not_full);
+    }
+    else if(q -> closed){
+        took = -1;
+    }
+    pthread_mutex_unlock(&q -> lock);
+    return took;
+}
+
+int safe_q_size(safe_q *q){
+    int size;
+
+    if(q -> kind == SAFE_Q_LOCKFREE){
+        size_t head = atomic_load_explicit(&q -> head, memory_order_relaxed);
+        size_t tail = atomic_load_explicit(&q -> tail, memory_order_relaxed);
+        /* claimed but unpublished slots count as queued */
+        return (tail > head) ? (int)(tail - head) : 0;
+    }
+    safe_q_lock(&q -> lock, &q -> stats);
+    size = q -> count;
+    pthread_mutex_unlock(&q -> lock);
+    return size;
+}
+
+int safe_q_push(safe_q *q, char *name){
+    return safe_q_push_batch(q, &name, 1);
+}
+
+char *safe_q_pop(safe_q *q){
+    char *name;
+    if(safe_q_pop_batch(q, &name, 1) == 0){
+        return NULL;
+    }
+    return name;
+}
+
+void safe_q_close(safe_q *q){
+    safe_q_lock(&q -> lock, &q -> stats);
+    q -> closed = 1;
+    atomic_store(&q -> lf_closed, 1);
+    pthread_cond_broadcast(&q -> not_empty);
+    pthread_cond_broadcast(&q -> not_full);
+    pthread_mutex_unlock(&q -> lock);
+}
+
+void safe_q_cleanup(safe_q *q, void (*release)(char *name)){
+    if(q -> kind == SAFE_Q_LOCKFREE){
+        char *name;
+        while(lf_try_pop_batch(q, &name, 1) == 1){
+            release(name);
+        }
+        if(!q -> mapped){
+            free(q -> cells);
+        }
+    }
+    else{
+        while(q -> count > 0){
+            release(q -> names[q -> first]);
+            q -> first = (q -> first + 1) % q -> capacity;
+            q -> count--;
+        }
+        if(!q -> mapped){
+            free(q -> names);
+        }
+    }
+    pthread_mutex_destroy(&q -> lock);
+    pthread_cond_destroy(&q -> not_full);
+    pthread_cond_destroy(&q -> not_empty);
+}
+
+void safe_q_destroy(safe_q *q, void (*release)(char *name)){
+    size_t size = q -> mapped;
+
+    safe_q_cleanup(q, release);
+    munmap(q, size);
+}
+
+int safe_q_kind_from_name(const char *name){
+    if(!strcmp(name, "mutex")){
+        return SAFE_Q_MUTEX;
+    }
+    if(!strcmp(name, "lockfree")){
+        return SAFE_Q_LOCKFREE;
+    }
+    return -1;
+}
+
+const char *safe_q_kind_name(int kind){
+    return kind == SAFE_Q_LOCKFREE ? "lockfree" : "mutex";
+}
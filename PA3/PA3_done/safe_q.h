@@ -0,0 +1,145 @@
+/*
+ * File: safe_q.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Bounded blocking queue that carries hostnames from the requester
+ *      threads to the resolver threads of multi-lookup.
+ *
+ *      Producers sleep while the queue is full, consumers sleep while it
+ *      is empty. Once the producers are done, safe_q_close() tells the
+ *      consumers that no more input is coming: safe_q_pop() keeps handing
+ *      out what is left and then returns NULL.
+ *
+ *      Two backends share this interface:
+ *      SAFE_Q_MUTEX    - array ring guarded by one mutex.
+ *      SAFE_Q_LOCKFREE - bounded multi-producer/multi-consumer ring where
+ *                        every slot carries a sequence number. Producers
+ *                        and consumers claim slots with a CAS on their own
+ *                        cache line and only touch the mutex to sleep when
+ *                        the ring is full or empty.
+ */
+
+#ifndef SAFE_Q_H
+#define SAFE_Q_H
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#define SAFE_Q_CACHE_LINE 64
+
+#define SAFE_Q_MUTEX 0
+#define SAFE_Q_LOCKFREE 1
+
+/* Backend used when none is asked for on the command line.
+ * Build with -DSAFE_Q_DEFAULT=SAFE_Q_LOCKFREE to flip it */
+#ifndef SAFE_Q_DEFAULT
+#define SAFE_Q_DEFAULT SAFE_Q_MUTEX
+#endif
+#if SAFE_Q_DEFAULT == SAFE_Q_LOCKFREE
+#define SAFE_Q_DEFAULT_NAME "lockfree"
+#else
+#define SAFE_Q_DEFAULT_NAME "mutex"
+#endif
+
+/* Contention counters, only touched on the slow paths: when a thread has
+ * to sleep, finds the lock taken or loses a CAS. Shared with steal_pool */
+typedef struct safe_q_stats {
+    _Alignas(SAFE_Q_CACHE_LINE) atomic_llong push_waits; // pushers that slept on a full queue
+    atomic_llong push_wait_ns;
+    atomic_llong pop_waits;                               // poppers that slept on an empty queue
+    atomic_llong pop_wait_ns;
+    atomic_llong lock_contended;                          // lock holds that had to wait for the lock
+    atomic_llong cas_retries;                             // lock-free claims that lost a race
+    atomic_llong steals;                                  // names taken from another resolver's deque
+} safe_q_stats;
+
+typedef struct safe_q_cell {
+    atomic_size_t seq;
+    char *name;
+} safe_q_cell;
+
+typedef struct safe_q {
+    int kind;
+    int capacity;
+
+    /* SAFE_Q_MUTEX ring */
+    char ** names; //equal to *names[], strings character arrays so char**
+    int first;
+    int end;
+    int count;
+    int closed;
+
+    /* SAFE_Q_LOCKFREE ring, capacity rounded up to a power of two */
+    safe_q_cell *cells;
+    size_t mask;
+    _Alignas(SAFE_Q_CACHE_LINE) atomic_size_t head; // next slot to pop
+    _Alignas(SAFE_Q_CACHE_LINE) atomic_size_t tail; // next slot to push
+    _Alignas(SAFE_Q_CACHE_LINE) atomic_int push_sleepers;
+    atomic_int pop_sleepers;
+    atomic_int lf_closed;
+
+    /* both backends sleep here */
+    _Alignas(SAFE_Q_CACHE_LINE) pthread_mutex_t lock;
+    pthread_cond_t not_full;
+    pthread_cond_t not_empty;
+
+    safe_q_stats stats;
+    size_t mapped; // bytes mapped by safe_q_create(), 0 after safe_q_init()
+} safe_q;
+
+/* Allocate room for capacity names using backend kind.
+ * Returns 0 on success, -1 on failure */
+int safe_q_init(safe_q *q, int capacity, int kind);
+
+/* The same queue in a mapping of its own: the control block and the ring
+ * share fresh pages, which are placed on the calling thread's NUMA node.
+ * NULL on failure; give it back with safe_q_destroy() */
+safe_q *safe_q_create(int capacity, int kind);
+
+/* Block until there is space, then append name.
+ * Returns 1 when queued, 0 if the queue was closed */
+int safe_q_push(safe_q *q, char *name);
+
+/* Block until there is a name to hand out.
+ * Returns NULL once the queue is closed and drained */
+char *safe_q_pop(safe_q *q);
+
+/* Batched versions: one critical section (or one CAS) moves as many names
+ * as fit instead of one.
+ * safe_q_push_batch blocks until all n names are queued and returns n, or
+ * fewer if the queue was closed.
+ * safe_q_pop_batch blocks until there is at least one name and returns how
+ * many it stored in names (at most max), 0 once closed and drained */
+int safe_q_push_batch(safe_q *q, char **names, int n);
+int safe_q_pop_batch(safe_q *q, char **names, int max);
+
+/* safe_q_pop_batch without the sleep, for consumers that have other work
+ * to wait on. Returns how many names it stored, 0 if the queue is empty
+ * right now, -1 once it is closed and drained */
+int safe_q_try_pop_batch(safe_q *q, char **names, int max);
+
+/* How many names are queued right now. Only a snapshot: it may be stale
+ * by the time the caller looks at it */
+int safe_q_size(safe_q *q);
+
+/* No more input: wake every sleeper so consumers can drain and exit */
+void safe_q_close(safe_q *q);
+
+/* Hand whatever is still queued to release and free the queue itself */
+void safe_q_cleanup(safe_q *q, void (*release)(char *name));
+
+/* safe_q_cleanup() for a queue from safe_q_create(), and unmap it */
+void safe_q_destroy(safe_q *q, void (*release)(char *name));
+
+/* Lock m, counting it in stats if another thread holds it */
+void safe_q_lock(pthread_mutex_t *m, safe_q_stats *stats);
+
+/* CLOCK_MONOTONIC in ns, for timing sleeps */
+long long safe_q_clock_ns(void);
+
+/* "mutex" or "lockfree" to SAFE_Q_MUTEX/SAFE_Q_LOCKFREE, -1 if unknown */
+int safe_q_kind_from_name(const char *name);
+const char *safe_q_kind_name(int kind);
+
+#endif
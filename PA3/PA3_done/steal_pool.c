@@ -0,0 +1,302 @@
+/*
+ * File: steal_pool.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Per-resolver work queues with work stealing. See steal_pool.h.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "steal_pool.h"
+
+/* requesters walk the deques round robin, each from its own position */
+static __thread unsigned int next_deque;
+
+/* Append as many of names as fit, returns how many did */
+static int deque_push_back(steal_pool *p, steal_deque *d, char **names, int n){
+    int count = atomic_load_explicit(&d -> count, memory_order_relaxed);
+    int take = (p -> capacity - count < n) ? p -> capacity - count : n;
+    for(int i = 0; i < take; i++){
+        d -> names[(d -> first + count + i) % p -> capacity] = names[i];
+    }
+    atomic_store_explicit(&d -> count, count + take, memory_order_relaxed);
+    return take;
+}
+
+/* Take up to max names off the front, returns how many */
+static int deque_pop_front(steal_pool *p, steal_deque *d, char **names, int max){
+    int count = atomic_load_explicit(&d -> count, memory_order_relaxed);
+    int take = (count < max) ? count : max;
+    for(int i = 0; i < take; i++){
+        names[i] = d -> names[d -> first];
+        d -> first = (d -> first + 1) % p -> capacity;
+    }
+    atomic_store_explicit(&d -> count, count - take, memory_order_relaxed);
+    return take;
+}
+
+static char *deque_pop_back(steal_pool *p, steal_deque *d){
+    int count = atomic_load_explicit(&d -> count, memory_order_relaxed);
+    if(count == 0){
+        return NULL;
+    }
+    atomic_store_explicit(&d -> count, count - 1, memory_order_relaxed);
+    return d -> names[(d -> first + count - 1) % p -> capacity];
+}
+
+/* Take one name from the back of the fullest deque other than our own */
+static char *steal(steal_pool *p, int id){
+    for(;;){
+        int victim = -1;
+        int most = 0;
+        char *name;
+
+        for(int i = 0; i < p -> num_deques; i++){
+            int count = atomic_load_explicit(&p -> deques[i].count, memory_order_relaxed);
+            if(i != id && count > most){
+                most = count;
+                victim = i;
+            }
+        }
+        if(victim < 0){
+            return NULL;
+        }
+        safe_q_lock(&p -> deques[victim].lock, &p -> stats);
+        name = deque_pop_back(p, &p -> deques[victim]);
+        pthread_mutex_unlock(&p -> deques[victim].lock);
+        if(name){
+            atomic_fetch_add_explicit(&p -> stats.steals, 1, memory_order_relaxed);
+            return name;
+        }
+        /* lost the race for it, look again */
+    }
+}
+
+/* Same sleeper handshake as the lock-free safe_q: the fence pairs with the
+ * one taken by a thread about to sleep. One name in or out only ever
+ * unblocks one thread, so signal rather than broadcast unless a batch moved */
+static void wake(steal_pool *p, atomic_int *sleepers, pthread_cond_t *cond, int moved){
+    atomic_thread_fence(memory_order_seq_cst);
+    if(atomic_load_explicit(sleepers, memory_order_relaxed) > 0){
+        safe_q_lock(&p -> lock, &p -> stats);
+        if(moved == 1){
+            pthread_cond_signal(cond);
+        }
+        else{
+            pthread_cond_broadcast(cond);
+        }
+        pthread_mutex_unlock(&p -> lock);
+    }
+}
+
+/* Bytes of one deque's ring, whole cache lines so neighbours never share one */
+static size_t ring_stride(int capacity){
+    return (sizeof(char*) * capacity + SAFE_Q_CACHE_LINE - 1) & ~(size_t)(SAFE_Q_CACHE_LINE - 1);
+}
+
+/* Set p up over deques and rings (num_deques ring_stride()s). Every byte
+ * is written here, so fresh pages land on the calling thread's node */
+static void pool_setup(steal_pool *p, int num_deques, int capacity, steal_deque *deques, char *rings){
+    memset(p, 0, sizeof(*p));
+    p -> deques = deques;
+    memset(p -> deques, 0, sizeof(steal_deque) * num_deques);
+    memset(rings, 0, ring_stride(capacity) * num_deques);
+    p -> num_deques = num_deques;
+    p -> capacity = capacity;
+    for(int i = 0; i < num_deques; i++){
+        p -> deques[i].names = (char **)(rings + ring_stride(capacity) * i);
+        pthread_mutex_init(&p -> deques[i].lock, NULL);
+        atomic_init(&p -> deques[i].count, 0);
+    }
+    atomic_init(&p -> total, 0);
+    atomic_init(&p -> push_sleepers, 0);
+    atomic_init(&p -> pop_sleepers, 0);
+    atomic_init(&p -> closed, 0);
+    pthread_mutex_init(&p -> lock, NULL);
+    pthread_cond_init(&p -> not_full, NULL);
+    pthread_cond_init(&p -> not_empty, NULL);
+}
+
+int steal_pool_init(steal_pool *p, int num_deques, int capacity){
+    steal_deque *deques = aligned_alloc(SAFE_Q_CACHE_LINE, sizeof(steal_deque) * num_deques);
+    char *rings = aligned_alloc(SAFE_Q_CACHE_LINE, ring_stride(capacity) * num_deques);
+
+    if(!deques || !rings){
+        free(deques);
+        free(rings);
+        return -1;
+    }
+    pool_setup(p, num_deques, capacity, deques, rings);
+    return 0;
+}
+
+steal_pool *steal_pool_create(int num_deques, int capacity){
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t head = (sizeof(steal_pool) + SAFE_Q_CACHE_LINE - 1) & ~(size_t)(SAFE_Q_CACHE_LINE - 1);
+    size_t rings = head + sizeof(steal_deque) * num_deques;
+    size_t size = (rings + ring_stride(capacity) * num_deques + page - 1) & ~(page - 1);
+    char *m = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    steal_pool *p = (steal_pool *)m;
+
+    if(m == MAP_FAILED){
+        return NULL;
+    }
+    pool_setup(p, num_deques, capacity, (steal_deque *)(m + head), m + rings);
+    p -> mapped = size;
+    return p;
+}
+
+int steal_pool_push_batch(steal_pool *p, char **names, int n){
+    int pushed = 0;
+
+    while(pushed < n){
+        unsigned int start = next_deque++;
+
+        if(atomic_load(&p -> closed)){
+            return pushed;
+        }
+        for(int i = 0; i < p -> num_deques; i++){
+            steal_deque *d = &p -> deques[(start + i) % p -> num_deques];
+            int queued;
+
+            if(atomic_load_explicit(&d -> count, memory_order_relaxed) == p -> capacity){
+                continue;
+            }
+            safe_q_lock(&d -> lock, &p -> stats);
+            queued = deque_push_back(p, d, names + pushed, n - pushed);
+            pthread_mutex_unlock(&d -> lock);
+            if(queued){
+                pushed += queued;
+                atomic_fetch_add(&p -> total, queued);
+                wake(p, &p -> pop_sleepers, &p -> not_empty, queued);
+                if(pushed == n){
+                    return pushed;
+                }
+            }
+        }
+
+        /* every deque is full: sleep until a resolver takes something */
+        safe_q_lock(&p -> lock, &p -> stats);
+        atomic_fetch_add(&p -> push_sleepers, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        if(!atomic_load(&p -> closed) &&
+           atomic_load(&p -> total) >= p -> num_deques * p -> capacity){
+            long long since = safe_q_clock_ns();
+            pthread_cond_wait(&p -> not_full, &p -> lock);
+            atomic_fetch_add_explicit(&p -> stats.push_waits, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&p -> stats.push_wait_ns, safe_q_clock_ns() - since, memory_order_relaxed);
+        }
+        atomic_fetch_sub(&p -> push_sleepers, 1);
+        pthread_mutex_unlock(&p -> lock);
+    }
+    return pushed;
+}
+
+int steal_pool_pop_batch(steal_pool *p, int id, char **names, int max){
+    steal_deque *own = &p -> deques[id];
+
+    for(;;){
+        int took = 0;
+
+        if(atomic_load_explicit(&own -> count, memory_order_relaxed) > 0){
+            safe_q_lock(&own -> lock, &p -> stats);
+            took = deque_pop_front(p, own, names, max);
+            pthread_mutex_unlock(&own -> lock);
+        }
+        if(!took && (names[0] = steal(p, id)) != NULL){
+            took = 1;
+        }
+        if(took){
+            atomic_fetch_sub(&p -> total, took);
+            wake(p, &p -> push_sleepers, &p -> not_full, took);
+            return took;
+        }
+
+        /* nothing anywhere: sleep until a requester pushes or the pool closes */
+        safe_q_lock(&p -> lock, &p -> stats);
+        atomic_fetch_add(&p -> pop_sleepers, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        if(!atomic_load(&p -> closed) && atomic_load(&p -> total) == 0){
+            long long since = safe_q_clock_ns();
+            pthread_cond_wait(&p -> not_empty, &p -> lock);
+            atomic_fetch_add_explicit(&p -> stats.pop_waits, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&p -> stats.pop_wait_ns, safe_q_clock_ns() - since, memory_order_relaxed);
+        }
+        atomic_fetch_sub(&p -> pop_sleepers, 1);
+        pthread_mutex_unlock(&p -> lock);
+        if(atomic_load(&p -> closed) && atomic_load(&p -> total) == 0){
+            return 0;
+        }
+    }
+}
+
+int steal_pool_try_pop_batch(steal_pool *p, int id, char **names, int max){
+    steal_deque *own = &p -> deques[id];
+    int closed = atomic_load(&p -> closed);
+    int took = 0;
+
+    if(atomic_load_explicit(&own -> count, memory_order_relaxed) > 0){
+        safe_q_lock(&own -> lock, &p -> stats);
+        took = deque_pop_front(p, own, names, max);
+        pthread_mutex_unlock(&own -> lock);
+    }
+    if(!took && (names[0] = steal(p, id)) != NULL){
+        took = 1;
+    }
+    if(took){
+        atomic_fetch_sub(&p -> total, took);
+        wake(p, &p -> push_sleepers, &p -> not_full, took);
+        return took;
+    }
+    return (closed && atomic_load(&p -> total) == 0) ? -1 : 0;
+}
+
+int steal_pool_push(steal_pool *p, char *name){
+    return steal_pool_push_batch(p, &name, 1);
+}
+
+char *steal_pool_pop(steal_pool *p, int id){
+    char *name;
+    if(steal_pool_pop_batch(p, id, &name, 1) == 0){
+        return NULL;
+    }
+    return name;
+}
+
+void steal_pool_close(steal_pool *p){
+    safe_q_lock(&p -> lock, &p -> stats);
+    atomic_store(&p -> closed, 1);
+    pthread_cond_broadcast(&p -> not_empty);
+    pthread_cond_broadcast(&p -> not_full);
+    pthread_mutex_unlock(&p -> lock);
+}
+
+int steal_pool_size(steal_pool *p){
+    return atomic_load_explicit(&p -> total, memory_order_relaxed);
+}
+
+void steal_pool_cleanup(steal_pool *p, void (*release)(char *name)){
+    for(int i = 0; i < p -> num_deques; i++){
+        char *name;
+        while(deque_pop_front(p, &p -> deques[i], &name, 1) == 1){
+            release(name);
+        }
+        pthread_mutex_destroy(&p -> deques[i].lock);
+    }
+    if(!p -> mapped){
+        free(p -> deques[0].names); // every ring, see pool_setup()
+        free(p -> deques);
+    }
+    pthread_mutex_destroy(&p -> lock);
+    pthread_cond_destroy(&p -> not_full);
+    pthread_cond_destroy(&p -> not_empty);
+}
+
+void steal_pool_destroy(steal_pool *p, void (*release)(char *name)){
+    size_t size = p -> mapped;
+
+    steal_pool_cleanup(p, release);
+    munmap(p, size);
+}
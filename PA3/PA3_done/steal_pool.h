@@ -0,0 +1,85 @@
+/*
+ * File: steal_pool.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	Per-resolver work queues with work stealing.
+ *
+ *      Every resolver thread owns one bounded deque. Requesters spread
+ *      hostnames over the deques round robin, resolvers pop from the
+ *      front of their own deque and, when it runs dry, steal from the
+ *      back of whichever peer currently holds the most names. A slow
+ *      getaddrinfo() then only holds up the deque of the thread that is
+ *      stuck in it, and the other resolvers never contend on one lock.
+ *
+ *      Blocking and shutdown follow safe_q: pushers sleep while every
+ *      deque is full, poppers sleep while every deque is empty, and
+ *      steal_pool_close() lets the resolvers drain and exit.
+ */
+
+#ifndef STEAL_POOL_H
+#define STEAL_POOL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "safe_q.h"
+
+typedef struct steal_deque {
+    _Alignas(SAFE_Q_CACHE_LINE) pthread_mutex_t lock;
+    char **names;
+    int first;
+    atomic_int count; // read without the lock when looking for a victim
+} steal_deque;
+
+typedef struct steal_pool {
+    steal_deque *deques;
+    int num_deques;
+    int capacity; // per deque
+
+    _Alignas(SAFE_Q_CACHE_LINE) atomic_int total; // names queued over all deques
+    _Alignas(SAFE_Q_CACHE_LINE) atomic_int push_sleepers;
+    atomic_int pop_sleepers;
+    atomic_int closed;
+    pthread_mutex_t lock;
+    pthread_cond_t not_full;
+    pthread_cond_t not_empty;
+
+    safe_q_stats stats;
+    size_t mapped; // bytes mapped by steal_pool_create(), 0 after steal_pool_init()
+} steal_pool;
+
+/* One deque of capacity names per resolver. Returns 0 on success, -1 on failure */
+int steal_pool_init(steal_pool *p, int num_deques, int capacity);
+
+/* The same pool in a mapping of its own, placed like safe_q_create().
+ * NULL on failure; give it back with steal_pool_destroy() */
+steal_pool *steal_pool_create(int num_deques, int capacity);
+
+/* Block until some deque has space, then append name.
+ * Returns 1 when queued, 0 if the pool was closed */
+int steal_pool_push(steal_pool *p, char *name);
+
+/* Pop for resolver id, stealing from the busiest peer when its own deque
+ * is empty. Returns NULL once the pool is closed and drained */
+char *steal_pool_pop(steal_pool *p, int id);
+
+/* Batched versions with the same contract as safe_q_push_batch and
+ * safe_q_pop_batch. A batch push fills one deque per lock hold, a batch
+ * pop takes up to max names from the resolver's own deque or steals one */
+int steal_pool_push_batch(steal_pool *p, char **names, int n);
+int steal_pool_pop_batch(steal_pool *p, int id, char **names, int max);
+
+/* Same contract as safe_q_try_pop_batch */
+int steal_pool_try_pop_batch(steal_pool *p, int id, char **names, int max);
+
+void steal_pool_close(steal_pool *p);
+
+/* Names queued over all deques right now, a snapshot like safe_q_size */
+int steal_pool_size(steal_pool *p);
+
+/* Hand whatever is still queued to release and free the deques themselves */
+void steal_pool_cleanup(steal_pool *p, void (*release)(char *name));
+
+/* steal_pool_cleanup() for a pool from steal_pool_create(), and unmap it */
+void steal_pool_destroy(steal_pool *p, void (*release)(char *name));
+
+#endif
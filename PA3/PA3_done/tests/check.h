@@ -0,0 +1,41 @@
+/*
+ * File: tests/check.h
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	What the make check drivers share: CHECK() reports a failed
+ *      condition with its place and counts it, check_done() prints the
+ *      verdict and gives main its exit status. A driver that hangs (a
+ *      lost wake-up) is killed by the alarm check_start() sets.
+ */
+
+#ifndef CHECK_H
+#define CHECK_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <stdatomic.h>
+
+#define CHECK_TIMEOUT_S 120
+
+static atomic_int check_failures;
+
+#define CHECK(cond) do { \
+        if(!(cond)){ \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            atomic_fetch_add(&check_failures, 1); \
+        } \
+    } while(0)
+
+static inline void check_start(void){
+    alarm(CHECK_TIMEOUT_S);
+}
+
+static inline int check_done(const char *name){
+    int failures = atomic_load(&check_failures);
+
+    printf("%s: %s\n", name, failures ? "FAILED" : "ok");
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+#endif
@@ -0,0 +1,192 @@
+/*
+ * File: tests/test_dedup.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	make check driver for dedup (-D). A budget of a few kilobytes makes
+ *      the pre-pass spill well over DEDUP_MAX_FANIN runs, so the merge
+ *      takes more than one pass. The unique file must hold every name
+ *      once, normalized and sorted, and the expansion must give every
+ *      input name, in its own spelling, the answer of its normalized
+ *      name.
+ */
+
+#include <string.h>
+#include <arpa/inet.h>
+#include "../dedup.h"
+#include "../result_format.h"
+#include "../util.h"
+#include "check.h"
+
+#define MEMORY 4096 // bytes: 64 entries per run
+#define DISTINCT 3000
+#define MISSING_EVERY 7 // names without an answer
+
+/* The spelling copy of name number i, in one of four forms */
+static void spell(char *out, size_t size, int i, int copy){
+    snprintf(out, size, "host%05d.example%s", i, (copy % 4 == 3) ? "." : "");
+    if(copy % 2){
+        for(char *p = out; *p; p++){
+            *p = (*p >= 'a' && *p <= 'z') ? *p - 'a' + 'A' : *p;
+        }
+    }
+}
+
+static void answer(int i, int *status, dns_addr_list *list){
+    *status = (i % MISSING_EVERY) ? UTIL_SUCCESS : UTIL_FAILURE;
+    list -> count = 0;
+    if(*status == UTIL_SUCCESS){
+        uint32_t addr = htonl(0x0a000000 + i);
+        list -> count = 1;
+        list -> addrs[0].family = AF_INET;
+        memcpy(list -> addrs[0].bytes, &addr, 4);
+    }
+}
+
+static int compare_lines(const void *a, const void *b){
+    return strcmp(*(char * const *)a, *(char * const *)b);
+}
+
+/* Every line of path, sorted, in *lines. Returns how many */
+static int read_sorted(const char *path, char ***lines){
+    char line[RESULT_FORMAT_MAX_LINE];
+    int n = 0, room = 1024;
+    FILE *fp = fopen(path, "r");
+
+    *lines = malloc(sizeof(char *) * room);
+    while(fp && fgets(line, sizeof(line), fp)){
+        if(n == room){
+            *lines = realloc(*lines, sizeof(char *) * (room *= 2));
+        }
+        (*lines)[n++] = strdup(line);
+    }
+    if(fp){
+        fclose(fp);
+    }
+    qsort(*lines, n, sizeof(char *), compare_lines);
+    return n;
+}
+
+int main(void){
+    char dir[] = "/tmp/test_dedupXXXXXX", input[64], results[64], name[64];
+    char line[RESULT_FORMAT_MAX_LINE], **got, **expected;
+    char *inputs[] = { input };
+    int copies[DISTINCT], num_expected = 0, num_got;
+    FILE *fp;
+
+    check_start();
+    if(!mkdtemp(dir)){
+        perror(dir);
+        return EXIT_FAILURE;
+    }
+    snprintf(input, sizeof(input), "%s/input", dir);
+    snprintf(results, sizeof(results), "%s/results", dir);
+
+    /* every name 1 to 4 times in different spellings, spread over the file */
+    fp = fopen(input, "w");
+    for(int i = 0; i < DISTINCT; i++){
+        copies[i] = 1 + (i * 7919) % 4;
+    }
+    for(int copy = 0; copy < 4; copy++){
+        for(int i = 0; i < DISTINCT; i++){
+            int j = (i * 1103 + copy * 17) % DISTINCT; // a permutation: 1103 is prime to 3000
+            if(copy < copies[j]){
+                spell(name, sizeof(name), j, copy);
+                fprintf(fp, "%s\n", name);
+                num_expected++;
+            }
+        }
+    }
+    fclose(fp);
+
+    CHECK(dedup_init(results, MEMORY) == 0);
+    CHECK(dedup_prepass(inputs, 1) == 0);
+
+    /* the budget must have forced a merge of merges */
+    char *report = NULL, *spilled;
+    size_t report_size;
+    int runs = 0;
+    fp = open_memstream(&report, &report_size);
+    dedup_report(fp);
+    fclose(fp);
+    if((spilled = strstr(report, "fewer), "))){
+        runs = atoi(spilled + strlen("fewer), "));
+    }
+    CHECK(runs > DEDUP_MAX_FANIN);
+    free(report);
+
+    /* the unique file: each normalized name once, in order */
+    int unique = 0;
+    fp = fopen(dedup_unique_path(), "r");
+    CHECK(fp != NULL);
+    while(fp && fgets(line, sizeof(line), fp)){
+        snprintf(name, sizeof(name), "host%05d.example\n", unique);
+        if(strcmp(line, name)){
+            fprintf(stderr, "unique name %d is %s", unique, line);
+            CHECK(!strcmp(line, name));
+            break;
+        }
+        unique++;
+    }
+    CHECK(unique == DISTINCT);
+    if(fp){
+        fclose(fp);
+    }
+
+    /* answer them the way the resolvers would, minus a few */
+    unsigned char record[RESULT_FORMAT_MAX_RECORD];
+    fp = fopen(dedup_answers_path(), "w");
+    CHECK(fp != NULL);
+    fwrite(record, 1, result_format_header(record), fp);
+    for(int i = 0; i < DISTINCT; i++){
+        int status;
+        dns_addr_list list;
+
+        answer(i, &status, &list);
+        if(status == UTIL_SUCCESS){
+            snprintf(name, sizeof(name), "host%05d.example", i);
+            fwrite(record, 1, result_format_record(record, name, status, &list), fp);
+        }
+    }
+    fclose(fp);
+
+    CHECK(dedup_expand(RESULT_FORMAT_TEXT, 0) == 0);
+    dedup_cleanup();
+
+    /* one line per input name, in its own spelling */
+    expected = malloc(sizeof(char *) * num_expected);
+    num_expected = 0;
+    for(int i = 0; i < DISTINCT; i++){
+        int status;
+        dns_addr_list list;
+
+        answer(i, &status, &list);
+        for(int copy = 0; copy < copies[i]; copy++){
+            spell(name, sizeof(name), i, copy);
+            result_format_line(line, name, status, &list, 0);
+            expected[num_expected++] = strdup(line);
+        }
+    }
+    qsort(expected, num_expected, sizeof(char *), compare_lines);
+    num_got = read_sorted(results, &got);
+    CHECK(num_got == num_expected);
+    for(int i = 0; i < num_got && i < num_expected; i++){
+        if(strcmp(got[i], expected[i])){
+            fprintf(stderr, "got %sexpected %s", got[i], expected[i]);
+            CHECK(!strcmp(got[i], expected[i]));
+            break;
+        }
+    }
+
+    for(int i = 0; i < num_got; i++){
+        free(got[i]);
+    }
+    for(int i = 0; i < num_expected; i++){
+        free(expected[i]);
+    }
+    free(got);
+    free(expected);
+    unlink(input);
+    unlink(results);
+    rmdir(dir);
+    return check_done("test_dedup");
+}
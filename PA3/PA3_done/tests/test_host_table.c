@@ -0,0 +1,198 @@
+/*
+ * File: tests/test_host_table.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	make check driver for host_table (-Z, -B hosts). A table built from
+ *      a hosts file mixing both line formats must find every name in any
+ *      case and with a trailing dot, with its addresses in file order,
+ *      and miss everything else. The same must hold for its image once
+ *      mapped back, and a cut short or damaged image must be refused.
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <arpa/inet.h>
+#include "../host_table.h"
+#include "check.h"
+
+#define NAMES 20000
+#define TWICE_EVERY 5 // names with a second address
+
+static void name_of(char *out, size_t size, int i){
+    snprintf(out, size, "Node%d.Test.Example", i);
+}
+
+/* Every address name i should have, in file order */
+static void expected(int i, dns_addr_list *list){
+    memset(list, 0, sizeof(*list));
+    list -> count = 1;
+    list -> addrs[0].family = AF_INET;
+    list -> addrs[0].bytes[0] = 10;
+    list -> addrs[0].bytes[1] = i >> 16;
+    list -> addrs[0].bytes[2] = i >> 8;
+    list -> addrs[0].bytes[3] = i;
+    if(i % TWICE_EVERY == 0){
+        list -> count = 2;
+        list -> addrs[1].family = AF_INET6;
+        inet_pton(AF_INET6, "2001:db8::1", list -> addrs[1].bytes);
+        list -> addrs[1].bytes[14] = i >> 8;
+        list -> addrs[1].bytes[15] = i;
+    }
+}
+
+static int same(const dns_addr_list *a, const dns_addr_list *b){
+    if(a -> count != b -> count){
+        return 0;
+    }
+    for(int k = 0; k < a -> count; k++){
+        size_t len = (a -> addrs[k].family == AF_INET) ? 4 : 16;
+        if(a -> addrs[k].family != b -> addrs[k].family || memcmp(a -> addrs[k].bytes, b -> addrs[k].bytes, len)){
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void verify(const host_table *t){
+    char name[64], spelling[72];
+    dns_addr_list want, got;
+    int wrong = 0;
+
+    CHECK(host_table_count(t) == NAMES);
+    for(int i = 0; i < NAMES && wrong < 10; i++){
+        name_of(name, sizeof(name), i);
+        expected(i, &want);
+        for(int form = 0; form < 3; form++){
+            snprintf(spelling, sizeof(spelling), "%s%s", name, form == 2 ? "." : "");
+            for(char *p = spelling; form == 1 && *p; p++){
+                *p = (*p >= 'a' && *p <= 'z') ? *p - 'a' + 'A' : *p;
+            }
+            if(host_table_lookup(t, spelling, &got) != UTIL_SUCCESS || !same(&want, &got)){
+                fprintf(stderr, "%s: wrong answer\n", spelling);
+                CHECK(!"every name is found with its addresses");
+                wrong++;
+            }
+        }
+        /* near misses land on some other name's slot */
+        snprintf(spelling, sizeof(spelling), "%sx", name);
+        CHECK(host_table_lookup(t, spelling, &got) == HOST_TABLE_MISS);
+        snprintf(spelling, sizeof(spelling), "missing%d.test.example", i);
+        CHECK(host_table_lookup(t, spelling, &got) == HOST_TABLE_MISS);
+    }
+    CHECK(host_table_lookup(t, "", &got) == HOST_TABLE_MISS);
+    CHECK(host_table_lookup(t, ".", &got) == HOST_TABLE_MISS);
+}
+
+/* Copy image to path with its first len bytes, then patch's bytes at off */
+static void damaged_copy(const char *image, const char *path, size_t len, size_t off, const void *patch, size_t patch_len){
+    FILE *in = fopen(image, "r"), *out = fopen(path, "w");
+    char *buf = malloc(len);
+
+    CHECK(in && out && buf && fread(buf, 1, len, in) == len);
+    if(patch){
+        memcpy(buf + off, patch, patch_len);
+    }
+    fwrite(buf, 1, len, out);
+    fclose(in);
+    fclose(out);
+    free(buf);
+}
+
+/* A damaged image must be refused; if it is not, the lookup shows why */
+static void wrapped(const char *path){
+    host_table *t = host_table_open(path);
+    dns_addr_list list;
+
+    CHECK(t == NULL);
+    if(t){
+        host_table_lookup(t, "node1.test.example", &list);
+        host_table_close(t);
+    }
+}
+
+int main(void){
+    char dir[] = "/tmp/test_host_tableXXXXXX", hosts[64], image[64], damaged[64], name[64];
+    char text[INET6_ADDRSTRLEN];
+    dns_addr_list list;
+    host_table *t;
+    long size;
+    FILE *fp;
+
+    check_start();
+    if(!mkdtemp(dir)){
+        perror(dir);
+        return EXIT_FAILURE;
+    }
+    snprintf(hosts, sizeof(hosts), "%s/hosts", dir);
+    snprintf(image, sizeof(image), "%s/image", dir);
+    snprintf(damaged, sizeof(damaged), "%s/damaged", dir);
+
+    /* hosts lines for the IPv4 addresses, zone lines for the second ones */
+    fp = fopen(hosts, "w");
+    fprintf(fp, "# a comment\n\n$TTL 300\n");
+    for(int i = 0; i < NAMES; i++){
+        name_of(name, sizeof(name), i);
+        expected(i, &list);
+        inet_ntop(AF_INET, list.addrs[0].bytes, text, sizeof(text));
+        fprintf(fp, "%s\t%s%s\n", text, name, i % 3 ? "" : "."); // some spelled with the root
+    }
+    for(int i = 0; i < NAMES; i += TWICE_EVERY){
+        name_of(name, sizeof(name), i);
+        expected(i, &list);
+        inet_ntop(AF_INET6, list.addrs[1].bytes, text, sizeof(text));
+        fprintf(fp, "%s 300 IN AAAA %s ; zone style\n", name, text);
+    }
+    fclose(fp);
+
+    t = host_table_open(hosts);
+    CHECK(t != NULL);
+    if(!t){
+        return check_done("test_host_table");
+    }
+    CHECK(!host_table_mapped(t));
+    verify(t);
+    CHECK(host_table_save(t, image) == 0);
+    host_table_close(t);
+
+    t = host_table_open(image);
+    CHECK(t != NULL);
+    if(t){
+        CHECK(host_table_mapped(t));
+        verify(t);
+        host_table_close(t);
+    }
+
+    /* damaged images are refused, not trusted */
+    fp = fopen(image, "r");
+    fseek(fp, 0, SEEK_END);
+    size = ftell(fp);
+    fclose(fp);
+    damaged_copy(image, damaged, size - 1, 0, NULL, 0);
+    CHECK(host_table_open(damaged) == NULL);
+    damaged_copy(image, damaged, 16, 0, NULL, 0);
+    CHECK(host_table_open(damaged) == NULL);
+    uint32_t version = HOST_TABLE_VERSION + 1;
+    damaged_copy(image, damaged, size, 4, &version, sizeof(version));
+    CHECK(host_table_open(damaged) == NULL);
+    uint64_t slots = UINT64_MAX / 2;
+    damaged_copy(image, damaged, size, 24, &slots, sizeof(slots)); // after magic, version, seed and names
+    CHECK(host_table_open(damaged) == NULL);
+
+    /* offsets that only look in range once the additions wrap around */
+    uint64_t hdr[10], off;
+    fp = fopen(image, "r");
+    CHECK(fread(hdr, sizeof(uint64_t), 10, fp) == 10); // magic+version, seed, names, slots, buckets, disp_off, ...
+    fclose(fp);
+    off = hdr[6] - sizeof(uint32_t) * hdr[4] - 64 * sizeof(uint32_t); // disp_off + buckets wraps to slot_off - 256
+    damaged_copy(image, damaged, size, 40, &off, sizeof(off));
+    wrapped(damaged);
+    uint64_t blob[2] = { UINT64_MAX - 4095, size + 4096 }; // blob_off + blob_size wraps to size
+    damaged_copy(image, damaged, size, 56, blob, sizeof(blob));
+    wrapped(damaged);
+
+    unlink(hosts);
+    unlink(image);
+    unlink(damaged);
+    rmdir(dir);
+    return check_done("test_host_table");
+}
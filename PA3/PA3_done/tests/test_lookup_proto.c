@@ -0,0 +1,195 @@
+/*
+ * File: tests/test_lookup_proto.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	make check driver for the parsers that take bytes from outside:
+ *      lookup_proto's answers and frames (-L) and result_reader's binary
+ *      records (-F binary). Whatever is encoded must decode the same,
+ *      and anything cut short or malformed must be refused, never read
+ *      past.
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "../lookup_proto.h"
+#include "../result_format.h"
+#include "check.h"
+
+static void make_list(dns_addr_list *list, int count){
+    memset(list, 0, sizeof(*list));
+    list -> count = count;
+    for(int i = 0; i < count; i++){
+        list -> addrs[i].family = (i % 2) ? AF_INET6 : AF_INET;
+        for(int b = 0; b < 16; b++){
+            list -> addrs[i].bytes[b] = (i % 2 || b < 4) ? i * 16 + b + 1 : 0;
+        }
+    }
+}
+
+static int same(const dns_addr_list *a, const dns_addr_list *b){
+    return a -> count == b -> count && !memcmp(a -> addrs, b -> addrs, sizeof(dns_addr) * a -> count);
+}
+
+static void answers(void){
+    unsigned char buf[LOOKUP_PROTO_ANSWER_SIZE + 1];
+    dns_addr_list list, got;
+    int status;
+
+    for(int count = 0; count <= UTIL_MAX_ADDRS; count++){
+        size_t len;
+
+        make_list(&list, count);
+        len = lookup_proto_put_answer(buf, UTIL_SUCCESS, &list);
+        CHECK(len <= LOOKUP_PROTO_ANSWER_SIZE);
+        CHECK(lookup_proto_get_answer(buf, buf + len, &status, &got) == buf + len);
+        CHECK(status == UTIL_SUCCESS && same(&list, &got));
+        /* every shorter buffer is refused */
+        for(size_t cut = 0; cut < len; cut++){
+            CHECK(lookup_proto_get_answer(buf, buf + cut, &status, &got) == NULL);
+        }
+    }
+
+    /* a failure carries no addresses whatever the list holds */
+    make_list(&list, 3);
+    CHECK(lookup_proto_put_answer(buf, UTIL_FAILURE, &list) == 2);
+    CHECK(lookup_proto_get_answer(buf, buf + 2, &status, &got) == buf + 2);
+    CHECK(status == UTIL_FAILURE && got.count == 0);
+
+    /* more addresses than a list holds, and an unknown family */
+    buf[0] = LOOKUP_PROTO_FOUND;
+    buf[1] = UTIL_MAX_ADDRS + 1;
+    CHECK(lookup_proto_get_answer(buf, buf + sizeof(buf), &status, &got) == NULL);
+    buf[1] = 1;
+    buf[2] = 5;
+    CHECK(lookup_proto_get_answer(buf, buf + sizeof(buf), &status, &got) == NULL);
+}
+
+static void frames(void){
+    unsigned char frame[4 + 100], *payload;
+    uint32_t len;
+    int sv[2];
+
+    lookup_proto_put_u32(frame, 0xa1b2c3d4);
+    CHECK(lookup_proto_get_u32(frame) == 0xa1b2c3d4);
+    for(int i = 0; i < 100; i++){
+        frame[4 + i] = i;
+    }
+    lookup_proto_put_u32(frame, 100);
+
+    /* a whole frame, then the length of one that never comes */
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    CHECK(lookup_proto_write_all(sv[0], frame, sizeof(frame)) == 0);
+    CHECK(lookup_proto_write_all(sv[0], frame, 4) == 0);
+    close(sv[0]);
+    CHECK(lookup_proto_read_frame(sv[1], &payload, &len, 100) == 0);
+    CHECK(len == 100 && !memcmp(payload, frame + 4, 100));
+    free(payload);
+    CHECK(lookup_proto_read_frame(sv[1], &payload, &len, 100) == -1); // header only: truncated
+    close(sv[1]);
+
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    close(sv[0]);
+    CHECK(lookup_proto_read_frame(sv[1], &payload, &len, 100) == 1);
+    close(sv[1]);
+
+    /* over the limit */
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    CHECK(lookup_proto_write_all(sv[0], frame, sizeof(frame)) == 0);
+    close(sv[0]);
+    CHECK(lookup_proto_read_frame(sv[1], &payload, &len, 99) == -1);
+    close(sv[1]);
+
+    /* the connection ends inside the length or the payload */
+    for(size_t cut = 1; cut < sizeof(frame); cut += 7){
+        CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+        CHECK(lookup_proto_write_all(sv[0], frame, cut) == 0);
+        close(sv[0]);
+        CHECK(lookup_proto_read_frame(sv[1], &payload, &len, 100) == -1);
+        close(sv[1]);
+    }
+
+    /* writing to a closed peer fails instead of raising SIGPIPE */
+    CHECK(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    close(sv[1]);
+    CHECK(lookup_proto_write_all(sv[0], frame, sizeof(frame)) == -1);
+    close(sv[0]);
+}
+
+/* A results file of n records, cut to its first keep bytes (all if < 0) */
+static int results_file(char *path, int n, long keep){
+    unsigned char buf[RESULT_FORMAT_MAX_RECORD];
+    char name[32];
+    int fd = mkstemp(path);
+    size_t len = result_format_header(buf);
+    FILE *fp = fdopen(fd, "w+");
+
+    fwrite(buf, 1, len, fp);
+    for(int i = 0; i < n; i++){
+        dns_addr_list list;
+
+        make_list(&list, i % (UTIL_MAX_ADDRS + 1));
+        snprintf(name, sizeof(name), "record%d.example", i);
+        fwrite(buf, 1, result_format_record(buf, name, (i % 3) ? UTIL_SUCCESS : UTIL_FAILURE, &list), fp);
+    }
+    fflush(fp);
+    if(keep >= 0){
+        CHECK(ftruncate(fd, keep) == 0);
+    }
+    fd = dup(fd);
+    fclose(fp);
+    lseek(fd, 0, SEEK_SET);
+    unlink(path);
+    return fd;
+}
+
+static void records(void){
+    char path[] = "/tmp/test_lookup_protoXXXXXX", name[32];
+    result_reader r;
+    result_record rec;
+    int fd, n = 5000, i, status;
+
+    /* every record back as written, across many buffer refills */
+    fd = results_file(path, n, -1);
+    CHECK(result_reader_open(&r, fd) == 0);
+    for(i = 0; (status = result_reader_next(&r, &rec)) == 1; i++){
+        dns_addr_list list;
+
+        make_list(&list, i % (UTIL_MAX_ADDRS + 1));
+        snprintf(name, sizeof(name), "record%d.example", i);
+        CHECK(!strcmp(rec.name, name));
+        if(i % 3){
+            CHECK(rec.status == UTIL_SUCCESS && same(&rec.list, &list));
+        }
+        else{
+            CHECK(rec.status == UTIL_FAILURE && rec.list.count == 0);
+        }
+    }
+    CHECK(status == 0 && i == n);
+    result_reader_close(&r);
+    close(fd);
+
+    /* a file cut inside its last record ends in an error */
+    strcpy(path, "/tmp/test_lookup_protoXXXXXX");
+    fd = results_file(path, 3, RESULT_FORMAT_HEADER_SIZE + 20);
+    CHECK(result_reader_open(&r, fd) == 0);
+    while((status = result_reader_next(&r, &rec)) == 1){
+    }
+    CHECK(status == -1);
+    result_reader_close(&r);
+    close(fd);
+
+    /* and one without the header is refused */
+    strcpy(path, "/tmp/test_lookup_protoXXXXXX");
+    fd = results_file(path, 0, RESULT_FORMAT_HEADER_SIZE - 1);
+    CHECK(result_reader_open(&r, fd) == -1);
+    close(fd);
+}
+
+int main(void){
+    check_start();
+    answers();
+    frames();
+    records();
+    return check_done("test_lookup_proto");
+}
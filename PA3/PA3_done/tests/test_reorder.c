@@ -0,0 +1,139 @@
+/*
+ * File: tests/test_reorder.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	make check driver for reorder (-o). Requesters claim units in any
+ *      order, resolvers finish each batch they pop in shuffled order,
+ *      and the window is much smaller than the input, yet the results
+ *      file must list every name once in input order. Empty units must
+ *      still pass their base on.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "../reorder.h"
+#include "../result_writer.h"
+#include "../safe_q.h"
+#include "check.h"
+
+#define WINDOW 8
+#define REQUESTERS 3
+#define RESOLVERS 3
+#define QUEUE_SIZE 4
+#define BATCH 4
+
+static const int unit_sizes[] = { 0, 5, 300, 0, 1, 1000, 17, 2 };
+#define UNITS ((int)(sizeof(unit_sizes) / sizeof(unit_sizes[0])))
+
+static char **names[UNITS]; // names[u][i] is its sequence number in text
+static atomic_int next_unit;
+static safe_q *q;
+
+static void *requester(void *arg){
+    int u;
+
+    (void)arg;
+    while((u = atomic_fetch_add(&next_unit, 1)) < UNITS){
+        for(int i = 0; i < unit_sizes[u]; i++){
+            char *item = reorder_admit(u, i, names[u][i], 1);
+            CHECK(item != NULL);
+            CHECK(safe_q_push(q, item) == 1);
+        }
+        reorder_unit_done(u, unit_sizes[u]);
+    }
+    return NULL;
+}
+
+static void *resolver(void *arg){
+    unsigned int seed = (unsigned int)(intptr_t)arg;
+    char *items[BATCH], line[32];
+    int n;
+
+    while((n = safe_q_pop_batch(q, items, BATCH)) > 0){
+        /* finish the batch out of order */
+        for(int k = n - 1; k > 0; k--){
+            int j = rand_r(&seed) % (k + 1);
+            char *t = items[k];
+            items[k] = items[j];
+            items[j] = t;
+        }
+        for(int k = 0; k < n; k++){
+            int len = snprintf(line, sizeof(line), "%s\n", reorder_name(items[k]));
+            reorder_complete(items[k], line, len);
+        }
+    }
+    return NULL;
+}
+
+int main(void){
+    pthread_t requesters[REQUESTERS], resolvers[RESOLVERS];
+    char path[] = "/tmp/test_reorderXXXXXX", line[32];
+    int fd, total = 0, expected = 0;
+    FILE *fp;
+
+    check_start();
+    for(int u = 0; u < UNITS; u++){
+        names[u] = malloc(sizeof(char *) * (unit_sizes[u] + 1));
+        for(int i = 0; i < unit_sizes[u]; i++){
+            snprintf(line, sizeof(line), "%d", total++);
+            names[u][i] = strdup(line);
+        }
+    }
+    if((fd = mkstemp(path)) < 0){
+        perror(path);
+        return EXIT_FAILURE;
+    }
+    close(fd);
+    q = safe_q_create(QUEUE_SIZE, SAFE_Q_LOCKFREE);
+    CHECK(q != NULL);
+    CHECK(result_writer_open(path, 0, NULL, 0, RESOLVERS) == 0);
+    CHECK(result_writer_start() == 0);
+    CHECK(reorder_init(WINDOW, UNITS) == 0);
+    if(!q || check_failures){
+        unlink(path);
+        return check_done("test_reorder");
+    }
+
+    for(int r = 0; r < RESOLVERS; r++){
+        pthread_create(&resolvers[r], NULL, resolver, (void *)(intptr_t)(r + 1));
+    }
+    for(int r = 0; r < REQUESTERS; r++){
+        pthread_create(&requesters[r], NULL, requester, NULL);
+    }
+    for(int r = 0; r < REQUESTERS; r++){
+        pthread_join(requesters[r], NULL);
+    }
+    safe_q_close(q);
+    for(int r = 0; r < RESOLVERS; r++){
+        pthread_join(resolvers[r], NULL);
+    }
+    reorder_flush();
+    CHECK(result_writer_stop() == 0);
+    reorder_cleanup();
+    safe_q_destroy(q, NULL);
+
+    /* every name once, in input order */
+    fp = fopen(path, "r");
+    CHECK(fp != NULL);
+    while(fp && fgets(line, sizeof(line), fp)){
+        if(atoi(line) != expected){
+            fprintf(stderr, "line %d of the results is %s", expected, line);
+            CHECK(atoi(line) == expected);
+            break;
+        }
+        expected++;
+    }
+    CHECK(expected == total);
+    if(fp){
+        fclose(fp);
+    }
+    unlink(path);
+    for(int u = 0; u < UNITS; u++){
+        for(int i = 0; i < unit_sizes[u]; i++){
+            free(names[u][i]);
+        }
+        free(names[u]);
+    }
+    return check_done("test_reorder");
+}
@@ -0,0 +1,165 @@
+/*
+ * File: tests/test_safe_q.c
+ * Project: CSCI 3753 Programming Assignment 3
+ * Description:
+ * 	make check driver for safe_q. Producers and consumers hammer a tiny
+ *      queue of each backend, so both sides keep sleeping and waking
+ *      each other, and every item must come out exactly once. A lost
+ *      wake-up in the lock-free ring's sleeper protocol shows up as a
+ *      hang, which the alarm turns into a failure.
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include "../safe_q.h"
+#include "check.h"
+
+#define PRODUCERS 4
+#define CONSUMERS 4
+#define PER_PRODUCER 20000
+#define MAX_BATCH 16
+
+static safe_q *q;
+static int batch;
+static atomic_int seen[PRODUCERS * PER_PRODUCER];
+
+/* items are 1 + their index, never NULL */
+static char *item(int i){
+    return (char *)(intptr_t)(i + 1);
+}
+
+static int index_of(char *name){
+    return (int)(intptr_t)name - 1;
+}
+
+static void *producer(void *arg){
+    int first = (int)(intptr_t)arg * PER_PRODUCER;
+    char *names[MAX_BATCH];
+
+    for(int i = 0; i < PER_PRODUCER; ){
+        int n = (PER_PRODUCER - i < batch) ? PER_PRODUCER - i : batch;
+        for(int k = 0; k < n; k++){
+            names[k] = item(first + i + k);
+        }
+        CHECK(safe_q_push_batch(q, names, n) == n);
+        i += n;
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg){
+    char *names[MAX_BATCH];
+    int n, polling = (int)(intptr_t)arg;
+
+    for(;;){
+        n = polling ? safe_q_try_pop_batch(q, names, batch) : safe_q_pop_batch(q, names, batch);
+        if(n < 0 || (!polling && n == 0)){
+            break; // closed and drained
+        }
+        for(int k = 0; k < n; k++){
+            int i = index_of(names[k]);
+            CHECK(i >= 0 && i < PRODUCERS * PER_PRODUCER);
+            if(i >= 0 && i < PRODUCERS * PER_PRODUCER){
+                atomic_fetch_add(&seen[i], 1);
+            }
+        }
+    }
+    return NULL;
+}
+
+static void unexpected_release(char *name){
+    (void)name;
+    CHECK(!"a drained queue still had names");
+}
+
+static void run(int kind, int capacity, int b, int mapped){
+    pthread_t producers[PRODUCERS], consumers[CONSUMERS];
+    safe_q local;
+
+    batch = b;
+    if(mapped){
+        q = safe_q_create(capacity, kind);
+    }
+    else{
+        q = safe_q_init(&local, capacity, kind) ? NULL : &local;
+    }
+    CHECK(q != NULL);
+    if(!q){
+        return;
+    }
+    memset(seen, 0, sizeof(seen));
+    for(int c = 0; c < CONSUMERS; c++){
+        pthread_create(&consumers[c], NULL, consumer, (void *)(intptr_t)(c == 0)); // one polls
+    }
+    for(int p = 0; p < PRODUCERS; p++){
+        pthread_create(&producers[p], NULL, producer, (void *)(intptr_t)p);
+    }
+    for(int p = 0; p < PRODUCERS; p++){
+        pthread_join(producers[p], NULL);
+    }
+    safe_q_close(q);
+    for(int c = 0; c < CONSUMERS; c++){
+        pthread_join(consumers[c], NULL);
+    }
+    for(int i = 0; i < PRODUCERS * PER_PRODUCER; i++){
+        if(atomic_load(&seen[i]) != 1){
+            fprintf(stderr, "%s, capacity %d, batch %d: item %d came out %d times\n",
+                    safe_q_kind_name(kind), capacity, b, i, atomic_load(&seen[i]));
+            CHECK(atomic_load(&seen[i]) == 1);
+            break;
+        }
+    }
+
+    /* closed and drained: nothing more in or out */
+    char *name = item(0);
+    CHECK(safe_q_push_batch(q, &name, 1) == 0);
+    CHECK(safe_q_pop(q) == NULL);
+    CHECK(safe_q_try_pop_batch(q, &name, 1) == -1);
+    CHECK(safe_q_size(q) == 0);
+    if(mapped){
+        safe_q_destroy(q, unexpected_release);
+    }
+    else{
+        safe_q_cleanup(q, unexpected_release);
+    }
+}
+
+/* What is left at cleanup goes to release, in order */
+static char *released[8];
+static int num_released;
+
+static void record_release(char *name){
+    released[num_released++] = name;
+}
+
+static void leftovers(int kind){
+    safe_q *lq = safe_q_create(8, kind);
+    char *names[3] = { item(10), item(11), item(12) }, *out;
+
+    CHECK(lq != NULL);
+    if(!lq){
+        return;
+    }
+    CHECK(safe_q_try_pop_batch(lq, &out, 1) == 0); // empty but open
+    CHECK(safe_q_push_batch(lq, names, 3) == 3);
+    CHECK(safe_q_size(lq) == 3);
+    CHECK(safe_q_pop(lq) == item(10));
+    num_released = 0;
+    safe_q_destroy(lq, record_release);
+    CHECK(num_released == 2 && released[0] == item(11) && released[1] == item(12));
+}
+
+int main(void){
+    int kinds[] = { SAFE_Q_MUTEX, SAFE_Q_LOCKFREE };
+
+    check_start();
+    for(int k = 0; k < 2; k++){
+        run(kinds[k], 1, 1, 1);
+        run(kinds[k], 4, 1, 1);
+        run(kinds[k], 4, 3, 0);
+        run(kinds[k], 50, MAX_BATCH, 1);
+        leftovers(kinds[k]);
+    }
+    return check_done("test_safe_q");
+}
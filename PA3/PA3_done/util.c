@@ -12,75 +12,111 @@
  *  
  */
 
+#include <ctype.h>
 #include "util.h"
 
 int dnslookup(const char* hostname, char* firstIPstr, int maxSize){
 
     /* Local vars */
+    dns_addr_list list;
+    char ipstr[INET6_ADDRSTRLEN];
+
+    if(dnslookup_all(hostname, &list) != UTIL_SUCCESS){
+	return UTIL_FAILURE;
+    }
+    /* Save First IP Address */
+    dns_addr_ntop(&list.addrs[0], ipstr, sizeof(ipstr));
+    strncpy(firstIPstr, ipstr, maxSize);
+    firstIPstr[maxSize-1] = '\0';
+
+    return UTIL_SUCCESS;
+}
+
+int dnslookup_all(const char* hostname, dns_addr_list* list){
+
+    /* Local vars */
+    struct addrinfo hints;
     struct addrinfo* headresult = NULL;
     struct addrinfo* result = NULL;
-    struct sockaddr_in* ipv4sock = NULL;
-    struct in_addr* ipv4addr = NULL;
-    char ipv4str[INET_ADDRSTRLEN];
-    char ipstr[INET6_ADDRSTRLEN];
     int addrError = 0;
 
     /* DEBUG: Print Hostname*/
 #ifdef UTIL_DEBUG
     fprintf(stderr, "%s\n", hostname);
 #endif
-   
+
+    /* One entry per address rather than one per socket type */
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
     /* Lookup Hostname */
-    addrError = getaddrinfo(hostname, NULL, NULL, &headresult);
+    list->count = 0;
+    addrError = getaddrinfo(hostname, NULL, &hints, &headresult);
     if(addrError){
 	fprintf(stderr, "Error looking up Address: %s\n",
 		gai_strerror(addrError));
 	return UTIL_FAILURE;
     }
     /* Loop Through result Linked List */
-    for(result=headresult; result != NULL; result = result->ai_next){
-	/* Extract IP Address and Convert to String */
+    for(result=headresult; result != NULL && list->count < UTIL_MAX_ADDRS;
+	result = result->ai_next){
+	dns_addr addr;
+	memset(&addr, 0, sizeof(addr));
 	if(result->ai_addr->sa_family == AF_INET){
 	    /* IPv4 Address Handling */
-	    ipv4sock = (struct sockaddr_in*)(result->ai_addr);
-	    ipv4addr = &(ipv4sock->sin_addr);
-	    if(!inet_ntop(result->ai_family, ipv4addr,
-			  ipv4str, sizeof(ipv4str))){
-		perror("Error Converting IP to String");
-		return UTIL_FAILURE;
-	    }
-#ifdef UTIL_DEBUG
-	    fprintf(stdout, "%s\n", ipv4str);
-#endif
-	    strncpy(ipstr, ipv4str, sizeof(ipstr));
-	    ipstr[sizeof(ipstr)-1] = '\0';
+	    addr.family = AF_INET;
+	    memcpy(addr.bytes,
+		   &((struct sockaddr_in*)result->ai_addr)->sin_addr, 4);
 	}
 	else if(result->ai_addr->sa_family == AF_INET6){
-	    /* IPv6 Handling */
-#ifdef UTIL_DEBUG
-	    fprintf(stdout, "IPv6 Address: Not Handled\n");
-#endif
-        //strncpy(ipstr, ipstr, sizeof(ipstr));
-	    strncpy(ipstr, "UNHANDELED", sizeof(ipstr));
-	    ipstr[sizeof(ipstr)-1] = '\0';
+	    /* IPv6 Address Handling */
+	    addr.family = AF_INET6;
+	    memcpy(addr.bytes,
+		   &((struct sockaddr_in6*)result->ai_addr)->sin6_addr, 16);
 	}
 	else{
 	    /* Unhandlded Protocol Handling */
 #ifdef UTIL_DEBUG
 	    fprintf(stdout, "Unknown Protocol: Not Handled\n");
 #endif
-	    strncpy(ipstr, "UNHANDELED", sizeof(ipstr));
-	    ipstr[sizeof(ipstr)-1] = '\0';
+	    continue;
+	}
+	/* Skip repeats */
+	int seen = 0;
+	for(int i = 0; i < list->count && !seen; i++){
+	    seen = !memcmp(&list->addrs[i], &addr, sizeof(addr));
 	}
-	/* Save First IP Address */
-	if(result==headresult){
-	    strncpy(firstIPstr, ipstr, maxSize);
-	    firstIPstr[maxSize-1] = '\0';
+	if(!seen){
+	    list->addrs[list->count++] = addr;
 	}
     }
 
     /* Cleanup */
     freeaddrinfo(headresult);
 
-    return UTIL_SUCCESS;
+    return list->count > 0 ? UTIL_SUCCESS : UTIL_FAILURE;
+}
+
+const char* dns_addr_ntop(const dns_addr* addr, char* buf, size_t size){
+    if(!inet_ntop(addr->family, addr->bytes, buf, size)){
+	buf[0] = '\0';
+    }
+    return buf;
+}
+
+int dns_name_normalize(const char* name, char* out, size_t size){
+    size_t len = strlen(name);
+
+    if(len > 0 && name[len - 1] == '.'){
+	len--;
+    }
+    if(len == 0 || len >= size){
+	return 0;
+    }
+    for(size_t i = 0; i < len; i++){
+	out[i] = tolower((unsigned char)name[i]);
+    }
+    out[len] = '\0';
+    return 1;
 }
@@ -22,6 +22,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <errno.h>
+#include <stddef.h>
 
 #include <arpa/inet.h>
 #include <sys/types.h>
@@ -31,6 +32,24 @@
 #define UTIL_FAILURE -1
 #define UTIL_SUCCESS 0
 
+#define UTIL_MAX_ADDRS 16 // addresses kept per hostname
+
+/* One address in network byte order */
+typedef struct dns_addr {
+    unsigned char family;    // AF_INET or AF_INET6
+    unsigned char bytes[16]; // first 4 used for AF_INET
+} dns_addr;
+
+/* Every address of a hostname, in the order the resolver ranked them.
+ * Only the first count entries are filled in, so a copy only needs
+ * DNS_ADDR_LIST_SIZE(count) bytes */
+typedef struct dns_addr_list {
+    int count;
+    dns_addr addrs[UTIL_MAX_ADDRS];
+} dns_addr_list;
+
+#define DNS_ADDR_LIST_SIZE(n) (offsetof(dns_addr_list, addrs) + (size_t)(n) * sizeof(dns_addr))
+
 /* Fuction to return the first IP address found
  * for hostname. IP address returned as string
  * firstIPstr of size maxsize
@@ -39,4 +58,26 @@ int dnslookup(const char* hostname,
 	      char* firstIPstr,
 	      int maxSize);
 
+/* Fuction to return every IPv4 and IPv6 address
+ * of hostname with one getaddrinfo() call.
+ * UTIL_FAILURE if it has none
+ */
+int dnslookup_all(const char* hostname,
+		  dns_addr_list* list);
+
+/* Text form of addr in buf (INET6_ADDRSTRLEN
+ * bytes is always enough), returns buf
+ */
+const char* dns_addr_ntop(const dns_addr* addr,
+			  char* buf,
+			  size_t size);
+
+/* Lower case copy of name without a trailing
+ * dot in out, the form names are matched in.
+ * 0 if nothing is left or it does not fit
+ */
+int dns_name_normalize(const char* name,
+		       char* out,
+		       size_t size);
+
 #endif